@@ -284,6 +284,8 @@ struct TVMFFIErrorCell {
     TVMFFIByteArray message;
     /*!
    * \brief The traceback of the error.
+   * \note Empty for an error created by TVMFFIErrorCreateWithCapture until
+   *       TVMFFIErrorResolveTraceback is called on it.
    */
     TVMFFIByteArray traceback;
     /*!
@@ -421,6 +423,33 @@ TVM_FFI_DLL int TVMFFIFunctionCreate(void* self, TVMFFISafeCallType safe_call,
      */
 TVM_FFI_DLL int TVMFFIFunctionGetGlobal(const TVMFFIByteArray* name, TVMFFIObjectHandle* out);
 
+/*!
+     * \brief The interned slot of a global function name, see TVMFFIFunctionGetGlobalSlot.
+     *
+     * A slot lives until program exit and follows later registrations,
+     * overrides and removals of its name.
+     */
+typedef struct {
+    /*! \brief The name of the slot. */
+    TVMFFIByteArray name;
+} TVMFFIGlobalSlot;
+
+/*!
+     * \brief Get the slot of a global function name, the name does not have to be registered yet.
+     * \param name The name of the function.
+     * \param out The slot, stable for the lifetime of the program.
+     * \return 0 on success, nonzero on failure.
+     */
+TVM_FFI_DLL int TVMFFIFunctionGetGlobalSlot(const TVMFFIByteArray* name, const TVMFFIGlobalSlot** out);
+
+/*!
+     * \brief Get the global function currently registered in a slot, without hashing the name.
+     * \param slot The slot from TVMFFIFunctionGetGlobalSlot.
+     * \param out The result function pointer, NULL if the name is not registered.
+     * \return 0 on success, nonzero on failure.
+     */
+TVM_FFI_DLL int TVMFFIFunctionGetGlobalFromSlot(const TVMFFIGlobalSlot* slot, TVMFFIObjectHandle* out);
+
 /*!
      * \brief Convert an AnyView to an owned Any.
      * \param any The AnyView to convert.
@@ -474,6 +503,32 @@ TVM_FFI_DLL TVMFFIObjectHandle TVMFFIErrorCreate(const TVMFFIByteArray* kind,
                                                  const TVMFFIByteArray* message,
                                                  const TVMFFIByteArray* traceback);
 
+/*!
+     * \brief Create an error object whose traceback is symbolised from a captured stack when it is first read.
+     * \param kind The kind of the error.
+     * \param message The error message.
+     * \param pcs The program counters captured by TVMFFITracebackCapture.
+     * \param num_frames The number of captured frames.
+     * \param filename The file name of the capture site.
+     * \param lineno The line number of the capture site.
+     * \param func The function of the capture site.
+     * \return The created error object handle.
+     * \note The traceback of the error stays empty until TVMFFIErrorResolveTraceback is called.
+     */
+TVM_FFI_DLL TVMFFIObjectHandle TVMFFIErrorCreateWithCapture(const TVMFFIByteArray* kind,
+                                                            const TVMFFIByteArray* message,
+                                                            void* const* pcs, int num_frames,
+                                                            const char* filename, int lineno,
+                                                            const char* func);
+
+/*!
+     * \brief Symbolise the captured stack of an error into its traceback, once.
+     * \param error The error object handle.
+     * \note This is a no-op for errors not created by TVMFFIErrorCreateWithCapture.
+     *  It never fails, the traceback is left empty when it can not be symbolised.
+     */
+TVM_FFI_DLL void TVMFFIErrorResolveTraceback(TVMFFIObjectHandle error);
+
 //------------------------------------------------------------
 // Section: DLPack support APIs
 //------------------------------------------------------------
@@ -933,6 +988,32 @@ TVM_FFI_DLL const TVMFFITypeAttrColumn* TVMFFIGetTypeAttrColumn(const TVMFFIByte
      */
 TVM_FFI_DLL const TVMFFIByteArray* TVMFFITraceback(const char* filename, int lineno, const char* func);
 
+/*!
+     * \brief Capture the program counters of the current stack without symbolising them.
+     * This is cheap and takes no lock, the stack is turned into a traceback
+     * string later by TVMFFITracebackSymbolize.
+     * \param pcs The buffer of the program counters, the innermost frame first.
+     * \param max_frames The capacity of pcs.
+     * \return The number of captured frames, 0 when stacks can not be symbolised.
+     */
+TVM_FFI_DLL int TVMFFITracebackCapture(void** pcs, int max_frames);
+
+/*!
+     * \brief Symbolise a stack captured by TVMFFITracebackCapture into a traceback string.
+     * \param pcs The captured program counters.
+     * \param num_frames The number of captured frames.
+     * \param filename The file name of the capture site.
+     * \param lineno The line number of the capture site.
+     * \param func The function of the capture site.
+     * \return The traceback string, valid until the next call on the same thread.
+     *
+     * \note Symbols are cached across calls, so stacks through the same code
+     * are only looked up in the debug info once. The capture site is only used
+     * when the stack can not be symbolised.
+     */
+TVM_FFI_DLL const TVMFFIByteArray* TVMFFITracebackSymbolize(void* const* pcs, int num_frames, const char* filename,
+                                                            int lineno, const char* func);
+
 /*!
      * \brief Initialize the type info during runtime.
      * When the function is first called for a type,
@@ -12,9 +12,11 @@
 
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 /*!
  * \brief Macro defines whether we enable libbacktrace
@@ -72,6 +74,30 @@ public:
 };
 
 namespace details {
+/*!
+ * \brief The stack of a raise site, symbolised the first time the traceback of the error is read.
+ *
+ *  Capturing only records program counters, so raising an error does not
+ *  pay for, or serialize on, the debug info lookups of a traceback that is
+ *  rarely printed.
+ */
+struct TracebackCapture {
+    /*! \brief Maximum number of captured frames. */
+    static constexpr int kMaxFrames = 256;
+
+    TracebackCapture(std::string filename, int lineno, std::string func)
+        : filename(std::move(filename)), lineno(lineno), func(std::move(func)) {
+        void* buf[kMaxFrames];
+        int num_frames = TVMFFITracebackCapture(buf, kMaxFrames);
+        pcs.assign(buf, buf + num_frames);
+    }
+
+    std::vector<void*> pcs;
+    std::string filename;
+    int lineno;
+    std::string func;
+};
+
 class ErrorObjFromStd : public ErrorObj {
 public:
     ErrorObjFromStd(std::string kind, std::string message, std::string traceback)
@@ -112,6 +138,21 @@ public:
     Error(const std::string& kind, const std::string& message, const TVMFFIByteArray* traceback)
         : Error(kind, message, std::string(traceback->data, traceback->size)) {}
 
+    /*!
+   * \brief Construct an error whose traceback is symbolised when it is first read.
+   * \param kind The kind of the error.
+   * \param message The message of the error.
+   * \param traceback The captured stack, see TVM_FFI_TRACEBACK_CAPTURE_HERE.
+   */
+    Error(const std::string& kind, const std::string& message, const details::TracebackCapture& traceback) {
+        TVMFFIByteArray kind_arr{kind.data(), kind.length()};
+        TVMFFIByteArray message_arr{message.data(), message.length()};
+        TVMFFIObjectHandle handle = TVMFFIErrorCreateWithCapture(
+                &kind_arr, &message_arr, traceback.pcs.data(), static_cast<int>(traceback.pcs.size()),
+                traceback.filename.c_str(), traceback.lineno, traceback.func.c_str());
+        data_ = details::ObjectUnsafe::ObjectPtrFromOwned<Object>(static_cast<TVMFFIObject*>(handle));
+    }
+
     NODISCARD std::string kind() const {
         auto* obj = static_cast<ErrorObj*>(data_.get());
         return {obj->kind.data, obj->kind.size};
@@ -123,7 +164,7 @@ public:
     }
 
     NODISCARD std::string traceback() const {
-        auto* obj = static_cast<ErrorObj*>(data_.get());
+        auto* obj = ResolvedObj();
         return {obj->traceback.data, obj->traceback.size};
     }
 
@@ -134,7 +175,7 @@ public:
 
     NODISCARD const char* what() const noexcept override {
         thread_local std::string what_data;
-        auto* obj = static_cast<ErrorObj*>(data_.get());
+        auto* obj = ResolvedObj();
         what_data = std::string("Traceback (most recent call last):\n") +
                     std::string(obj->traceback.data, obj->traceback.size) +
                     std::string(obj->kind.data, obj->kind.size) + std::string(": ") +
@@ -143,6 +184,14 @@ public:
     }
 
     TVM_FFI_DEFINE_NOTNULLABLE_OBJECT_REF_METHODS(Error, ObjectRef, ErrorObj);
+
+private:
+    // the error object, with the traceback symbolised if it was captured lazily
+    ErrorObj* ResolvedObj() const noexcept {
+        auto* obj = static_cast<ErrorObj*>(data_.get());
+        TVMFFIErrorResolveTraceback(obj);
+        return obj;
+    }
 };
 
 namespace details {
@@ -155,6 +204,9 @@ public:
     explicit ErrorBuilder(std::string kind, const TVMFFIByteArray* traceback, bool log_before_throw)
         : ErrorBuilder(std::move(kind), std::string(traceback->data, traceback->size), log_before_throw) {}
 
+    explicit ErrorBuilder(std::string kind, TracebackCapture capture, bool log_before_throw)
+        : kind_(std::move(kind)), capture_(std::move(capture)), log_before_throw_(log_before_throw) {}
+
 // MSVC disable warning in error builder as it is exepected
 #ifdef _MSC_VER
 #pragma disagnostic push
@@ -162,7 +214,8 @@ public:
 #endif
     // avoid inline to reduce binary size, error throw path do not need to be fast
     [[noreturn]] ~ErrorBuilder() noexcept(false) {
-        Error error(kind_, stream_.str(), traceback_);
+        Error error = capture_.has_value() ? Error(kind_, stream_.str(), *capture_)
+                                           : Error(kind_, stream_.str(), traceback_);
         if (log_before_throw_) {
             std::cerr << error.what();
         }
@@ -180,11 +233,16 @@ protected:
     std::string kind_;
     std::ostringstream stream_;
     std::string traceback_;
+    std::optional<TracebackCapture> capture_;
     bool log_before_throw_;
 };
 
 // define traceback here as call into traceback function
 #define TVM_FFI_TRACEBACK_HERE TVMFFITraceback(__FILE__, __LINE__, TVM_FFI_FUNC_SIG)
+
+// capture the stack here, symbolised when the traceback of the error is read
+#define TVM_FFI_TRACEBACK_CAPTURE_HERE \
+    ::litetvm::ffi::details::TracebackCapture(__FILE__, __LINE__, TVM_FFI_FUNC_SIG)
 }// namespace details
 
 /*!
@@ -198,9 +256,9 @@ protected:
  *
  * \endcode
  */
-#define TVM_FFI_THROW(ErrorKind)                                              \
-    ::litetvm::ffi::details::ErrorBuilder(#ErrorKind, TVM_FFI_TRACEBACK_HERE, \
-                                          TVM_FFI_ALWAYS_LOG_BEFORE_THROW)    \
+#define TVM_FFI_THROW(ErrorKind)                                                      \
+    ::litetvm::ffi::details::ErrorBuilder(#ErrorKind, TVM_FFI_TRACEBACK_CAPTURE_HERE, \
+                                          TVM_FFI_ALWAYS_LOG_BEFORE_THROW)            \
             .stream()
 
 /*!
@@ -211,7 +269,7 @@ protected:
  *  In most cases, we should use use TVM_FFI_THROW.
  */
 #define TVM_FFI_LOG_AND_THROW(ErrorKind) \
-    ::litetvm::ffi::details::ErrorBuilder(#ErrorKind, TVM_FFI_TRACEBACK_HERE, true).stream()
+    ::litetvm::ffi::details::ErrorBuilder(#ErrorKind, TVM_FFI_TRACEBACK_CAPTURE_HERE, true).stream()
 
 // Glog style checks with TVM_FFI prefix
 // NOTE: we explicitly avoid glog style generic macros (LOG/CHECK) in tvm ffi
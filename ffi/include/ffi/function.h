@@ -12,7 +12,9 @@
 #include "ffi/function_details.h"
 
 #include <functional>
+#include <new>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -128,6 +130,110 @@ private:
     mutable TStorage callable_;
 };
 
+/*!
+ * \brief Tag of a typed call signature, the address of id identifies FType.
+ * \tparam FType The exact function signature, R(Args...).
+ */
+template<typename FType>
+struct TypedCallTag {
+    static constexpr char id = 0;
+};
+
+template<typename FType>
+class TypedFunctionObjBase;
+
+/*!
+ * \brief FunctionObj with a direct entry of signature R(Args...).
+ *
+ *  Every object of the signature shares the packed entry Call, so the call
+ *  field identifies them without growing FunctionObj, and TypedFunction of
+ *  the same signature hands its arguments to typed_call without packing.
+ *  Objects of other libraries have their own Call and take the packed path.
+ */
+template<typename R, typename... Args>
+class TypedFunctionObjBase<R(Args...)> : public FunctionObj {
+public:
+    /*! \brief The direct entry, called with the object itself. */
+    using FTypedCall = R (*)(const FunctionObj*, Args...);
+
+    /*!
+   * \param func The function.
+   * \return func as a function of this signature, nullptr if it is not one.
+   */
+    TVM_FFI_INLINE static const TypedFunctionObjBase* Cast(const FunctionObj* func) {
+        if (func == nullptr || func->call != Call) return nullptr;
+        return static_cast<const TypedFunctionObjBase*>(func);
+    }
+
+    /*! \brief The direct entry */
+    FTypedCall typed_call;
+
+protected:
+    explicit TypedFunctionObjBase(FTypedCall typed_call = nullptr) : typed_call(typed_call) {
+        this->safe_call = SafeCall;
+        this->call = Call;
+    }
+
+    /*! \brief The name in the error messages of the packed call, nullptr for none. */
+    const std::string* name_{nullptr};
+
+private:
+    static void Call(const FunctionObj* func, const AnyView* args, int32_t num_args, Any* result) {
+        // refer to the tag of the signature, identical code folding must not merge
+        // the entries of two signatures that happen to compile alike
+        static_cast<void>(*static_cast<const volatile char*>(&TypedCallTag<R(Args...)>::id));
+        auto* self = static_cast<const TypedFunctionObjBase*>(func);
+        auto callable = [self](Args... args) -> R { return self->typed_call(self, std::forward<Args>(args)...); };
+        unpack_call<R>(std::index_sequence_for<Args...>{}, self->name_, callable, args, num_args, result);
+    }
+};
+
+/*!
+ * \brief FunctionObj backed by a typed callable, as created by Function::FromTyped.
+ */
+template<typename TCallable>
+class TypedFunctionObjImpl : public TypedFunctionObjBase<typename FunctionInfo<std::remove_cv_t<std::remove_reference_t<TCallable>>>::FType> {
+public:
+    using TStorage = std::remove_cv_t<std::remove_reference_t<TCallable>>;
+    using FuncInfo = FunctionInfo<TStorage>;
+    using TBase = TypedFunctionObjBase<typename FuncInfo::FType>;
+    /*! \brief The type of derived object class */
+    using TSelf = TypedFunctionObjImpl;
+
+    explicit TypedFunctionObjImpl(TStorage callable)
+        : TBase(TypedCallOf(static_cast<typename FuncInfo::FType*>(nullptr))), callable_(std::move(callable)) {}
+
+private:
+    template<typename R, typename... Args>
+    static R TypedCall(const FunctionObj* func, Args... args) {
+        return static_cast<const TSelf*>(func)->callable_(std::forward<Args>(args)...);
+    }
+
+    template<typename R, typename... Args>
+    static auto TypedCallOf(R (*)(Args...)) -> R (*)(const FunctionObj*, Args...) {
+        return TypedCall<R, Args...>;
+    }
+
+    /*! \brief The typed callable */
+    mutable TStorage callable_;
+};
+
+/*!
+ * \brief TypedFunctionObjImpl that names the function in its error messages.
+ */
+template<typename TCallable>
+class NamedTypedFunctionObjImpl : public TypedFunctionObjImpl<TCallable> {
+public:
+    NamedTypedFunctionObjImpl(typename TypedFunctionObjImpl<TCallable>::TStorage callable, std::string name)
+        : TypedFunctionObjImpl<TCallable>(std::move(callable)), name_storage_(std::move(name)) {
+        this->name_ = &name_storage_;
+    }
+
+private:
+    /*! \brief The name of the function */
+    std::string name_storage_;
+};
+
 /*!
  * \brief Base class to provide a common implementation to redirect call to safe call
  * \tparam Derived The derived class in CRTP-idiom
@@ -280,6 +386,71 @@ private:
     int32_t size_;
 };
 
+namespace details {
+/*! \brief Whether fn takes packed arguments. */
+template<auto fn>
+constexpr bool kIsPackedFunction = std::is_invocable_v<decltype(fn), const AnyView*, int32_t, Any*> ||
+                                   std::is_invocable_v<decltype(fn), PackedArgs, Any*>;
+
+/*! \brief The base of StaticFunctionObjImpl, typed functions get the direct entry. */
+template<auto fn, bool packed = kIsPackedFunction<fn>>
+struct StaticFunctionObjBase {
+    using type = FunctionObj;
+};
+
+template<auto fn>
+struct StaticFunctionObjBase<fn, false> {
+    using type = TypedFunctionObjBase<std::remove_pointer_t<decltype(fn)>>;
+};
+
+/*!
+ * \brief FunctionObj of a function known at compile time, allocated in static storage.
+ * \tparam fn The function, in packed format or with a typed signature.
+ */
+template<auto fn>
+class StaticFunctionObjImpl : public StaticFunctionObjBase<fn>::type {
+public:
+    /*! \return The only instance, it is never destructed nor freed. */
+    static ObjectPtr<Object> Get() {
+        alignas(StaticFunctionObjImpl) static char storage[sizeof(StaticFunctionObjImpl)];
+        static StaticFunctionObjImpl* inst = new (storage) StaticFunctionObjImpl();
+        return ObjectUnsafe::ObjectPtrFromUnowned<Object>(inst);
+    }
+
+private:
+    StaticFunctionObjImpl() {
+        // the reference held by the static storage never goes away, and there is no deleter
+        this->header_.strong_ref_count = 1;
+        this->header_.weak_ref_count = 1;
+        this->header_.type_index = FunctionObj::RuntimeTypeIndex();
+        if constexpr (kIsPackedFunction<fn>) {
+            this->safe_call = FunctionObj::SafeCall;
+            this->call = Call;
+        } else {
+            this->typed_call = TypedCallOf(fn);
+        }
+    }
+
+    template<typename R, typename... Args>
+    static R TypedCall(const FunctionObj*, Args... args) {
+        return fn(std::forward<Args>(args)...);
+    }
+
+    template<typename R, typename... Args>
+    static auto TypedCallOf(R (*)(Args...)) -> R (*)(const FunctionObj*, Args...) {
+        return TypedCall<R, Args...>;
+    }
+
+    static void Call(const FunctionObj*, const AnyView* args, int32_t num_args, Any* rv) {
+        if constexpr (std::is_invocable_v<decltype(fn), const AnyView*, int32_t, Any*>) {
+            fn(args, num_args, rv);
+        } else {
+            fn(PackedArgs(args, num_args), rv);
+        }
+    }
+};
+}// namespace details
+
 /*!
  * \brief ffi::Function is a type-erased function.
  *  The arguments are passed by "packed format" via AnyView
@@ -454,12 +625,10 @@ public:
    */
     template<typename TCallable>
     static Function FromTyped(TCallable callable) {
-        using FuncInfo = details::FunctionInfo<TCallable>;
-        auto packed_call = [callable](const AnyView* args, int32_t num_args, Any* rv) mutable -> void {
-            details::unpack_call<typename FuncInfo::RetType>(std::make_index_sequence<FuncInfo::num_args>{},
-                                                             nullptr, callable, args, num_args, rv);
-        };
-        return FromPackedInternal(packed_call);
+        using ObjType = details::TypedFunctionObjImpl<TCallable>;
+        Function func;
+        func.data_ = details::PooledObjAllocator().make_object<ObjType>(std::move(callable));
+        return func;
     }
 
     /*!
@@ -470,12 +639,32 @@ public:
    */
     template<typename TCallable>
     static Function FromTyped(TCallable callable, std::string name) {
-        using FuncInfo = details::FunctionInfo<TCallable>;
-        auto packed_call = [callable, name](const AnyView* args, int32_t num_args, Any* rv) mutable -> void {
-            details::unpack_call<typename FuncInfo::RetType>(
-                    std::make_index_sequence<FuncInfo::num_args>{}, &name, callable, args, num_args, rv);
-        };
-        return FromPackedInternal(packed_call);
+        using ObjType = details::NamedTypedFunctionObjImpl<TCallable>;
+        Function func;
+        func.data_ = details::PooledObjAllocator().make_object<ObjType>(std::move(callable), std::move(name));
+        return func;
+    }
+
+    /*!
+   * \brief Constructing a packed function from a function known at compile time.
+   *
+   *  Unlike FromPacked and FromTyped nothing is allocated, every call returns
+   *  the same statically allocated function object.
+   *
+   * \tparam fn The function, in packed format or with a typed signature.
+   *
+   * \code
+   *   int AddOne(int x) { return x + 1; }
+   *   Function f = Function::FromStatic<AddOne>();
+   * \endcode
+   */
+    template<auto fn>
+    static Function FromStatic() {
+        static_assert(std::is_pointer_v<decltype(fn)> && std::is_function_v<std::remove_pointer_t<decltype(fn)>>,
+                      "ffi::Function::FromStatic requires a function");
+        Function func;
+        func.data_ = details::StaticFunctionObjImpl<fn>::Get();
+        return func;
     }
 
     /*!
@@ -545,11 +734,80 @@ private:
     static Function FromPackedInternal(TCallable packed_call) {
         using ObjType = details::FunctionObjImpl<TCallable>;
         Function func;
-        func.data_ = make_object<ObjType>(std::forward<TCallable>(packed_call));
+        // closures are mostly small and short-lived, recycle their memory
+        func.data_ = details::PooledObjAllocator().make_object<ObjType>(std::forward<TCallable>(packed_call));
         return func;
     }
 };
 
+/*!
+ * \brief A resolved handle of a global function name.
+ *
+ *  The name is interned once on construction, every later lookup reads
+ *  the current registration of the name without hashing it, and sees
+ *  functions registered, overridden or removed after the handle was made.
+ *  Lookups are lock-free and safe against concurrent registration.
+ *
+ * \code
+ *  static FunctionHandle fadd("testing.add");
+ *  int y = fadd(1, 2).cast<int>();
+ * \endcode
+ */
+class FunctionHandle {
+public:
+    /*!
+   * \brief Intern a global function name.
+   * \param name The function name.
+   */
+    explicit FunctionHandle(std::string_view name) {
+        TVMFFIByteArray name_arr{name.data(), name.size()};
+        TVM_FFI_CHECK_SAFE_CALL(TVMFFIFunctionGetGlobalSlot(&name_arr, &slot_));
+    }
+
+    /*! \return The function name. */
+    std::string_view name() const {
+        return std::string_view(slot_->name.data, slot_->name.size);
+    }
+
+    /*!
+   * \brief Get the function currently registered under the name.
+   * \return The function, std::nullopt if the name is not registered.
+   */
+    std::optional<Function> Get() const {
+        TVMFFIObjectHandle handle;
+        TVM_FFI_CHECK_SAFE_CALL(TVMFFIFunctionGetGlobalFromSlot(slot_, &handle));
+        if (handle != nullptr) {
+            return Function(details::ObjectUnsafe::ObjectPtrFromOwned<Object>(static_cast<Object*>(handle)));
+        }
+        return std::nullopt;
+    }
+
+    /*!
+   * \brief Get the function currently registered under the name and throw an error if there is none.
+   * \return The function.
+   */
+    Function GetRequired() const {
+        std::optional<Function> res = Get();
+        if (!res.has_value()) {
+            TVM_FFI_THROW(ValueError) << "Function " << name() << " not found";
+        }
+        return res.value();
+    }
+
+    /*!
+   * \brief Call the function currently registered under the name.
+   * \param args The arguments
+   * \return The result.
+   */
+    template<typename... Args>
+    Any operator()(Args&&... args) const {
+        return GetRequired()(std::forward<Args>(args)...);
+    }
+
+private:
+    const TVMFFIGlobalSlot* slot_;
+};
+
 /*!
  * \brief Please refer to \ref TypedFunctionAnchor "TypedFunction<R(Args..)>"
  */
@@ -684,6 +942,11 @@ public:
    * \returns The return value.
    */
     TVM_FFI_INLINE R operator()(Args... args) const {
+        // call a typed function of the same signature directly, without packing
+        using TTyped = details::TypedFunctionObjBase<R(Args...)>;
+        if (const TTyped* func = TTyped::Cast(static_cast<const FunctionObj*>(packed_.get()))) {
+            return func->typed_call(func, std::forward<Args>(args)...);
+        }
         if constexpr (std::is_same_v<R, void>) {
             packed_(std::forward<Args>(args)...);
         } else {
@@ -7,6 +7,8 @@
 
 #include "ffi/object.h"
 
+#include <cstddef>
+#include <new>
 #include <type_traits>
 #include <utility>
 
@@ -27,7 +29,8 @@ namespace details {
 //
 // Possible future allocator optimizations:
 // - Arena allocator that gives ownership of memory to arena (deleter = nullptr)
-// - Thread-local object pools: one pool per size and alignment requirement.
+// - Thread-local object pools: one pool per size and alignment requirement,
+//   see PooledObjAllocator.
 // - Can specialize by type of object to give the specific allocator to each object.
 
 /*!
@@ -183,6 +186,117 @@ public:
     };
 };
 
+/*!
+ * \brief Thread-local free list of fixed-size object blocks.
+ *
+ *  A block freed on a thread is handed to the next allocation of the same
+ *  size on that thread, so short-lived objects skip operator new/delete.
+ *  Each list caches at most kMaxCachedBlocks blocks, the rest are deleted.
+ *
+ * \tparam kBlockSize The size of the blocks in bytes.
+ */
+template<size_t kBlockSize>
+class ObjBlockFreeList {
+public:
+    static constexpr int kMaxCachedBlocks = 64;
+
+    static void* Allocate() {
+        if (ObjBlockFreeList* list = ThreadLocal(); list != nullptr && list->head_ != nullptr) {
+            Block* block = list->head_;
+            list->head_ = block->next;
+            --list->num_blocks_;
+            return block;
+        }
+        return ::operator new(kBlockSize);
+    }
+
+    static void Free(void* ptr) {
+        if (ObjBlockFreeList* list = ThreadLocal(); list != nullptr && list->num_blocks_ < kMaxCachedBlocks) {
+            auto* block = static_cast<Block*>(ptr);
+            block->next = list->head_;
+            list->head_ = block;
+            ++list->num_blocks_;
+            return;
+        }
+        ::operator delete(ptr);
+    }
+
+    ~ObjBlockFreeList() {
+        while (head_ != nullptr) {
+            Block* next = head_->next;
+            ::operator delete(head_);
+            head_ = next;
+        }
+        destroyed_ = true;
+    }
+
+private:
+    struct Block {
+        Block* next;
+    };
+    static_assert(kBlockSize >= sizeof(Block), "block too small to be linked");
+
+    // nullptr once the list of the thread is destroyed, objects freed at thread exit bypass it
+    static ObjBlockFreeList* ThreadLocal() {
+        thread_local ObjBlockFreeList list;
+        return destroyed_ ? nullptr : &list;
+    }
+
+    Block* head_{nullptr};
+    int num_blocks_{0};
+    static inline thread_local bool destroyed_ = false;
+};
+
+/*!
+ * \brief Allocator that recycles small objects through thread-local free lists.
+ *
+ *  Objects are grouped by size rounded up to kSizeClass bytes, so objects of
+ *  different types but similar size share blocks. Objects larger than
+ *  kMaxPooledSize or over-aligned objects fall back to SimpleObjAllocator.
+ */
+class PooledObjAllocator : public ObjAllocatorBase<PooledObjAllocator> {
+public:
+    static constexpr size_t kSizeClass = 32;
+    static constexpr size_t kMaxPooledSize = 256;
+
+    template<typename T>
+    class Handler {
+    public:
+        static constexpr size_t kBlockSize = (sizeof(T) + kSizeClass - 1) / kSizeClass * kSizeClass;
+        static constexpr bool kPooled =
+                kBlockSize <= kMaxPooledSize && alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+        template<typename... Args>
+        static T* New(PooledObjAllocator*, Args&&... args) {
+            if constexpr (kPooled) {
+                void* data = ObjBlockFreeList<kBlockSize>::Allocate();
+                return new (data) T(std::forward<Args>(args)...);
+            } else {
+                return SimpleObjAllocator::Handler<T>::New(nullptr, std::forward<Args>(args)...);
+            }
+        }
+
+        static FObjectDeleter Deleter() {
+            if constexpr (kPooled) {
+                return Deleter_;
+            } else {
+                return SimpleObjAllocator::Handler<T>::Deleter();
+            }
+        }
+
+    private:
+        static void Deleter_(void* objptr, int flags) {
+            T* tptr = ObjectUnsafe::RawObjectPtrFromUnowned<T>(static_cast<TVMFFIObject*>(objptr));
+            if (flags & kTVMFFIObjectDeleterFlagBitMaskStrong) {
+                tptr->T::~T();
+            }
+            if (flags & kTVMFFIObjectDeleterFlagBitMaskWeak) {
+                ObjBlockFreeList<kBlockSize>::Free(tptr);
+            }
+        }
+    };
+};
+
 }// namespace details
 
 
@@ -37,22 +37,22 @@ inline int32_t GetTracebackLimit() {
 inline bool ShouldExcludeFrame(const char* filename, const char* symbol) {
     if (filename) {
         // Stack frames for TVM FFI
-        if (strstr(filename, "include/tvm/ffi/error.h")) {
+        if (strstr(filename, "include/ffi/error.h")) {
             return true;
         }
-        if (strstr(filename, "include/tvm/ffi/function_details.h")) {
+        if (strstr(filename, "include/ffi/function_details.h")) {
             return true;
         }
-        if (strstr(filename, "include/tvm/ffi/function.h")) {
+        if (strstr(filename, "include/ffi/function.h")) {
             return true;
         }
-        if (strstr(filename, "include/tvm/ffi/any.h")) {
+        if (strstr(filename, "include/ffi/any.h")) {
             return true;
         }
-        if (strstr(filename, "include/tvm/runtime/logging.h")) {
+        if (strstr(filename, "include/runtime/logging.h")) {
             return true;
         }
-        if (strstr(filename, "src/ffi/traceback.cc")) {
+        if (strstr(filename, "src/ffi/traceback.cpp")) {
             return true;
         }
         // C++ stdlib frames
@@ -70,6 +70,10 @@ inline bool ShouldExcludeFrame(const char* filename, const char* symbol) {
     if (strncmp(symbol, "TVMFFIErrorSetRaisedFromCStr", 28) == 0) {
         return true;
     }
+    // the stack capture itself, when it has no debug info
+    if (strncmp(symbol, "TVMFFITraceback", 15) == 0) {
+        return true;
+    }
     // libffi.so stack frames.  These may also show up as numeric
     // addresses with no symbol name.  This could be improved in the
     // future by using dladdr() to check whether an address is contained
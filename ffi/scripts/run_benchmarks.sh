@@ -0,0 +1,39 @@
+#!/bin/bash
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+#
+# Run the FFI microbenchmarks and write the results as JSON.
+#
+#   scripts/run_benchmarks.sh [output.json] [baseline.json]
+#
+# With a baseline, the run is compared against it with compare.py from
+# Google Benchmark, found through BENCHMARK_COMPARE (default: compare.py on PATH).
+# Extra flags can be passed through BENCHMARK_ARGS, e.g.
+#   BENCHMARK_ARGS="--benchmark_filter=Map --benchmark_repetitions=5"
+set -euxo pipefail
+
+BUILD_TYPE=Release
+OUTPUT=${1:-ffi_bench.json}
+BASELINE=${2:-}
+
+cmake -G Ninja -S . -B build-bench -DTVM_FFI_BUILD_TESTS=ON -DCMAKE_BUILD_TYPE=${BUILD_TYPE}
+cmake --build build-bench --parallel 16 --config ${BUILD_TYPE} --target ffi_bench
+./build-bench/bin/ffi_bench --benchmark_out="${OUTPUT}" --benchmark_out_format=json ${BENCHMARK_ARGS:-}
+
+if [ -n "${BASELINE}" ]; then
+  ${BENCHMARK_COMPARE:-compare.py} benchmarks "${BASELINE}" "${OUTPUT}"
+fi
@@ -4,9 +4,79 @@
 #include "ffi/error.h"
 #include "ffi/c_api.h"
 
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace litetvm {
 namespace ffi {
 
+namespace details {
+/*!
+ * \brief Error whose traceback is symbolised from the stack captured at the raise site.
+ *
+ *  Only created here, so its UpdateTraceback has a single address that
+ *  TVMFFIErrorResolveTraceback tells it apart by.
+ */
+class ErrorObjFromCapture : public ErrorObj {
+public:
+    ErrorObjFromCapture(std::string kind, std::string message, std::vector<void*> pcs,
+                        std::string filename, int lineno, std::string func)
+        : kind_data_(std::move(kind)), message_data_(std::move(message)), pcs_(std::move(pcs)),
+          filename_(std::move(filename)), lineno_(lineno), func_(std::move(func)) {
+        this->kind = TVMFFIByteArray{kind_data_.data(), kind_data_.length()};
+        this->message = TVMFFIByteArray{message_data_.data(), message_data_.length()};
+        this->traceback = TVMFFIByteArray{traceback_data_.data(), traceback_data_.length()};
+        this->update_traceback = UpdateTraceback;
+    }
+
+    /*!
+   * \brief Symbolise the captured stack into the traceback, once.
+   * \note The traceback is left empty if symbolising fails.
+   */
+    static void ResolveTraceback(TVMFFIObjectHandle self) noexcept {
+        if (static_cast<ErrorObj*>(self)->update_traceback != UpdateTraceback) return;
+        auto* obj = static_cast<ErrorObjFromCapture*>(static_cast<ErrorObj*>(self));
+        try {
+            std::call_once(obj->resolve_once_, [obj] {
+                try {
+                    const TVMFFIByteArray* traceback = TVMFFITracebackSymbolize(
+                            obj->pcs_.data(), static_cast<int>(obj->pcs_.size()), obj->filename_.c_str(),
+                            obj->lineno_, obj->func_.c_str());
+                    obj->traceback_data_.assign(traceback->data, traceback->size);
+                } catch (...) {
+                    obj->traceback_data_.clear();
+                }
+                obj->traceback = TVMFFIByteArray{obj->traceback_data_.data(), obj->traceback_data_.length()};
+            });
+        } catch (...) {
+        }
+    }
+
+private:
+    /*!
+   * \brief Update the traceback of the error object, which replaces the captured one.
+   * \param traceback_str The traceback to update.
+   */
+    static void UpdateTraceback(TVMFFIObjectHandle self, const TVMFFIByteArray* traceback_str) {
+        auto* obj = static_cast<ErrorObjFromCapture*>(self);
+        std::call_once(obj->resolve_once_, [] {});
+        obj->traceback_data_ = std::string(traceback_str->data, traceback_str->size);
+        obj->traceback = TVMFFIByteArray{obj->traceback_data_.data(), obj->traceback_data_.length()};
+    }
+
+    std::string kind_data_;
+    std::string message_data_;
+    std::string traceback_data_;
+    std::vector<void*> pcs_;
+    std::string filename_;
+    int lineno_;
+    std::string func_;
+    std::once_flag resolve_once_;
+};
+}// namespace details
+
 class SafeCallContext {
 public:
     void SetRaised(TVMFFIObjectHandle error) {
@@ -14,7 +84,7 @@ public:
                 details::ObjectUnsafe::ObjectPtrFromUnowned<ErrorObj>(static_cast<TVMFFIObject*>(error));
     }
 
-    void SetRaisedByCstr(const char* kind, const char* message, const TVMFFIByteArray* traceback) {
+    void SetRaisedByCstr(const char* kind, const char* message, const details::TracebackCapture& traceback) {
         Error error(kind, message, traceback);
         last_error_ = details::ObjectUnsafe::ObjectPtrFromObjectRef<ErrorObj>(std::move(error));
     }
@@ -36,8 +106,8 @@ private:
 }// namespace litetvm
 
 void TVMFFIErrorSetRaisedFromCStr(const char* kind, const char* message) {
-    // NOTE: run traceback here to simplify the depth of tracekback
-    litetvm::ffi::SafeCallContext::ThreadLocal()->SetRaisedByCstr(kind, message, TVM_FFI_TRACEBACK_HERE);
+    // NOTE: capture traceback here to simplify the depth of tracekback
+    litetvm::ffi::SafeCallContext::ThreadLocal()->SetRaisedByCstr(kind, message, TVM_FFI_TRACEBACK_CAPTURE_HERE);
 }
 
 void TVMFFIErrorSetRaised(TVMFFIObjectHandle error) {
@@ -58,4 +128,19 @@ TVMFFIObjectHandle TVMFFIErrorCreate(const TVMFFIByteArray* kind, const TVMFFIBy
             litetvm::ffi::details::ObjectUnsafe::MoveObjectRefToTVMFFIObjectPtr(std::move(error));
     return out;
     TVM_FFI_LOG_EXCEPTION_CALL_END(TVMFFIErrorCreate);
-}
\ No newline at end of file
+}
+
+TVMFFIObjectHandle TVMFFIErrorCreateWithCapture(const TVMFFIByteArray* kind, const TVMFFIByteArray* message,
+                                                void* const* pcs, int num_frames, const char* filename,
+                                                int lineno, const char* func) {
+    TVM_FFI_LOG_EXCEPTION_CALL_BEGIN();
+    auto error = litetvm::ffi::make_object<litetvm::ffi::details::ErrorObjFromCapture>(
+            std::string(kind->data, kind->size), std::string(message->data, message->size),
+            std::vector<void*>(pcs, pcs + num_frames), filename, lineno, func);
+    return litetvm::ffi::details::ObjectUnsafe::MoveObjectPtrToTVMFFIObjectPtr(std::move(error));
+    TVM_FFI_LOG_EXCEPTION_CALL_END(TVMFFIErrorCreateWithCapture);
+}
+
+void TVMFFIErrorResolveTraceback(TVMFFIObjectHandle error) {
+    litetvm::ffi::details::ErrorObjFromCapture::ResolveTraceback(error);
+}
@@ -75,7 +75,7 @@ public:
 };
 
 void TestRaiseError(String kind, String msg) {
-    throw ffi::Error(kind, msg, TVM_FFI_TRACEBACK_HERE);
+    throw ffi::Error(kind, msg, TVM_FFI_TRACEBACK_CAPTURE_HERE);
 }
 
 void TestApply(Function f, PackedArgs args, Any* ret) { f.CallPacked(args, ret); }
@@ -13,21 +13,142 @@
 #include "ffi/memory.h"
 #include "ffi/reflection/registry.h"
 #include "ffi/string.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 namespace litetvm {
 namespace ffi {
 
+namespace {
+
 /*!
- * \brief Global function table.
+ * \brief Epoch based reclamation of objects that lock-free readers may still hold.
  *
- * \note We do not use mutex to guard updating of GlobalFunctionTable
+ *  A reader publishes the global epoch in its thread record for the length
+ *  of a read, see Guard. A writer unlinks an object, retires it with the
+ *  current epoch and advances the epoch. The object is freed once every
+ *  reader is either idle or inside a later epoch, as those readers can only
+ *  have seen what replaced it.
+ */
+class EpochManager {
+    struct Record;
+
+public:
+    /*! \brief Read side critical section of the calling thread, wait-free. */
+    class Guard {
+    public:
+        explicit Guard(EpochManager* manager) : record_(manager->LocalRecord()) {
+            record_->epoch.store(manager->epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            // order the announcement before the loads of the protected pointers
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        ~Guard() {
+            record_->epoch.store(0, std::memory_order_release);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        Record* record_;
+    };
+
+    /*!
+     * \brief Retire an object that was just unlinked, the caller holds the writer lock.
+     * \param deleter Frees the object.
+     */
+    void Retire(std::function<void()> deleter) {
+        uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+        retired_.emplace_back(epoch, std::move(deleter));
+        Reclaim();
+    }
+
+private:
+    struct Record {
+        // the epoch of the running read, 0 when idle
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> in_use{false};
+        Record* next{nullptr};
+    };
+
+    // Hands the record of a thread back for reuse when the thread exits.
+    struct RecordOwner {
+        Record* record{nullptr};
+        ~RecordOwner() {
+            if (record != nullptr) record->in_use.store(false, std::memory_order_release);
+        }
+    };
+
+    Record* LocalRecord() {
+        thread_local RecordOwner owner;
+        if (owner.record == nullptr) owner.record = AcquireRecord();
+        return owner.record;
+    }
+
+    Record* AcquireRecord() {
+        for (Record* r = records_.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+            bool expected = false;
+            if (!r->in_use.load(std::memory_order_relaxed) &&
+                r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return r;
+            }
+        }
+        // records are never freed, a thread that exits leaves its record for the next one
+        auto* r = new Record();
+        r->in_use.store(true, std::memory_order_relaxed);
+        Record* head = records_.load(std::memory_order_relaxed);
+        do {
+            r->next = head;
+        } while (!records_.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+        return r;
+    }
+
+    // Free the retired objects no reader can still hold.
+    void Reclaim() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t oldest = std::numeric_limits<uint64_t>::max();
+        for (Record* r = records_.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+            uint64_t epoch = r->epoch.load(std::memory_order_seq_cst);
+            if (epoch != 0) oldest = std::min(oldest, epoch);
+        }
+        auto it = std::partition(retired_.begin(), retired_.end(),
+                                 [oldest](const auto& item) { return item.first >= oldest; });
+        std::vector<std::pair<uint64_t, std::function<void()>>> freed(std::make_move_iterator(it),
+                                                                      std::make_move_iterator(retired_.end()));
+        retired_.erase(it, retired_.end());
+        for (auto& item: freed) item.second();
+    }
+
+    // starts at 1 so that 0 marks an idle record
+    std::atomic<uint64_t> epoch_{1};
+    std::atomic<Record*> records_{nullptr};
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+};
+
+}// namespace
+
+/*!
+ * \brief Global function table.
  *
- * The assumption is that updating of GlobalFunctionTable will be done
- * in the main thread during initialization or loading, or
- * explicitly locked from the caller.
+ *  Lookups are wait-free and safe against concurrent registration and
+ *  removal, which are serialized by a mutex.
  *
- * Then the followup code will leverage the information
+ *  Every name that is registered, or interned through a FunctionHandle,
+ *  owns a Slot that lives until program exit, so the address of a slot is
+ *  a stable handle of the name that can be resolved without hashing.
+ *  Slots are indexed by an open addressing table of atomic pointers that is
+ *  replaced wholesale when it grows, and updating a name swaps the entry of
+ *  its slot. Replaced tables and entries are freed through EpochManager.
  */
 class GlobalFunctionTable {
 public:
@@ -64,47 +185,86 @@ public:
         }
     };
 
+    /*! \brief The interned state of one name. */
+    struct Slot : public TVMFFIGlobalSlot {
+        std::string name_data;
+        size_t hash;
+        // the registered entry holding one reference, nullptr when unregistered
+        std::atomic<Entry*> entry{nullptr};
+
+        Slot(std::string_view key, size_t key_hash) : name_data(key), hash(key_hash) {
+            this->name = TVMFFIByteArray{name_data.data(), name_data.size()};
+        }
+    };
+
     void Update(const String& name, const Function& func, bool can_override) {
-        if (table_.count(name)) {
-            if (!can_override) {
-                TVM_FFI_THROW(RuntimeError) << "Global Function `" << name << "` is already registered";
-            }
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot* slot = Intern(std::string_view(name.data(), name.size()));
+        if (slot->entry.load(std::memory_order_relaxed) != nullptr && !can_override) {
+            TVM_FFI_THROW(RuntimeError) << "Global Function `" << name << "` is already registered";
         }
-        table_.Set(name, ObjectRef(make_object<Entry>(name, func)));
+        Publish(slot, make_object<Entry>(name, func));
     }
 
     void Update(const TVMFFIMethodInfo* method_info, bool can_override) {
-        String name(method_info->name.data, method_info->name.size);
-        if (table_.count(name)) {
-            if (!can_override) {
-                TVM_FFI_LOG_AND_THROW(RuntimeError)
-                        << "Global Function `" << name << "` is already registered, possible causes:\n"
-                        << "- Two GlobalDef().def registrations for the same function \n"
-                        << "Please remove the duplicate registration.";
-            }
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string_view name(method_info->name.data, method_info->name.size);
+        Slot* slot = Intern(name);
+        if (slot->entry.load(std::memory_order_relaxed) != nullptr && !can_override) {
+            TVM_FFI_LOG_AND_THROW(RuntimeError)
+                    << "Global Function `" << name << "` is already registered, possible causes:\n"
+                    << "- Two GlobalDef().def registrations for the same function \n"
+                    << "Please remove the duplicate registration.";
         }
-        table_.Set(name, ObjectRef(make_object<Entry>(method_info)));
+        Publish(slot, make_object<Entry>(method_info));
     }
 
     bool Remove(const String& name) {
-        auto it = table_.find(name);
-        if (it == table_.end()) return false;
-        table_.erase(name);
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot* slot = Find(std::string_view(name.data(), name.size()));
+        if (slot == nullptr || slot->entry.load(std::memory_order_relaxed) == nullptr) return false;
+        Publish(slot, nullptr);
         return true;
     }
 
-    const Entry* Get(const String& name) {
-        auto it = table_.find(name);
-        if (it == table_.end()) return nullptr;
-        const auto* obj = (*it).second.cast<const Object*>();
-        return static_cast<const Entry*>(obj);
+    /*!
+     * \brief Get the function registered under name, wait-free.
+     * \return Whether the name is registered.
+     */
+    bool Get(std::string_view name, Function* out) {
+        EpochManager::Guard guard(&epochs_);
+        Slot* slot = Find(name);
+        return slot != nullptr && Load(slot, out);
     }
 
-    NODISCARD Array<String> ListNames() const {
+    /*!
+     * \brief Get the function registered in a slot, wait-free.
+     * \return Whether the name of the slot is registered.
+     */
+    bool Get(const Slot* slot, Function* out) {
+        EpochManager::Guard guard(&epochs_);
+        return Load(slot, out);
+    }
+
+    /*! \brief The slot of name, created when the name was never seen. */
+    const Slot* GetSlot(std::string_view name) {
+        {
+            EpochManager::Guard guard(&epochs_);
+            if (Slot* slot = Find(name)) return slot;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        return Intern(name);
+    }
+
+    NODISCARD Array<String> ListNames() {
         Array<String> names;
-        names.reserve(table_.size());
-        for (const auto& kv: table_) {
-            names.push_back(kv.first);
+        EpochManager::Guard guard(&epochs_);
+        const Table* table = table_.load(std::memory_order_acquire);
+        for (size_t i = 0; i <= table->mask; ++i) {
+            Slot* slot = table->cells[i].load(std::memory_order_acquire);
+            if (slot != nullptr && slot->entry.load(std::memory_order_acquire) != nullptr) {
+                names.push_back(String(slot->name_data));
+            }
         }
         return names;
     }
@@ -121,10 +281,84 @@ public:
     }
 
 private:
-    GlobalFunctionTable() = default;
+    // Open addressing table of slots with linear probing, cells only go from nullptr to a slot.
+    struct Table {
+        explicit Table(size_t capacity) : mask(capacity - 1), cells(new std::atomic<Slot*>[capacity]) {
+            for (size_t i = 0; i < capacity; ++i) cells[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        size_t mask;
+        size_t size{0};
+        std::unique_ptr<std::atomic<Slot*>[]> cells;
+    };
+
+    static constexpr size_t kInitialCapacity = 1024;
+
+    GlobalFunctionTable() : table_(new Table(kInitialCapacity)) {}
 
-    // deliberately track the function pointer without recycling to avoid
-    Map<String, Any> table_;
+    static size_t Hash(std::string_view name) {
+        return std::hash<std::string_view>()(name);
+    }
+
+    // Find the slot of name, the caller is a reader or holds the lock.
+    Slot* Find(std::string_view name) const {
+        const size_t hash = Hash(name);
+        const Table* table = table_.load(std::memory_order_acquire);
+        for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+            Slot* slot = table->cells[i].load(std::memory_order_acquire);
+            if (slot == nullptr) return nullptr;
+            if (slot->hash == hash && slot->name_data == name) return slot;
+        }
+    }
+
+    static bool Load(const Slot* slot, Function* out) {
+        Entry* entry = slot->entry.load(std::memory_order_acquire);
+        if (entry == nullptr) return false;
+        *out = entry->func_data;
+        return true;
+    }
+
+    static void Insert(Table* table, Slot* slot) {
+        size_t i = slot->hash & table->mask;
+        while (table->cells[i].load(std::memory_order_relaxed) != nullptr) i = (i + 1) & table->mask;
+        table->cells[i].store(slot, std::memory_order_release);
+        ++table->size;
+    }
+
+    // The slot of name, created if missing, the caller holds the lock.
+    Slot* Intern(std::string_view name) {
+        if (Slot* slot = Find(name)) return slot;
+        Table* table = table_.load(std::memory_order_relaxed);
+        // keep the load factor under a half so probes stay short
+        if ((table->size + 1) * 2 > table->mask + 1) {
+            auto* grown = new Table((table->mask + 1) * 2);
+            for (size_t i = 0; i <= table->mask; ++i) {
+                if (Slot* slot = table->cells[i].load(std::memory_order_relaxed)) Insert(grown, slot);
+            }
+            table_.store(grown, std::memory_order_seq_cst);
+            epochs_.Retire([table] { delete table; });
+            table = grown;
+        }
+        auto* slot = new Slot(name, Hash(name));
+        Insert(table, slot);
+        return slot;
+    }
+
+    // Swap the entry of a slot, the caller holds the lock.
+    void Publish(Slot* slot, ObjectPtr<Entry> entry) {
+        Entry* raw = entry == nullptr
+                             ? nullptr
+                             : details::ObjectUnsafe::RawObjectPtrFromUnowned<Entry>(
+                                       details::ObjectUnsafe::MoveObjectPtrToTVMFFIObjectPtr(std::move(entry)));
+        Entry* old = slot->entry.exchange(raw, std::memory_order_seq_cst);
+        if (old != nullptr) {
+            epochs_.Retire([old] { details::ObjectUnsafe::DecRefObjectHandle(old); });
+        }
+    }
+
+    std::mutex mutex_;
+    EpochManager epochs_;
+    std::atomic<Table*> table_;
 };
 
 }// namespace ffi
@@ -163,10 +397,27 @@ int TVMFFIFunctionSetGlobalFromMethodInfo(const TVMFFIMethodInfo* method_info, i
 int TVMFFIFunctionGetGlobal(const TVMFFIByteArray* name, TVMFFIObjectHandle* out) {
     using namespace litetvm::ffi;
     TVM_FFI_SAFE_CALL_BEGIN();
-    String name_str(name->data, name->size);
-    const GlobalFunctionTable::Entry* fp = GlobalFunctionTable::Global()->Get(name_str);
-    if (fp != nullptr) {
-        Function func(fp->func_data);
+    Function func;
+    if (GlobalFunctionTable::Global()->Get(std::string_view(name->data, name->size), &func)) {
+        *out = details::ObjectUnsafe::MoveObjectRefToTVMFFIObjectPtr(std::move(func));
+    } else {
+        *out = nullptr;
+    }
+    TVM_FFI_SAFE_CALL_END();
+}
+
+int TVMFFIFunctionGetGlobalSlot(const TVMFFIByteArray* name, const TVMFFIGlobalSlot** out) {
+    using namespace litetvm::ffi;
+    TVM_FFI_SAFE_CALL_BEGIN();
+    *out = GlobalFunctionTable::Global()->GetSlot(std::string_view(name->data, name->size));
+    TVM_FFI_SAFE_CALL_END();
+}
+
+int TVMFFIFunctionGetGlobalFromSlot(const TVMFFIGlobalSlot* slot, TVMFFIObjectHandle* out) {
+    using namespace litetvm::ffi;
+    TVM_FFI_SAFE_CALL_BEGIN();
+    Function func;
+    if (GlobalFunctionTable::Global()->Get(static_cast<const GlobalFunctionTable::Slot*>(slot), &func)) {
         *out = details::ObjectUnsafe::MoveObjectRefToTVMFFIObjectPtr(std::move(func));
     } else {
         *out = nullptr;
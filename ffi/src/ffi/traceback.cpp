@@ -11,11 +11,18 @@
 
 #include <backtrace.h>
 #include <cxxabi.h>
+#include <unwind.h>
 
 #include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #if TVM_FFI_BACKTRACE_ON_SEGFAULT
 #include <csignal>
@@ -64,9 +71,15 @@ void BacktraceSyminfoCallback(void* data, uintptr_t pc, const char* symname, uin
     }
 }
 
-int BacktraceFullCallback(void* data, uintptr_t pc, const char* filename, int lineno,
-                          const char* symbol) {
-    auto stack_trace = reinterpret_cast<TracebackStorage*>(data);
+/*! \brief One source frame of a program counter, calls inlined at the counter give several. */
+struct SymbolFrame {
+    std::optional<std::string> filename;
+    std::string symbol;
+    int lineno;
+};
+
+int BacktracePCInfoCallback(void* data, uintptr_t pc, const char* filename, int lineno, const char* symbol) {
+    auto* frames = static_cast<std::vector<SymbolFrame>*>(data);
     std::string symbol_str = "<unknown>";
     if (symbol) {
         symbol_str = DemangleName(symbol);
@@ -74,36 +87,105 @@ int BacktraceFullCallback(void* data, uintptr_t pc, const char* filename, int li
         // see if syminfo gives anything
         backtrace_syminfo(_bt_state, pc, BacktraceSyminfoCallback, BacktraceErrorCallback, &symbol_str);
     }
-    symbol = symbol_str.data();
+    frames->push_back({filename ? std::optional<std::string>(filename) : std::nullopt, std::move(symbol_str), lineno});
+    return 0;
+}
+
+/*!
+ * \brief Source frames of program counters, shared by all tracebacks.
+ *
+ *  Entries are never evicted, they are bounded by the code that raises errors.
+ */
+class SymbolCache {
+public:
+    const std::vector<SymbolFrame>& Lookup(uintptr_t pc) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = frames_.find(pc);
+            if (it != frames_.end()) return it->second;
+        }
+        std::vector<SymbolFrame> frames;
+        {
+            // libbacktrace eats memory if run on multiple threads at the same time, so we guard against it
+            std::lock_guard<std::mutex> lock(backtrace_mutex_);
+            backtrace_pcinfo(_bt_state, pc, BacktracePCInfoCallback, BacktraceErrorCallback, &frames);
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        // nodes of unordered_map stay in place on rehash, so the entry outlives the lock
+        return frames_.emplace(pc, std::move(frames)).first->second;
+    }
 
-    if (stack_trace->ExceedTracebackLimit()) {
-        return 1;
+    static SymbolCache* Global() {
+        // NOTE: explicitly use new to avoid exit-time destruction of global state
+        static auto* inst = new SymbolCache();
+        return inst;
     }
-    if (ShouldStopTraceback(filename, symbol)) {
-        return 1;
+
+private:
+    std::shared_mutex mutex_;
+    std::mutex backtrace_mutex_;
+    std::unordered_map<uintptr_t, std::vector<SymbolFrame>> frames_;
+};
+
+struct UnwindState {
+    void** pcs;
+    int max_frames;
+    int num_frames;
+};
+
+_Unwind_Reason_Code UnwindCallback(_Unwind_Context* context, void* data) {
+    auto* state = static_cast<UnwindState*>(data);
+    int ip_before_insn = 0;
+    uintptr_t pc = _Unwind_GetIPInfo(context, &ip_before_insn);
+    if (pc == 0) {
+        return _URC_NO_REASON;
     }
-    if (ShouldExcludeFrame(filename, symbol)) {
+    // point into the call instruction rather than at its return address
+    if (!ip_before_insn) {
+        --pc;
+    }
+    state->pcs[state->num_frames++] = reinterpret_cast<void*>(pc);
+    return state->num_frames < state->max_frames ? _URC_NO_REASON : _URC_END_OF_STACK;
+}
+
+// Capture the program counters of the calling stack, _Unwind_Backtrace takes no lock of ours.
+int CaptureStack(void** pcs, int max_frames) {
+    if (max_frames <= 0) {
         return 0;
     }
-    stack_trace->Append(filename, symbol, lineno);
-    return 0;
+    UnwindState state{pcs, max_frames, 0};
+    _Unwind_Backtrace(UnwindCallback, &state);
+    return state.num_frames;
 }
 
-std::string Traceback() {
+std::string SymbolizeStack(void* const* pcs, int num_frames) {
     TracebackStorage traceback;
 
     if (_bt_state == nullptr) {
         return "";
     }
-    // libbacktrace eats memory if run on multiple threads at the same time, so we guard against it
-    {
-        static std::mutex m;
-        std::lock_guard<std::mutex> lock(m);
-        backtrace_full(_bt_state, 0, BacktraceFullCallback, BacktraceErrorCallback, &traceback);
+    SymbolCache* cache = SymbolCache::Global();
+    for (int i = 0; i < num_frames; ++i) {
+        for (const SymbolFrame& frame: cache->Lookup(reinterpret_cast<uintptr_t>(pcs[i]))) {
+            const char* filename = frame.filename ? frame.filename->c_str() : nullptr;
+            const char* symbol = frame.symbol.c_str();
+            if (traceback.ExceedTracebackLimit() || ShouldStopTraceback(filename, symbol)) {
+                return traceback.GetTraceback();
+            }
+            if (ShouldExcludeFrame(filename, symbol)) {
+                continue;
+            }
+            traceback.Append(filename, symbol, frame.lineno);
+        }
     }
     return traceback.GetTraceback();
 }
 
+std::string Traceback() {
+    void* pcs[details::TracebackCapture::kMaxFrames];
+    return SymbolizeStack(pcs, CaptureStack(pcs, details::TracebackCapture::kMaxFrames));
+}
+
 #if TVM_FFI_BACKTRACE_ON_SEGFAULT
 void backtrace_handler(int sig) {
     // Technically we shouldn't do any allocation in a signal handler, but
@@ -138,6 +220,19 @@ const TVMFFIByteArray* TVMFFITraceback(const char*, int, const char*) {
     traceback_array.size = traceback_str.size();
     return &traceback_array;
 }
+
+int TVMFFITracebackCapture(void** pcs, int max_frames) {
+    return ::litetvm::ffi::CaptureStack(pcs, max_frames);
+}
+
+const TVMFFIByteArray* TVMFFITracebackSymbolize(void* const* pcs, int num_frames, const char*, int, const char*) {
+    thread_local std::string traceback_str;
+    thread_local TVMFFIByteArray traceback_array;
+    traceback_str = ::litetvm::ffi::SymbolizeStack(pcs, num_frames);
+    traceback_array.data = traceback_str.data();
+    traceback_array.size = traceback_str.size();
+    return &traceback_array;
+}
 #else
 // fallback implementation simply print out the last trace
 const TVMFFIByteArray* TVMFFITraceback(const char* filename, int lineno, const char* func) {
@@ -151,6 +246,16 @@ const TVMFFIByteArray* TVMFFITraceback(const char* filename, int lineno, const c
     traceback_array.size = traceback_str.size();
     return &traceback_array;
 }
+
+// without libbacktrace nothing is captured and the traceback is the capture site
+int TVMFFITracebackCapture(void**, int) {
+    return 0;
+}
+
+const TVMFFIByteArray* TVMFFITracebackSymbolize(void* const*, int, const char* filename, int lineno,
+                                                const char* func) {
+    return TVMFFITraceback(filename, lineno, func);
+}
 #endif// TVM_FFI_USE_LIBBACKTRACE
 
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+//
+// Created by 赵丹 on 25-8-22.
+//
+// Boxing values into Any and converting them back:
+//   ./ffi_bench --benchmark_filter=Any
+//
+#include "ffi/any.h"
+#include "ffi/container/array.h"
+#include "ffi/string.h"
+
+#include <benchmark/benchmark.h>
+
+#include <any>
+#include <string>
+
+namespace {
+using namespace litetvm::ffi;
+
+void BM_AnyFromInt(benchmark::State& state) {
+    int64_t x = 42;
+    for (auto _: state) {
+        Any a = x;
+        benchmark::DoNotOptimize(a);
+    }
+}
+BENCHMARK(BM_AnyFromInt);
+
+void BM_AnyFromInt_StdAny(benchmark::State& state) {
+    int64_t x = 42;
+    for (auto _: state) {
+        std::any a = x;
+        benchmark::DoNotOptimize(a);
+    }
+}
+BENCHMARK(BM_AnyFromInt_StdAny);
+
+void BM_AnyCastInt(benchmark::State& state) {
+    Any a = 42;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a.cast<int64_t>());
+    }
+}
+BENCHMARK(BM_AnyCastInt);
+
+void BM_AnyCastInt_StdAny(benchmark::State& state) {
+    std::any a = int64_t(42);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(std::any_cast<int64_t>(a));
+    }
+}
+BENCHMARK(BM_AnyCastInt_StdAny);
+
+// as<> only succeeds on an exact type match
+void BM_AnyAsInt(benchmark::State& state) {
+    Any a = 42;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a.as<int64_t>());
+    }
+}
+BENCHMARK(BM_AnyAsInt);
+
+// try_cast converts, here from int to float
+void BM_AnyTryCastIntToDouble(benchmark::State& state) {
+    Any a = 42;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a.try_cast<double>());
+    }
+}
+BENCHMARK(BM_AnyTryCastIntToDouble);
+
+void BM_AnyFromObject(benchmark::State& state) {
+    Array<int> arr{1, 2, 3};
+    for (auto _: state) {
+        Any a = arr;
+        benchmark::DoNotOptimize(a);
+    }
+}
+BENCHMARK(BM_AnyFromObject);
+
+void BM_AnyCastObject(benchmark::State& state) {
+    Any a = Array<int>{1, 2, 3};
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a.cast<Array<int>>());
+    }
+}
+BENCHMARK(BM_AnyCastObject);
+
+// small strings are stored inline, large ones as a StringObj
+void BM_AnyCastString(benchmark::State& state) {
+    Any a = String(std::string(state.range(0), 'x'));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a.cast<String>());
+    }
+}
+BENCHMARK(BM_AnyCastString)->Arg(4)->Arg(64);
+
+void BM_AnyViewFromObject(benchmark::State& state) {
+    Array<int> arr{1, 2, 3};
+    for (auto _: state) {
+        AnyView a = arr;
+        benchmark::DoNotOptimize(a);
+    }
+}
+BENCHMARK(BM_AnyViewFromObject);
+
+}// namespace
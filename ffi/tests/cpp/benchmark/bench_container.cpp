@@ -0,0 +1,181 @@
+//
+// Created by 赵丹 on 25-8-22.
+//
+// Array and Map operations against their std counterparts:
+//   ./ffi_bench --benchmark_filter='Array|Map'
+//
+// The argument is the number of elements.
+//
+#include "ffi/container/array.h"
+#include "ffi/container/map.h"
+#include "ffi/string.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+using namespace litetvm::ffi;
+
+void BM_ArrayPushBack(benchmark::State& state) {
+    for (auto _: state) {
+        Array<int> arr;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            arr.push_back(static_cast<int>(i));
+        }
+        benchmark::DoNotOptimize(arr);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ArrayPushBack)->Arg(16)->Arg(1024);
+
+void BM_ArrayPushBack_StdVector(benchmark::State& state) {
+    for (auto _: state) {
+        std::vector<int> arr;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            arr.push_back(static_cast<int>(i));
+        }
+        benchmark::DoNotOptimize(arr);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ArrayPushBack_StdVector)->Arg(16)->Arg(1024);
+
+void BM_ArrayGet(benchmark::State& state) {
+    Array<int> arr;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        arr.push_back(static_cast<int>(i));
+    }
+    for (auto _: state) {
+        int64_t sum = 0;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            sum += arr[i];
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ArrayGet)->Arg(1024);
+
+// Set on a uniquely owned array mutates in place
+void BM_ArraySetUnique(benchmark::State& state) {
+    Array<int> arr;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        arr.push_back(static_cast<int>(i));
+    }
+    for (auto _: state) {
+        arr.Set(0, 1);
+        benchmark::DoNotOptimize(arr);
+    }
+}
+BENCHMARK(BM_ArraySetUnique)->Arg(1024);
+
+// Set on a shared array copies it first
+void BM_ArraySetCopyOnWrite(benchmark::State& state) {
+    Array<int> arr;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        arr.push_back(static_cast<int>(i));
+    }
+    for (auto _: state) {
+        Array<int> copy = arr;
+        copy.Set(0, 1);
+        benchmark::DoNotOptimize(copy);
+    }
+}
+BENCHMARK(BM_ArraySetCopyOnWrite)->Arg(16)->Arg(1024);
+
+void BM_MapInsert(benchmark::State& state) {
+    for (auto _: state) {
+        Map<int, int> map;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            map.Set(static_cast<int>(i), static_cast<int>(i));
+        }
+        benchmark::DoNotOptimize(map);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapInsert)->Arg(4)->Arg(1024);
+
+void BM_MapInsert_StdUnorderedMap(benchmark::State& state) {
+    for (auto _: state) {
+        std::unordered_map<int, int> map;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            map[static_cast<int>(i)] = static_cast<int>(i);
+        }
+        benchmark::DoNotOptimize(map);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapInsert_StdUnorderedMap)->Arg(4)->Arg(1024);
+
+void BM_MapLookup(benchmark::State& state) {
+    Map<int, int> map;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        map.Set(static_cast<int>(i), static_cast<int>(i));
+    }
+    for (auto _: state) {
+        int64_t sum = 0;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            sum += map.at(static_cast<int>(i));
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapLookup)->Arg(4)->Arg(1024);
+
+void BM_MapLookup_StdUnorderedMap(benchmark::State& state) {
+    std::unordered_map<int, int> map;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        map[static_cast<int>(i)] = static_cast<int>(i);
+    }
+    for (auto _: state) {
+        int64_t sum = 0;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            sum += map.at(static_cast<int>(i));
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapLookup_StdUnorderedMap)->Arg(4)->Arg(1024);
+
+void BM_MapLookupString(benchmark::State& state) {
+    Map<String, int> map;
+    std::vector<String> keys;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        keys.emplace_back("key_" + std::to_string(i));
+        map.Set(keys.back(), static_cast<int>(i));
+    }
+    for (auto _: state) {
+        int64_t sum = 0;
+        for (const String& key: keys) {
+            sum += map.at(key);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapLookupString)->Arg(1024);
+
+void BM_MapLookupString_StdUnorderedMap(benchmark::State& state) {
+    std::unordered_map<std::string, int> map;
+    std::vector<std::string> keys;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        keys.emplace_back("key_" + std::to_string(i));
+        map[keys.back()] = static_cast<int>(i);
+    }
+    for (auto _: state) {
+        int64_t sum = 0;
+        for (const std::string& key: keys) {
+            sum += map.at(key);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapLookupString_StdUnorderedMap)->Arg(1024);
+
+}// namespace
@@ -0,0 +1,130 @@
+//
+// Created by 赵丹 on 25-8-20.
+//
+// Construction and call cost of ffi::Function for capture-light callbacks:
+//   ./ffi_bench --benchmark_filter=Function
+//
+// SimpleAlloc builds the same function object with make_object, the
+// allocation FromPacked/FromTyped did before they went through the pool.
+//
+#include "ffi/function.h"
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+
+namespace {
+using namespace litetvm::ffi;
+
+int AddOne(int x) { return x + 1; }
+
+auto MakePacked(int offset) {
+    return [offset](const AnyView* args, int32_t, Any* rv) { *rv = args[0].cast<int>() + offset; };
+}
+
+Function MakeSimpleAlloc(int offset) {
+    using ObjType = details::FunctionObjImpl<decltype(MakePacked(offset))>;
+    return Function(ObjectPtr<Object>(make_object<ObjType>(MakePacked(offset))));
+}
+
+void BM_FunctionCreate_StdFunction(benchmark::State& state) {
+    int offset = 1;
+    for (auto _: state) {
+        std::function<int(int)> f = [offset](int x) { return x + offset; };
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(BM_FunctionCreate_StdFunction);
+
+void BM_FunctionCreate_SimpleAlloc(benchmark::State& state) {
+    for (auto _: state) {
+        Function f = MakeSimpleAlloc(1);
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(BM_FunctionCreate_SimpleAlloc);
+
+void BM_FunctionCreate_FromPacked(benchmark::State& state) {
+    for (auto _: state) {
+        Function f = Function::FromPacked(MakePacked(1));
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(BM_FunctionCreate_FromPacked);
+
+void BM_FunctionCreate_FromTyped(benchmark::State& state) {
+    int offset = 1;
+    for (auto _: state) {
+        Function f = Function::FromTyped([offset](int x) { return x + offset; });
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(BM_FunctionCreate_FromTyped);
+
+void BM_FunctionCreate_FromTypedNamed(benchmark::State& state) {
+    int offset = 1;
+    for (auto _: state) {
+        Function f = Function::FromTyped([offset](int x) { return x + offset; }, "add_offset");
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(BM_FunctionCreate_FromTypedNamed);
+
+void BM_FunctionCreate_FromStatic(benchmark::State& state) {
+    for (auto _: state) {
+        Function f = Function::FromStatic<AddOne>();
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(BM_FunctionCreate_FromStatic);
+
+// create, call once and drop, the life of a per-request callback
+void BM_FunctionCreateAndCall_SimpleAlloc(benchmark::State& state) {
+    int x = 0;
+    for (auto _: state) {
+        x = MakeSimpleAlloc(1)(x).cast<int>();
+    }
+    benchmark::DoNotOptimize(x);
+}
+BENCHMARK(BM_FunctionCreateAndCall_SimpleAlloc);
+
+void BM_FunctionCreateAndCall_FromPacked(benchmark::State& state) {
+    int x = 0;
+    for (auto _: state) {
+        x = Function::FromPacked(MakePacked(1))(x).cast<int>();
+    }
+    benchmark::DoNotOptimize(x);
+}
+BENCHMARK(BM_FunctionCreateAndCall_FromPacked);
+
+void BM_FunctionCall_StdFunction(benchmark::State& state) {
+    std::function<int(int)> f = AddOne;
+    int x = 0;
+    for (auto _: state) {
+        x = f(x);
+        benchmark::DoNotOptimize(x);
+    }
+}
+BENCHMARK(BM_FunctionCall_StdFunction);
+
+void BM_FunctionCall_FromTyped(benchmark::State& state) {
+    Function f = Function::FromTyped(AddOne);
+    int x = 0;
+    for (auto _: state) {
+        x = f(x).cast<int>();
+        benchmark::DoNotOptimize(x);
+    }
+}
+BENCHMARK(BM_FunctionCall_FromTyped);
+
+void BM_FunctionCall_FromStatic(benchmark::State& state) {
+    Function f = Function::FromStatic<AddOne>();
+    int x = 0;
+    for (auto _: state) {
+        x = f(x).cast<int>();
+        benchmark::DoNotOptimize(x);
+    }
+}
+BENCHMARK(BM_FunctionCall_FromStatic);
+
+}// namespace
@@ -0,0 +1,99 @@
+//
+// Created by 赵丹 on 25-8-22.
+//
+// String construction, concatenation and comparison against std::string:
+//   ./ffi_bench --benchmark_filter=String
+//
+// The argument is the string length, 4 fits the small string buffer.
+//
+#include "ffi/string.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace {
+using namespace litetvm::ffi;
+
+void BM_StringFromCStr(benchmark::State& state) {
+    std::string src(state.range(0), 'x');
+    for (auto _: state) {
+        String s(src.c_str());
+        benchmark::DoNotOptimize(s);
+    }
+}
+BENCHMARK(BM_StringFromCStr)->Arg(4)->Arg(64)->Arg(4096);
+
+void BM_StringFromCStr_StdString(benchmark::State& state) {
+    std::string src(state.range(0), 'x');
+    for (auto _: state) {
+        std::string s(src.c_str());
+        benchmark::DoNotOptimize(s);
+    }
+}
+BENCHMARK(BM_StringFromCStr_StdString)->Arg(4)->Arg(64)->Arg(4096);
+
+void BM_StringFromStdString(benchmark::State& state) {
+    std::string src(state.range(0), 'x');
+    for (auto _: state) {
+        String s(src);
+        benchmark::DoNotOptimize(s);
+    }
+}
+BENCHMARK(BM_StringFromStdString)->Arg(4)->Arg(64)->Arg(4096);
+
+void BM_StringCopy(benchmark::State& state) {
+    String src(std::string(state.range(0), 'x'));
+    for (auto _: state) {
+        String s = src;
+        benchmark::DoNotOptimize(s);
+    }
+}
+BENCHMARK(BM_StringCopy)->Arg(4)->Arg(64);
+
+void BM_StringCopy_StdString(benchmark::State& state) {
+    std::string src(state.range(0), 'x');
+    for (auto _: state) {
+        std::string s = src;
+        benchmark::DoNotOptimize(s);
+    }
+}
+BENCHMARK(BM_StringCopy_StdString)->Arg(4)->Arg(64);
+
+void BM_StringConcat(benchmark::State& state) {
+    String a(std::string(state.range(0), 'x'));
+    String b(std::string(state.range(0), 'y'));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a + b);
+    }
+}
+BENCHMARK(BM_StringConcat)->Arg(2)->Arg(64);
+
+void BM_StringConcat_StdString(benchmark::State& state) {
+    std::string a(state.range(0), 'x');
+    std::string b(state.range(0), 'y');
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a + b);
+    }
+}
+BENCHMARK(BM_StringConcat_StdString)->Arg(2)->Arg(64);
+
+void BM_StringEqual(benchmark::State& state) {
+    String a(std::string(state.range(0), 'x'));
+    String b(std::string(state.range(0), 'x'));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a == b);
+    }
+}
+BENCHMARK(BM_StringEqual)->Arg(4)->Arg(64);
+
+void BM_StringEqual_StdString(benchmark::State& state) {
+    std::string a(state.range(0), 'x');
+    std::string b(state.range(0), 'x');
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a == b);
+    }
+}
+BENCHMARK(BM_StringEqual_StdString)->Arg(4)->Arg(64);
+
+}// namespace
@@ -0,0 +1,69 @@
+//
+// Created by 赵丹 on 25-8-21.
+//
+// Per-call overhead of TypedFunction across argument counts and types:
+//   ./ffi_bench --benchmark_filter=TypedCall
+//
+// Direct calls a function created by FromTyped with the same signature, which
+// skips packing. Packed calls the same function through ffi::Function, the
+// path TypedFunction takes when the signatures do not match.
+//
+#include "ffi/container/array.h"
+#include "ffi/function.h"
+#include "ffi/string.h"
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+
+namespace {
+using namespace litetvm::ffi;
+
+template<typename R, typename... Args, typename... CallArgs>
+void BM_TypedCall_Direct(benchmark::State& state, R (*fn)(Args...), CallArgs... args) {
+    TypedFunction<R(Args...)> f = Function::FromTyped(fn);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(f(args...));
+    }
+}
+
+template<typename R, typename... Args, typename... CallArgs>
+void BM_TypedCall_Packed(benchmark::State& state, R (*fn)(Args...), CallArgs... args) {
+    Function f = Function::FromTyped(fn);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(f(args...).template cast<R>());
+    }
+}
+
+template<typename R, typename... Args, typename... CallArgs>
+void BM_TypedCall_StdFunction(benchmark::State& state, R (*fn)(Args...), CallArgs... args) {
+    std::function<R(Args...)> f = fn;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(f(args...));
+    }
+}
+
+int Zero() { return 0; }
+int AddOne(int x) { return x + 1; }
+int Add2(int x, int y) { return x + y; }
+int Add4(int a, int b, int c, int d) { return a + b + c + d; }
+double Scale(double x, double y) { return x * y; }
+int64_t StringSize(const String& s) { return static_cast<int64_t>(s.size()); }
+int64_t ArraySize(const Array<int>& arr) { return arr.size(); }
+String Concat(String a, String b) { return a + b; }
+
+#define TVM_FFI_BENCH_TYPED_CALL(name, ...)                     \
+    BENCHMARK_CAPTURE(BM_TypedCall_Direct, name, __VA_ARGS__); \
+    BENCHMARK_CAPTURE(BM_TypedCall_Packed, name, __VA_ARGS__); \
+    BENCHMARK_CAPTURE(BM_TypedCall_StdFunction, name, __VA_ARGS__)
+
+TVM_FFI_BENCH_TYPED_CALL(Args0Int, Zero);
+TVM_FFI_BENCH_TYPED_CALL(Args1Int, AddOne, 1);
+TVM_FFI_BENCH_TYPED_CALL(Args2Int, Add2, 1, 2);
+TVM_FFI_BENCH_TYPED_CALL(Args4Int, Add4, 1, 2, 3, 4);
+TVM_FFI_BENCH_TYPED_CALL(Args2Double, Scale, 1.5, 2.0);
+TVM_FFI_BENCH_TYPED_CALL(Args1String, StringSize, String("a string that is not small"));
+TVM_FFI_BENCH_TYPED_CALL(Args1Array, ArraySize, Array<int>{1, 2, 3});
+TVM_FFI_BENCH_TYPED_CALL(Args2StringRet, Concat, String("ab"), String("cd"));
+
+}// namespace
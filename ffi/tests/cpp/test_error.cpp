@@ -7,6 +7,10 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace {
 using namespace litetvm::ffi;
 
@@ -61,4 +65,46 @@ TEST(Error, AnyConvert) {
     EXPECT_EQ(opt_err.value().message(), "here");
 }
 
+TEST(Error, LazyTraceback) {
+    auto raise = []() -> Error {
+        try {
+            ThrowRuntimeError();
+        } catch (const Error& error) {
+            return error;
+        }
+        return Error("RuntimeError", "not raised", "");
+    };
+    // every thread reads the traceback of its own error and of a shared one
+    Error shared = raise();
+    std::vector<std::string> tracebacks(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < tracebacks.size(); ++i) {
+        threads.emplace_back([&, i] {
+            Error own = raise();
+            EXPECT_EQ(own.kind(), "RuntimeError");
+            EXPECT_FALSE(own.traceback().empty());
+            tracebacks[i] = shared.traceback();
+        });
+    }
+    for (auto& t: threads) t.join();
+    for (const std::string& traceback: tracebacks) {
+        EXPECT_EQ(traceback, tracebacks[0]);
+    }
+    EXPECT_NE(std::string(shared.what()).find(tracebacks[0] + "RuntimeError: test0"), std::string::npos);
+
+    // an explicit traceback replaces the captured one
+    Error updated = raise();
+    TVMFFIByteArray traceback{"updated\n", 8};
+    updated.UpdateTraceback(&traceback);
+    EXPECT_EQ(updated.traceback(), "updated\n");
+}
+
+TEST(Error, CellLayout) {
+    // lazy tracebacks keep the C layout of the error cell
+    EXPECT_EQ(sizeof(TVMFFIErrorCell), 3 * sizeof(TVMFFIByteArray) + sizeof(void (*)()));
+    Error eager("RuntimeError", "eager", "given\n");
+    TVMFFIErrorResolveTraceback(details::ObjectUnsafe::TVMFFIObjectPtrFromObjectRef(eager));
+    EXPECT_EQ(eager.traceback(), "given\n");
+}
+
 }// namespace
\ No newline at end of file
@@ -10,6 +10,11 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace {
 using namespace litetvm::ffi;
 using namespace litetvm::ffi::testing;
@@ -154,6 +159,56 @@ TEST(Func, FromTyped) {
     EXPECT_EQ(fconcact("abc", "def").cast<String>(), "abcdef");
 }
 
+int StaticAddOne(int x) { return x + 1; }
+
+void StaticPackedSum(PackedArgs args, Any* rv) {
+    int sum = 0;
+    for (int i = 0; i < args.size(); ++i) {
+        sum += args[i].cast<int>();
+    }
+    *rv = sum;
+}
+
+TEST(Func, FromStatic) {
+    Function fadd_one = Function::FromStatic<StaticAddOne>();
+    EXPECT_EQ(fadd_one(1).cast<int>(), 2);
+    EXPECT_THROW(fadd_one(), Error);
+    // every call shares the same object, which outlives all references
+    EXPECT_EQ(fadd_one.get(), Function::FromStatic<StaticAddOne>().get());
+
+    Function fsum = Function::FromStatic<StaticPackedSum>();
+    EXPECT_EQ(fsum(1, 2, 3).cast<int>(), 6);
+    EXPECT_NE(fsum.get(), fadd_one.get());
+
+    // goes through the C ABI like any other function
+    Any rv;
+    AnyView args[1];
+    PackedArgs::Fill(args, 41);
+    TVMFFIAny* rv_raw = reinterpret_cast<TVMFFIAny*>(&rv);
+    EXPECT_EQ(TVMFFIFunctionCall(details::ObjectUnsafe::TVMFFIObjectPtrFromObjectRef(fadd_one), reinterpret_cast<TVMFFIAny*>(args), 1, rv_raw), 0);
+    EXPECT_EQ(rv.cast<int>(), 42);
+}
+
+TEST(Func, PooledClosures) {
+    // a released closure object is reused by the next one of the same size on the thread
+    const Object* first = Function::FromTyped([](int x) { return x; }).get();
+    Function f = Function::FromTyped([](int x) { return x * 2; });
+    EXPECT_EQ(f.get(), first);
+    EXPECT_EQ(f(3).cast<int>(), 6);
+
+    // closures released on another thread stay usable
+    std::vector<Function> funcs;
+    for (int i = 0; i < 16; ++i) {
+        funcs.push_back(Function::FromTyped([i](int x) { return x + i; }));
+    }
+    std::thread([funcs = std::move(funcs)]() mutable {
+        for (int i = 0; i < 16; ++i) {
+            EXPECT_EQ(funcs[i](1).cast<int>(), i + 1);
+        }
+        funcs.clear();
+    }).join();
+}
+
 TEST(Func, PassReturnAny) {
     Function fadd_one = Function::FromTyped([](Any a) -> Any { return a.cast<int>() + 1; });
     EXPECT_EQ(fadd_one(1).cast<int>(), 2);
@@ -173,6 +228,38 @@ TEST(Func, TypedFunction) {
     fcheck_int(1);
 }
 
+TEST(Func, TypedFunctionDirectCall) {
+    // exactly matching signature, the arguments are handed over without packing
+    TypedFunction<int(TInt, const String&)> fdirect = [](TInt x, const String& s) -> int {
+        return static_cast<int>(x->value + s.size());
+    };
+    EXPECT_NE(details::TypedFunctionObjBase<int(TInt, const String&)>::Cast(fdirect.packed().get()), nullptr);
+    EXPECT_EQ(fdirect(TInt(1), String("ab")), 3);
+    // moved all the way in, where packing would hold an extra reference
+    TypedFunction<int(TInt)> fuse_count = [](TInt x) -> int { return static_cast<int>(x.use_count()); };
+    EXPECT_EQ(fuse_count(TInt(1)), 1);
+    // the packed path of the same function still works
+    EXPECT_EQ(fdirect.packed()(TInt(1), "abc").cast<int>(), 4);
+
+    // different signature, falls back to packing and converting the arguments
+    TypedFunction<int64_t(int)> fconvert = Function::FromTyped([](int64_t a) -> int64_t { return a + 1; });
+    EXPECT_EQ(fconvert(1), 2);
+
+    // packed callee, falls back as well
+    TypedFunction<int(int)> fpacked =
+            Function::FromPacked([](PackedArgs args, Any* rv) { *rv = args[0].cast<int>() * 2; });
+    EXPECT_EQ(details::TypedFunctionObjBase<int(int)>::Cast(fpacked.packed().get()), nullptr);
+    EXPECT_EQ(fpacked(4), 8);
+
+    // errors propagate as from the packed call
+    TypedFunction<void(int)> fthrow = [](int) { TVM_FFI_THROW(ValueError) << "direct"; };
+    EXPECT_THROW(fthrow(1), Error);
+
+    TypedFunction<int(int)> fstatic = Function::FromStatic<StaticAddOne>();
+    EXPECT_NE(details::TypedFunctionObjBase<int(int)>::Cast(fstatic.packed().get()), nullptr);
+    EXPECT_EQ(fstatic(1), 2);
+}
+
 TEST(Func, Global) {
     Function::SetGlobal("testing.add1",
                         Function::FromTyped([](const int32_t& a) -> int { return a + 1; }));
@@ -192,6 +279,62 @@ TEST(Func, Global) {
     EXPECT_TRUE(std::find(names.begin(), names.end(), "testing.add1") != names.end());
 }
 
+TEST(Func, GlobalHandle) {
+    // the handle is resolved before the name is registered
+    FunctionHandle fmul("testing.handle_mul");
+    EXPECT_EQ(fmul.name(), "testing.handle_mul");
+    EXPECT_TRUE(!fmul.Get());
+    EXPECT_THROW(fmul.GetRequired(), Error);
+
+    Function::SetGlobal("testing.handle_mul", Function::FromTyped([](int a) { return a * 2; }));
+    EXPECT_EQ(fmul(3).cast<int>(), 6);
+    Function::SetGlobal("testing.handle_mul", Function::FromTyped([](int a) { return a * 3; }), true);
+    EXPECT_EQ(fmul(3).cast<int>(), 9);
+    EXPECT_EQ(FunctionHandle("testing.handle_mul")(3).cast<int>(), 9);
+
+    Function::RemoveGlobal("testing.handle_mul");
+    EXPECT_TRUE(!fmul.Get());
+    EXPECT_TRUE(!Function::GetGlobal("testing.handle_mul"));
+}
+
+TEST(Func, GlobalConcurrentRegistration) {
+    constexpr int kNumReaders = 4;
+    constexpr int kNumNames = 2000;
+    Function::SetGlobal("testing.concurrent_value", Function::FromTyped([]() { return 0; }), true);
+    FunctionHandle fvalue("testing.concurrent_value");
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < kNumReaders; ++t) {
+        readers.emplace_back([&] {
+            int last = 0;
+            while (!done.load()) {
+                // overrides only ever increase the value
+                int value = fvalue().cast<int>();
+                if (value < last) ++failures;
+                last = value;
+                if (!Function::GetGlobal("ffi.FunctionRemoveGlobal")) ++failures;
+            }
+        });
+    }
+    // registering many names grows the table under the readers
+    for (int i = 0; i < kNumNames; ++i) {
+        std::string name = "testing.concurrent." + std::to_string(i);
+        Function::SetGlobal(name, Function::FromTyped([i]() { return i; }));
+        Function::SetGlobal("testing.concurrent_value", Function::FromTyped([i]() { return i; }), true);
+    }
+    done.store(true);
+    for (auto& t: readers) t.join();
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(fvalue().cast<int>(), kNumNames - 1);
+    for (int i = 0; i < kNumNames; ++i) {
+        std::string name = "testing.concurrent." + std::to_string(i);
+        EXPECT_EQ(Function::GetGlobalRequired(name)().cast<int>(), i);
+        Function::RemoveGlobal(name);
+    }
+}
+
 TEST(Func, TypedFunctionAsAny) {
     TypedFunction<int(int)> fadd1 = [](int a) -> int { return a + 1; };
     Any fany(std::move(fadd1));
@@ -10,6 +10,7 @@
 #include "runtime/base.h"
 #include "runtime/logging.h"
 
+#include <array>
 #include <string>
 
 using TVMStreamHandle = void*;
@@ -53,6 +54,16 @@ enum DeviceAttrKind : int {
     kTotalGlobalMemory = 14,
     kAvailableGlobalMemory = 15,
     kImagePitchAlignment = 16,
+    /*!
+     * \brief Large page policy of big host allocations, settable:
+     *  0 = off, 1 = transparent huge pages, 2 = explicit hugetlbfs pages.
+     *  Off unless TVM_CPU_HUGEPAGE is set.
+     */
+    kHugePageMode = 17,
+    /*! \brief Allocations of at least this many bytes use the large page policy, settable. */
+    kHugePageThreshold = 18,
+    /*! \brief Size in bytes of a huge page of the system. */
+    kHugePageSize = 19,
 };
 
 #ifdef TVM_KALLOC_ALIGNMENT
@@ -76,6 +87,38 @@ constexpr int kMaxStackAlloca = 1024;
  * service intermediate tensors */
 constexpr int kDefaultWorkspaceAlignment = 1;
 
+/*!
+ * \brief Who asked for a block of device memory, see DeviceAPI::RecordAlloc.
+ */
+enum class DeviceMemoryKind : int {
+    /*! \brief Storage of an NDArray created by NDArray::Empty. */
+    kNDArray = 0,
+    /*! \brief Memory held by workspace pools and arenas. */
+    kWorkspace = 1,
+};
+
+/*!
+ * \brief Memory held on one device, see DeviceAPI::GetMemoryStats.
+ */
+struct DeviceMemoryStats {
+    /*! \brief Number of histogram buckets. */
+    static constexpr int kNumBuckets = 48;
+    /*! \brief Bytes currently allocated. */
+    int64_t current_bytes{0};
+    /*! \brief Highest value of current_bytes since the last reset. */
+    int64_t peak_bytes{0};
+    /*! \brief Number of allocations. */
+    int64_t alloc_count{0};
+    /*! \brief Number of frees. */
+    int64_t free_count{0};
+    /*! \brief Bytes currently held by NDArrays. */
+    int64_t ndarray_bytes{0};
+    /*! \brief Bytes currently held by workspace pools. */
+    int64_t workspace_bytes{0};
+    /*! \brief Bucket i counts allocations of [2^i, 2^(i+1)) bytes, bucket 0 also counts 0. */
+    std::array<int64_t, kNumBuckets> histogram{};
+};
+
 /*!
  *  \brief TVM Runtime Device API, abstracts the device
  *  specific interface for memory management.
@@ -246,6 +289,53 @@ public:
    */
     static DeviceAPI* Get(Device dev, bool allow_missing = false);
 
+    /*!
+   * \brief Account an allocation in the statistics of a device.
+   * \param dev The device.
+   * \param nbytes The size of the allocation.
+   * \param kind Who made the allocation.
+   */
+    TVM_DLL static void RecordAlloc(Device dev, size_t nbytes, DeviceMemoryKind kind);
+
+    /*!
+   * \brief Account the release of an allocation recorded with RecordAlloc.
+   * \param dev The device.
+   * \param nbytes The size of the allocation.
+   * \param kind Who made the allocation.
+   */
+    TVM_DLL static void RecordFree(Device dev, size_t nbytes, DeviceMemoryKind kind);
+
+    /*!
+   * \brief Get the allocation statistics of a device.
+   * \param dev The device.
+   * \return The statistics, all zero for a device that never allocated.
+   */
+    TVM_DLL static DeviceMemoryStats GetMemoryStats(Device dev);
+
+    /*!
+   * \brief Restart the peak of a device from its current usage.
+   * \param dev The device.
+   */
+    TVM_DLL static void ResetPeakMemory(Device dev);
+
+    /*!
+   * \brief Start measuring the peak usage of a device over a window.
+   *
+   *  Unlike ResetPeakMemory this leaves peak_bytes alone. Windows nest, each
+   *  one must be stopped before the window it was started in.
+   * \param dev The device.
+   * \return The value to pass to StopPeakWindow.
+   */
+    TVM_DLL static int64_t StartPeakWindow(Device dev);
+
+    /*!
+   * \brief Stop a window started by StartPeakWindow.
+   * \param dev The device.
+   * \param outer_peak The value StartPeakWindow returned.
+   * \return The highest usage of the device while the window was open.
+   */
+    TVM_DLL static int64_t StopPeakWindow(Device dev, int64_t outer_peak);
+
     /*!
    * \brief Whether a certian device type requires set device device
    *        before launching the kernel function.
@@ -279,6 +369,18 @@ protected:
     virtual void CopyDataFromTo(const void* from, size_t from_offset, void* to, size_t to_offset,
                                 size_t num_bytes, Device dev_from, Device dev_to,
                                 DLDataType type_hint, TVMStreamHandle stream);
+
+public:
+    // NOTE: declared last so the slots of the other virtual functions stay where
+    // device APIs built against the previous header expect them.
+    /*!
+   * \brief Set a configurable attribute of a specified device.
+   * \param dev The device device
+   * \param kind The attribute kind
+   * \param value The new value.
+   * \sa DeviceAttrKind
+   */
+    virtual void SetAttr(Device dev, DeviceAttrKind kind, const Any& value);
 };
 
 /*!
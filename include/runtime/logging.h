@@ -109,7 +109,7 @@ public:
      * \param message The error message to display.
      */
     InternalError(const std::string& file, int lineno, const std::string& message)
-        : Error(DetectKind(message), DetectMessage(message), TVMFFITraceback(file.c_str(), lineno, "")) {}
+        : Error(DetectKind(message), DetectMessage(message), ffi::details::TracebackCapture(file, lineno, "")) {}
 
 private:
     // try to detect the kind of error from the message when the error type
@@ -15,6 +15,7 @@
 #include "runtime/serializer.h"
 
 #include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -28,6 +29,31 @@ using ffi::Object;
 using ffi::ObjectPtr;
 using ffi::ObjectRef;
 
+/*!
+ * \brief Completion handle of NDArray::CopyFromToAsync.
+ *
+ *  Handles are cheap to copy and all copies refer to the same transfer.
+ *  Dropping every handle does not cancel the transfer.
+ */
+class CopyHandle {
+public:
+    CopyHandle() = default;
+    /*!
+   * \brief Block until the copy is done, including its work on the device stream.
+   * \note An error raised by the copy is rethrown here with its original type.
+   */
+    TVM_DLL void Wait() const;
+
+    /*! \brief The shared completion state. */
+    struct State;
+
+private:
+    explicit CopyHandle(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+    std::shared_ptr<State> state_;
+    friend class NDArray;
+};
+
 /*!
  * \brief Managed NDArray.
  *  The array is backed by reference counted blocks.
@@ -73,7 +99,8 @@ public:
    * \param data The source bytes to be copied from.
    * \param nbytes The size of the buffer in bytes
    *        Must be equal to the size of the NDArray.
-   * \note The copy always triggers a TVMSynchronize.
+   * \note The copy always triggers a TVMSynchronize. The bytes are in row-major
+   *       order, a strided array on the CPU is filled in place.
    */
     TVM_DLL void CopyFromBytes(const void* data, size_t nbytes);
     /*!
@@ -89,7 +116,8 @@ public:
    * \param data The source bytes to be copied from.
    * \param nbytes The size of the data buffer.
    *        Must be equal to the size of the NDArray.
-   * \note The copy always triggers a TVMSynchronize.
+   * \note The copy always triggers a TVMSynchronize. The bytes are in row-major
+   *       order, a strided array on the CPU is gathered without a temporary.
    */
     TVM_DLL void CopyToBytes(void* data, size_t nbytes) const;
     /*!
@@ -153,6 +181,26 @@ public:
     TVM_DLL static void CopyFromTo(const DLTensor* from, DLTensor* to,
                                    TVMStreamHandle stream = nullptr);
 
+    /*!
+   * \brief Copy data from one array to another without blocking the caller.
+   *
+   *  Large contiguous copies between pageable CPU memory and another device
+   *  are cut into chunks that move through a recycled pool of staging
+   *  buffers on GetPreferredHostDevice, pinned where the device has pinned
+   *  host memory. A copy thread of the device and stream drives the chunks,
+   *  staging one chunk while the device transfers the previous one. Other
+   *  copies are issued on the stream directly. Copies on the same device and
+   *  stream keep their submission order.
+   * \param from The source array.
+   * \param to The target array.
+   * \param stream The stream used in copy.
+   * \return The completion handle.
+   * \note Both arrays must stay alive, and the source unmodified, until Wait returns.
+   *       The target may only be read after Wait.
+   */
+    TVM_DLL static CopyHandle CopyFromToAsync(const DLTensor* from, DLTensor* to,
+                                              TVMStreamHandle stream = nullptr);
+
     /*!
    * \brief Function to copy data from one array to a byte buffer.
    * \param from The source array.
@@ -171,6 +219,20 @@ public:
  */
 inline bool SaveDLTensor(dmlc::Stream* strm, const DLTensor* tensor);
 
+/*!
+ * \brief Write the data of a tensor in the row-major, little-endian layout of SaveDLTensor.
+ *
+ *  Only contiguous CPU data that needs no byte swap is written in place.
+ *  Anything else streams through fixed size host buffers: strided and
+ *  offset CPU data is gathered into them, and contiguous data on other
+ *  devices is copied to them in chunks, overlapping each copy with the
+ *  write of the previous chunk. Non-contiguous data on other devices is
+ *  rejected, as device copies only move contiguous data.
+ * \param strm The output stream.
+ * \param tensor The tensor whose data is written.
+ */
+TVM_DLL void SaveDLTensorData(dmlc::Stream* strm, const DLTensor* tensor);
+
 inline void NDArray::CopyFrom(const DLTensor* other) const {
     ICHECK(data_ != nullptr);
     CopyFromTo(other, get_mutable());
@@ -224,19 +286,7 @@ inline bool SaveDLTensor(dmlc::Stream* strm, const DLTensor* tensor) {
     }
     int64_t data_byte_size = type_bytes * num_elems;
     strm->Write(data_byte_size);
-
-    if (DMLC_IO_NO_ENDIAN_SWAP && tensor->device.device_type == kDLCPU &&
-        tensor->strides == nullptr && tensor->byte_offset == 0) {
-        // quick path
-        strm->Write(tensor->data, data_byte_size);
-    } else {
-        std::vector<uint8_t> bytes(data_byte_size);
-        NDArray::CopyToBytes(tensor, dmlc::BeginPtr(bytes), data_byte_size);
-        if (!DMLC_IO_NO_ENDIAN_SWAP) {
-            dmlc::ByteSwap(dmlc::BeginPtr(bytes), type_bytes, num_elems);
-        }
-        strm->Write(dmlc::BeginPtr(bytes), data_byte_size);
-    }
+    SaveDLTensorData(strm, tensor);
     return true;
 }
 
@@ -0,0 +1,105 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+
+#ifndef LITETVM_RUNTIME_NDARRAY_CACHE_H
+#define LITETVM_RUNTIME_NDARRAY_CACHE_H
+
+#include "runtime/base.h"
+#include "runtime/device_api.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace litetvm::runtime {
+
+/*!
+ * \brief Counters of the NDArray caching allocator, see NDArrayCache::GetStats.
+ */
+struct NDArrayCacheStats {
+    /*! \brief Bytes held in idle cached blocks. */
+    int64_t cached_bytes{0};
+    /*! \brief Number of idle cached blocks. */
+    int64_t cached_blocks{0};
+    /*! \brief Allocations served from the cache. */
+    int64_t hits{0};
+    /*! \brief Allocations that went to the device. */
+    int64_t misses{0};
+    /*! \brief Released blocks given back to the device, by Trim, the cap or while disabled. */
+    int64_t trimmed_blocks{0};
+};
+
+/*!
+ * \brief Caching allocator behind NDArray::Empty, for CPU memory.
+ *
+ *  While enabled, the storage of CPU NDArrays in the global memory scope is
+ *  rounded up to a bucket size, 512 byte steps below 1 MiB and four sizes
+ *  per power of two above, and a released block is kept in the bucket of
+ *  its device and size for the next NDArray::Empty of that bucket.
+ *  Cached bytes are capped by MaxBytes, a released block that does not fit
+ *  is freed right away.
+ *
+ *  Disabled by default, TVM_NDARRAY_CACHE=1 enables it at startup and
+ *  TVM_NDARRAY_CACHE_LIMIT sets the cap in bytes, 1 GiB by default.
+ *
+ * \note Device memory statistics count cached blocks as NDArray memory,
+ *       they are only released to the device by Trim or the cap.
+ * \note Only kDLCPU blocks are cached. A block of an asynchronous device may
+ *       still be read or written by work queued on a stream when it is
+ *       released, and the cache does not track streams to know when it
+ *       could be handed out again.
+ */
+class NDArrayCache {
+public:
+    /*!
+   * \brief Enable or disable the cache, disabling it trims every cached block.
+   * \param enabled Whether NDArray::Empty goes through the cache.
+   */
+    TVM_DLL static void SetEnabled(bool enabled);
+
+    /*! \return Whether the cache is enabled. */
+    TVM_DLL static bool Enabled();
+
+    /*!
+   * \brief Set the cap of the cached bytes, over all devices.
+   * \param max_bytes The cap, the cache is trimmed down to it.
+   */
+    TVM_DLL static void SetMaxBytes(int64_t max_bytes);
+
+    /*! \return The cap of the cached bytes. */
+    TVM_DLL static int64_t MaxBytes();
+
+    /*!
+   * \brief Free cached blocks, largest first, until at most target_bytes stay cached.
+   * \param target_bytes The bytes allowed to stay cached.
+   */
+    TVM_DLL static void Trim(int64_t target_bytes = 0);
+
+    /*! \return The cache counters. */
+    TVM_DLL static NDArrayCacheStats GetStats();
+
+    /*! \brief Restart the hit, miss and trim counters from zero. */
+    TVM_DLL static void ResetStats();
+
+    /*!
+   * \brief Allocate the storage of an NDArray, used by NDArray::Empty.
+   * \param dev The device, kDLCPU.
+   * \param nbytes The size of the NDArray.
+   * \param type_hint The dtype of the NDArray.
+   * \param block_bytes The size of the returned block, to be passed to Free.
+   * \return The storage.
+   */
+    TVM_DLL static void* Alloc(Device dev, size_t nbytes, DLDataType type_hint, size_t* block_bytes);
+
+    /*!
+   * \brief Give back storage allocated by Alloc.
+   * \param dev The device.
+   * \param ptr The storage.
+   * \param block_bytes The block size Alloc returned.
+   */
+    TVM_DLL static void Free(Device dev, void* ptr, size_t block_bytes);
+};
+
+}// namespace litetvm::runtime
+
+#endif// LITETVM_RUNTIME_NDARRAY_CACHE_H
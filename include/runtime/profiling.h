@@ -392,7 +392,7 @@ public:
    *  \returns A `Report` that can either be formatted as CSV (with `.AsCSV`)
    *  or as a human readable table (with `.AsTable`).
    */
-    Report Report();
+    profiling::Report Report();
     /*! \brief Check if the profiler is currently running.
    * \returns Whether or not the profiler is running.
    */
@@ -407,6 +407,12 @@ private:
     std::stack<CallFrame> in_flight_;
     std::vector<MetricCollector> collectors_;
     std::unordered_map<String, Any> configuration_;
+    // memory stats of each device at Start and at Stop
+    std::vector<DeviceMemoryStats> start_memory_;
+    std::vector<DeviceMemoryStats> stop_memory_;
+    // peak window of each device, what StartPeakWindow returned and the peak at Stop
+    std::vector<int64_t> outer_peaks_;
+    std::vector<int64_t> window_peaks_;
 };
 
 /* \brief A duration in time. */
@@ -8,6 +8,7 @@
 #include "runtime/c_backend_api.h"
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -74,6 +75,8 @@ public:
         kSpecifyOneCorePerThread = -2,
         /*All threads will get the same core group affinity.*/
         kSpecifyThreadShareAllCore = -3,
+        /*Different threads will get different cores, filling one NUMA node after another.*/
+        kNuma = -4,
     };
     /*!
    * \brief configure the CPU id affinity
@@ -99,6 +102,28 @@ private:
  * \brief Platform-agnostic no-op.
  */
 TVM_DLL void Yield();
+/*!
+ * \return The number of NUMA nodes with CPUs, 1 on systems without NUMA information.
+ */
+TVM_DLL int NumaNodeCount();
+/*!
+ * \return The index of the NUMA node the calling thread currently runs on.
+ */
+TVM_DLL int CurrentNumaNode();
+/*!
+ * \return Whether a thread pool was configured with ThreadGroup::kNuma and its
+ *  workers were pinned, until Configure picks another mode. CPU workspace is
+ *  then served from one pool per NUMA node.
+ */
+TVM_DLL bool NumaPlacementEnabled();
+/*!
+ * \brief Stop serving CPU workspace per NUMA node, see NumaPlacementEnabled.
+ */
+TVM_DLL void DisableNumaPlacement();
+/*!
+ * \return A counter that changes whenever NumaPlacementEnabled() does.
+ */
+TVM_DLL uint64_t NumaPlacementGeneration();
 /*!
  * \return the maximum number of effective workers for this system.
  */
@@ -118,7 +143,7 @@ TVM_DLL void ResetThreadPool();
 /*!
  * \brief Configuring the CPU affinity mode for the working threads.
  * \param mode The preferred CPU type (1 = big, -1 = little, -2 = kSpecifyOneCorePerThread,
- *  -3 = kSpecifyThreadShareAllCore).
+ *  -3 = kSpecifyThreadShareAllCore, -4 = kNuma).
  * \param nthreads The number of threads to use (0 = use all).
  * \param cpus A list of CPUs is used to set the 'cpu affinity' for the worker threads.
  */
@@ -131,8 +156,125 @@ TVM_DLL void Configure(ThreadGroup::AffinityMode mode, int nthreads,
  */
 TVM_DLL int32_t NumThreads();
 
+/*!
+ * \brief The task scheduling engine behind TVMBackendParallelLaunch.
+ */
+enum class SchedulerMode : int {
+    /*! \brief Deal exactly one static task to each worker. */
+    kStatic = 0,
+    /*!
+     * \brief Per-worker Chase-Lev deques, recursive range splitting and stealing.
+     *  Tasks may share a thread, so they cannot wait at TVMBackendParallelBarrier.
+     *  A lambda runs on the static engine until one of its launches finished
+     *  without reaching the barrier, the launching thread remembers it.
+     */
+    kWorkStealing = 1,
+};
+
+/*!
+ * \brief Select the scheduling engine used by subsequent parallel launches.
+ *
+ *  The default is read from TVM_THREAD_POOL_SCHEDULER ("static" or "work_stealing").
+ * \param mode The scheduler mode.
+ */
+TVM_DLL void SetSchedulerMode(SchedulerMode mode);
+
+/*!
+ * \return The scheduling engine used by parallel launches.
+ */
+TVM_DLL SchedulerMode GetSchedulerMode();
+
+/*!
+ * \brief Which pool serves TVMBackendParallelLaunch.
+ */
+enum class PoolMode : int {
+    /*! \brief Every launching thread owns a pool of workers. */
+    kThreadLocal = 0,
+    /*!
+     * \brief All launching threads share one process-wide pool. Launches are
+     *  admitted in FIFO order and the worker count stays at MaxConcurrency.
+     */
+    kShared = 1,
+};
+
+/*!
+ * \brief Select the pool used by subsequent parallel launches.
+ *
+ *  The default is read from TVM_THREAD_POOL_MODE ("thread_local" or "shared").
+ *  Launches nested inside a running launch are always executed inline.
+ * \param mode The pool mode.
+ */
+TVM_DLL void SetPoolMode(PoolMode mode);
+
+/*!
+ * \return The pool mode used by parallel launches.
+ */
+TVM_DLL PoolMode GetPoolMode();
+
+/*!
+ * \brief The algorithm behind TVMBackendParallelBarrier.
+ */
+enum class BarrierMode : int {
+    /*! \brief Every task polls the padded counters of all other tasks. */
+    kFlat = 0,
+    /*! \brief Combining tree laid out along the sorted core order. */
+    kTree = 1,
+};
+
+/*!
+ * \brief Select the barrier used by subsequent parallel launches.
+ *
+ *  The default is read from TVM_THREAD_POOL_BARRIER ("flat" or "tree").
+ * \param mode The barrier mode.
+ */
+TVM_DLL void SetBarrierMode(BarrierMode mode);
+
+/*!
+ * \return The barrier used by parallel launches.
+ */
+TVM_DLL BarrierMode GetBarrierMode();
+
 }// namespace threading
 
+/*!
+ * \brief How parallel_for_with_threading_backend hands out iterations,
+ *  modeled on the OpenMP schedule clause.
+ */
+struct ParallelForSchedule {
+    enum Kind : int {
+        /*! \brief One contiguous block per task. */
+        kStatic = 0,
+        /*! \brief Tasks grab fixed size chunks from a shared cursor. */
+        kDynamic = 1,
+        /*!
+         * \brief Tasks grab chunks proportional to the remaining iterations,
+         *  shrinking down to `chunk`.
+         */
+        kGuided = 2,
+    };
+    /*! \brief The schedule kind. */
+    Kind kind{kStatic};
+    /*!
+     * \brief Chunk size of kDynamic, minimal chunk size of kGuided.
+     *  0 means use the grain size.
+     */
+    int64_t chunk{0};
+    /*!
+     * \brief Grain size hint, the smallest number of iterations worth running
+     *  as a unit. Loops no longer than one grain run on the calling thread, and
+     *  no more tasks than grains are used.
+     */
+    int64_t grain{1};
+
+    static ParallelForSchedule Static(int64_t grain = 1) { return {kStatic, 0, grain}; }
+    static ParallelForSchedule Dynamic(int64_t chunk = 0, int64_t grain = 1) {
+        return {kDynamic, chunk, grain};
+    }
+    static ParallelForSchedule Guided(int64_t chunk = 0, int64_t grain = 1) {
+        return {kGuided, chunk, grain};
+    }
+};
+
 /*!
  * \brief Execute the given lambda function in parallel with
  * threading backend in TVM.
@@ -141,6 +283,7 @@ TVM_DLL int32_t NumThreads();
  * It should have the signature "void (int i)".
  * \param begin The start index of this parallel loop (inclusive).
  * \param end The end index of this parallel loop (exclusive).
+ * \param schedule How iterations are distributed over the tasks.
  * \example
  *
  * The for loop
@@ -151,9 +294,13 @@ TVM_DLL int32_t NumThreads();
  *   parallel_for_with_threading_backend([&a](int i) {
  *     a[i] = i;
  *   }, 0, 10);
+ *
+ * Loops with uneven per-iteration cost can balance the load with
+ *   parallel_for_with_threading_backend(f, 0, n, ParallelForSchedule::Dynamic(16));
  */
 template<typename T>
-void parallel_for_with_threading_backend(T flambda, int64_t begin, int64_t end);
+void parallel_for_with_threading_backend(T flambda, int64_t begin, int64_t end,
+                                         ParallelForSchedule schedule = ParallelForSchedule());
 
 namespace detail {
 
@@ -174,34 +321,87 @@ struct ParallelForWithThreadingBackendLambdaInvoker {
 };
 
 template<typename T>
-void parallel_launch_with_threading_backend(T flambda) {
+void parallel_launch_with_threading_backend(T flambda, int num_task = 0) {
     // Launch the lambda by passing its address.
     void* cdata = &flambda;
     TVMBackendParallelLaunch(ParallelForWithThreadingBackendLambdaInvoker<T>::TVMParallelLambdaInvoke,
-                             cdata, /*num_task=*/0);
+                             cdata, num_task);
+}
+
+// Claim the next guided chunk from cursor, returns false when the loop is exhausted.
+inline bool ClaimGuidedChunk(std::atomic<int64_t>* cursor, int64_t end, int64_t min_chunk,
+                             int num_task, int64_t* chunk_begin, int64_t* chunk_end) {
+    int64_t cur = cursor->load(std::memory_order_relaxed);
+    while (cur < end) {
+        int64_t remaining = end - cur;
+        int64_t size = std::max(min_chunk, (remaining + 2 * num_task - 1) / (2 * num_task));
+        size = std::min(size, remaining);
+        if (cursor->compare_exchange_weak(cur, cur + size, std::memory_order_relaxed)) {
+            *chunk_begin = cur;
+            *chunk_end = cur + size;
+            return true;
+        }
+    }
+    return false;
 }
 
 }// namespace detail
 
 template<typename T>
-void parallel_for_with_threading_backend(T flambda, int64_t begin, int64_t end) {
-    if (end - begin == 1) {
-        flambda(begin);
+void parallel_for_with_threading_backend(T flambda, int64_t begin, int64_t end,
+                                         ParallelForSchedule schedule) {
+    const int64_t grain = std::max<int64_t>(schedule.grain, 1);
+    if (end - begin <= grain) {
+        for (int64_t i = begin; i < end; ++i) {
+            flambda(i);
+        }
         return;
     }
+    // never use more tasks than there are grains of work
+    const int64_t num_grains = (end - begin + grain - 1) / grain;
+    const int num_task =
+            num_grains < threading::NumThreads() ? static_cast<int>(num_grains) : 0;
 
-    auto flaunch = [begin, end, flambda](int task_id, int num_task) {
-        // For each thread, do static division and call into flambda.
-        int64_t total_len = end - begin;
-        int64_t step = (total_len + num_task - 1) / num_task;
-        int64_t local_begin = std::min(begin + step * task_id, end);
-        int64_t local_end = std::min(local_begin + step, end);
-        for (int64_t i = local_begin; i < local_end; ++i) {
-            flambda(i);
-        }
-    };
-    // Launch with all threads.
-    detail::parallel_launch_with_threading_backend(flaunch);
+    if (schedule.kind == ParallelForSchedule::kStatic) {
+        auto flaunch = [begin, end, flambda](int task_id, int num_task) {
+            // For each thread, do static division and call into flambda.
+            int64_t total_len = end - begin;
+            int64_t step = (total_len + num_task - 1) / num_task;
+            int64_t local_begin = std::min(begin + step * task_id, end);
+            int64_t local_end = std::min(local_begin + step, end);
+            for (int64_t i = local_begin; i < local_end; ++i) {
+                flambda(i);
+            }
+        };
+        // Launch with all threads.
+        detail::parallel_launch_with_threading_backend(flaunch, num_task);
+        return;
+    }
+
+    const int64_t chunk = schedule.chunk > 0 ? schedule.chunk : grain;
+    std::atomic<int64_t> cursor{begin};
+    if (schedule.kind == ParallelForSchedule::kDynamic) {
+        auto flaunch = [end, chunk, &cursor, &flambda](int task_id, int num_task) {
+            for (int64_t lo = cursor.fetch_add(chunk, std::memory_order_relaxed); lo < end;
+                 lo = cursor.fetch_add(chunk, std::memory_order_relaxed)) {
+                int64_t hi = std::min(lo + chunk, end);
+                for (int64_t i = lo; i < hi; ++i) {
+                    flambda(i);
+                }
+            }
+        };
+        detail::parallel_launch_with_threading_backend(flaunch, num_task);
+    } else {
+        auto flaunch = [end, chunk, &cursor, &flambda](int task_id, int num_task) {
+            int64_t lo, hi;
+            while (detail::ClaimGuidedChunk(&cursor, end, chunk, num_task, &lo, &hi)) {
+                for (int64_t i = lo; i < hi; ++i) {
+                    flambda(i);
+                }
+            }
+        };
+        detail::parallel_launch_with_threading_backend(flaunch, num_task);
+    }
 }
 
 }// namespace runtime
@@ -0,0 +1,289 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+
+#include "compression.h"
+#include "runtime/logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace litetvm {
+namespace runtime {
+
+namespace {
+
+// Parameters of the LZ4 block format.
+constexpr size_t kMinMatch = 4;
+// the last bytes of a block are always literals
+constexpr size_t kLastLiterals = 5;
+// the last match starts at least this far from the end of a block
+constexpr size_t kMatchFindLimit = 12;
+constexpr size_t kMaxOffset = 65535;
+
+constexpr int kHashLog = 16;
+// positions compared per hash chain by the high level
+constexpr int kMaxChainAttempts = 64;
+
+uint32_t Read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t Hash4(const uint8_t* p) {
+    return (Read32(p) * 2654435761u) >> (32 - kHashLog);
+}
+
+// Length of the common prefix of a and b, where a < b and b stops at limit.
+size_t MatchLength(const uint8_t* a, const uint8_t* b, const uint8_t* limit) {
+    const uint8_t* start = b;
+    for (; b + sizeof(uint64_t) <= limit; a += sizeof(uint64_t), b += sizeof(uint64_t)) {
+        uint64_t x, y;
+        std::memcpy(&x, a, sizeof(x));
+        std::memcpy(&y, b, sizeof(y));
+        if (x != y) break;
+    }
+    for (; b < limit && *a == *b; ++a, ++b) {}
+    return static_cast<size_t>(b - start);
+}
+
+// Write the part of a length that does not fit in its token nibble.
+uint8_t* WriteLength(uint8_t* op, size_t len) {
+    for (; len >= 255; len -= 255) *op++ = 255;
+    *op++ = static_cast<uint8_t>(len);
+    return op;
+}
+
+// Write one sequence, a match_len of 0 ends the block after the literals.
+uint8_t* WriteSequence(uint8_t* op, const uint8_t* literals, size_t lit_len, size_t offset,
+                       size_t match_len) {
+    uint8_t* token = op++;
+    *token = static_cast<uint8_t>(std::min<size_t>(lit_len, 15) << 4);
+    if (lit_len >= 15) op = WriteLength(op, lit_len - 15);
+    std::memcpy(op, literals, lit_len);
+    op += lit_len;
+    if (match_len == 0) return op;
+    *op++ = static_cast<uint8_t>(offset & 0xFF);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    size_t len = match_len - kMinMatch;
+    *token |= static_cast<uint8_t>(std::min<size_t>(len, 15));
+    if (len >= 15) op = WriteLength(op, len - 15);
+    return op;
+}
+
+// Read the part of a length that did not fit in its token nibble.
+bool ReadLength(const uint8_t** ip, const uint8_t* end, size_t* len) {
+    uint8_t b;
+    do {
+        if (*ip == end) return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+// Shuffle n elements of a common size, unrolled so the compiler can vectorize.
+template<size_t kElemBytes>
+void ShuffleElems(const char* s, char* d, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t b = 0; b < kElemBytes; ++b) d[b * n + i] = s[i * kElemBytes + b];
+    }
+}
+
+template<size_t kElemBytes>
+void UnshuffleElems(const char* s, char* d, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t b = 0; b < kElemBytes; ++b) d[i * kElemBytes + b] = s[b * n + i];
+    }
+}
+
+}// namespace
+
+size_t LZCompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t LZCompress(const void* src, size_t size, void* dst, bool high) {
+    const auto* base = static_cast<const uint8_t*>(src);
+    const uint8_t* end = base + size;
+    auto* op = static_cast<uint8_t*>(dst);
+    const uint8_t* anchor = base;
+    if (size > kMatchFindLimit) {
+        const uint8_t* find_limit = end - kMatchFindLimit;
+        const uint8_t* match_limit = end - kLastLiterals;
+        // most recent position of every hash, and for the high level the
+        // previous position with the same hash of every position
+        thread_local std::vector<int32_t> head, chain;
+        head.assign(size_t{1} << kHashLog, -1);
+        if (high) chain.resize(size);
+        auto insert = [&](const uint8_t* p) {
+            uint32_t h = Hash4(p);
+            if (high) chain[p - base] = head[h];
+            head[h] = static_cast<int32_t>(p - base);
+        };
+        // longest match of p against the positions inserted so far
+        auto find = [&](const uint8_t* p, const uint8_t** ref) {
+            size_t best = 0;
+            int attempts = high ? kMaxChainAttempts : 1;
+            for (int32_t cand = head[Hash4(p)]; cand >= 0 && attempts-- > 0; cand = high ? chain[cand] : -1) {
+                const uint8_t* r = base + cand;
+                if (static_cast<size_t>(p - r) > kMaxOffset) break;
+                if (Read32(r) != Read32(p)) continue;
+                size_t len = kMinMatch + MatchLength(r + kMinMatch, p + kMinMatch, match_limit);
+                if (len > best) {
+                    best = len;
+                    *ref = r;
+                }
+            }
+            return best;
+        };
+
+        const uint8_t* ip = base;
+        // the high level inserts every position below this one
+        const uint8_t* inserted = base;
+        while (ip <= find_limit) {
+            if (high) {
+                for (; inserted < ip; ++inserted) insert(inserted);
+            }
+            const uint8_t* ref = nullptr;
+            size_t len = find(ip, &ref);
+            if (!high) insert(ip);
+            if (len == 0) {
+                ++ip;
+                continue;
+            }
+            if (high) {
+                // lazy matching, give up a match for a longer one a byte later
+                while (ip < find_limit) {
+                    insert(ip);
+                    inserted = ip + 1;
+                    const uint8_t* next_ref = nullptr;
+                    size_t next_len = find(ip + 1, &next_ref);
+                    if (next_len <= len) break;
+                    ++ip;
+                    ref = next_ref;
+                    len = next_len;
+                }
+            }
+            // grow the match backwards over the pending literals
+            for (; ip > anchor && ref > base && ip[-1] == ref[-1]; --ip, --ref) ++len;
+            op = WriteSequence(op, anchor, ip - anchor, ip - ref, len);
+            ip += len;
+            anchor = ip;
+            if (!high) insert(ip - 2);
+        }
+    }
+    op = WriteSequence(op, anchor, end - anchor, 0, 0);
+    return static_cast<size_t>(op - static_cast<uint8_t*>(dst));
+}
+
+bool LZDecompress(const void* src, size_t size, void* dst, size_t out_size) {
+    const auto* ip = static_cast<const uint8_t*>(src);
+    const uint8_t* end = ip + size;
+    auto* out = static_cast<uint8_t*>(dst);
+    uint8_t* op = out;
+    uint8_t* out_end = out + out_size;
+    while (true) {
+        if (ip == end) return false;
+        const uint8_t token = *ip++;
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !ReadLength(&ip, end, &lit_len)) return false;
+        if (lit_len > static_cast<size_t>(end - ip) || lit_len > static_cast<size_t>(out_end - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        // the last sequence has no match
+        if (ip == end) return op == out_end;
+        if (end - ip < 2) return false;
+        const size_t offset = ip[0] | static_cast<size_t>(ip[1]) << 8;
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - out)) return false;
+        size_t match_len = token & 15;
+        if (match_len == 15 && !ReadLength(&ip, end, &match_len)) return false;
+        match_len += kMinMatch;
+        if (match_len > static_cast<size_t>(out_end - op)) return false;
+        // an overlapping match repeats the last offset bytes, every copy
+        // doubles the repeated run so the copies never overlap
+        const uint8_t* ref = op - offset;
+        uint8_t* match_end = op + match_len;
+        while (op != match_end) {
+            size_t n = std::min(static_cast<size_t>(op - ref), static_cast<size_t>(match_end - op));
+            std::memcpy(op, ref, n);
+            op += n;
+        }
+    }
+}
+
+void ByteShuffle(const void* src, void* dst, size_t size, size_t elem_bytes) {
+    const auto* s = static_cast<const char*>(src);
+    auto* d = static_cast<char*>(dst);
+    const size_t n = size / elem_bytes;
+    switch (elem_bytes) {
+        case 2: ShuffleElems<2>(s, d, n); break;
+        case 4: ShuffleElems<4>(s, d, n); break;
+        case 8: ShuffleElems<8>(s, d, n); break;
+        default:
+            for (size_t b = 0; b < elem_bytes; ++b) {
+                for (size_t i = 0; i < n; ++i) d[b * n + i] = s[i * elem_bytes + b];
+            }
+    }
+    std::memcpy(d + n * elem_bytes, s + n * elem_bytes, size - n * elem_bytes);
+}
+
+void ByteUnshuffle(const void* src, void* dst, size_t size, size_t elem_bytes) {
+    const auto* s = static_cast<const char*>(src);
+    auto* d = static_cast<char*>(dst);
+    const size_t n = size / elem_bytes;
+    switch (elem_bytes) {
+        case 2: UnshuffleElems<2>(s, d, n); break;
+        case 4: UnshuffleElems<4>(s, d, n); break;
+        case 8: UnshuffleElems<8>(s, d, n); break;
+        default:
+            for (size_t b = 0; b < elem_bytes; ++b) {
+                for (size_t i = 0; i < n; ++i) d[i * elem_bytes + b] = s[b * n + i];
+            }
+    }
+    std::memcpy(d + n * elem_bytes, s + n * elem_bytes, size - n * elem_bytes);
+}
+
+size_t CompressBlock(CompressionCodec codec, const void* src, size_t size, size_t elem_bytes,
+                     std::vector<char>* out) {
+    ICHECK(codec == CompressionCodec::kLZ || codec == CompressionCodec::kLZHigh)
+            << "Unknown compression codec " << static_cast<uint32_t>(codec);
+    const void* input = src;
+    thread_local std::vector<char> shuffled;
+    if (elem_bytes > 1) {
+        shuffled.resize(size);
+        ByteShuffle(src, shuffled.data(), size, elem_bytes);
+        input = shuffled.data();
+    }
+    out->resize(LZCompressBound(size));
+    size_t n = LZCompress(input, size, out->data(), codec == CompressionCodec::kLZHigh);
+    if (n >= size) {
+        const auto* p = static_cast<const char*>(src);
+        out->assign(p, p + size);
+        return size;
+    }
+    out->resize(n);
+    return n;
+}
+
+bool DecompressBlock(const void* src, size_t stored_size, void* dst, size_t size, size_t elem_bytes) {
+    if (stored_size == size) {
+        std::memcpy(dst, src, size);
+        return true;
+    }
+    if (stored_size > size) return false;
+    if (elem_bytes <= 1) return LZDecompress(src, stored_size, dst, size);
+    thread_local std::vector<char> shuffled;
+    shuffled.resize(size);
+    if (!LZDecompress(src, stored_size, shuffled.data(), size)) return false;
+    ByteUnshuffle(shuffled.data(), dst, size, elem_bytes);
+    return true;
+}
+
+}// namespace runtime
+}// namespace litetvm
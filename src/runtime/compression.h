@@ -0,0 +1,95 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+
+#ifndef LITETVM_RUNTIME_COMPRESSION_H
+#define LITETVM_RUNTIME_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace litetvm {
+namespace runtime {
+
+/*!
+ * \brief Codec of a compressed tensor payload.
+ *
+ *  Payloads are cut into independent blocks. Every block is byte shuffled,
+ *  i.e. the k-th bytes of all elements are grouped together, and then
+ *  compressed in the LZ4 block format. Both codecs share the decoder.
+ */
+enum class CompressionCodec : uint32_t {
+    /*! \brief Stored verbatim. */
+    kNone = 0,
+    /*! \brief Greedy matching on a single probe hash table, fast to write. */
+    kLZ = 1,
+    /*! \brief Lazy matching on hash chains, slower to write but denser. */
+    kLZHigh = 2,
+};
+
+/*!
+ * \brief Upper bound of the LZ compressed size of a buffer.
+ * \param size Size of the buffer.
+ */
+size_t LZCompressBound(size_t size);
+
+/*!
+ * \brief Compress a buffer in the LZ4 block format.
+ * \param src The buffer.
+ * \param size Size of the buffer.
+ * \param dst Output of at least LZCompressBound(size) bytes.
+ * \param high Whether to search hash chains, see CompressionCodec::kLZHigh.
+ * \return The compressed size.
+ */
+size_t LZCompress(const void* src, size_t size, void* dst, bool high);
+
+/*!
+ * \brief Decompress a buffer in the LZ4 block format.
+ * \param src The compressed buffer.
+ * \param size Size of the compressed buffer.
+ * \param dst Output buffer.
+ * \param out_size Exact decompressed size.
+ * \return Whether src was well formed and decompressed to out_size bytes.
+ */
+bool LZDecompress(const void* src, size_t size, void* dst, size_t out_size);
+
+/*!
+ * \brief Group the k-th bytes of every element, the trailing partial element is copied.
+ * \param src The elements.
+ * \param dst Output of size bytes.
+ * \param size Size of the buffer.
+ * \param elem_bytes Size of an element.
+ */
+void ByteShuffle(const void* src, void* dst, size_t size, size_t elem_bytes);
+
+/*! \brief Inverse of ByteShuffle. */
+void ByteUnshuffle(const void* src, void* dst, size_t size, size_t elem_bytes);
+
+/*!
+ * \brief Compress one block of a tensor payload.
+ * \param codec The codec, not kNone.
+ * \param src The block.
+ * \param size Size of the block.
+ * \param elem_bytes Size of a tensor element.
+ * \param out The stored block, the block itself when it does not shrink.
+ * \return The stored size, equal to size when the block is stored verbatim.
+ */
+size_t CompressBlock(CompressionCodec codec, const void* src, size_t size, size_t elem_bytes,
+                     std::vector<char>* out);
+
+/*!
+ * \brief Decompress one block written by CompressBlock.
+ * \param src The stored block.
+ * \param stored_size Size of the stored block.
+ * \param dst Output of size bytes.
+ * \param size Size of the block.
+ * \param elem_bytes Size of a tensor element.
+ * \return Whether the block was well formed.
+ */
+bool DecompressBlock(const void* src, size_t stored_size, void* dst, size_t size, size_t elem_bytes);
+
+}// namespace runtime
+}// namespace litetvm
+
+#endif// LITETVM_RUNTIME_COMPRESSION_H
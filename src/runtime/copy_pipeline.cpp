@@ -0,0 +1,287 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+
+#include "runtime/device_api.h"
+#include "runtime/logging.h"
+#include "runtime/ndarray.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace litetvm::runtime {
+
+struct CopyHandle::State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done{false};
+    // the error raised by the copy, rethrown to the waiter
+    std::exception_ptr error;
+    // the device and stream that finish the copy
+    Device dev;
+    TVMStreamHandle stream;
+};
+
+void CopyHandle::Wait() const {
+    if (state_ == nullptr) return;
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        state_->cv.wait(lock, [this] { return state_->done; });
+        error = state_->error;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    DeviceAPI::Get(state_->dev)->StreamSync(state_->dev, state_->stream);
+}
+
+namespace {
+
+// Size of each staging buffer a pipelined copy moves through.
+constexpr size_t kStagingChunkBytes = 4 << 20;
+// Idle staging buffers kept per host device, the rest are freed.
+constexpr size_t kMaxIdleStagingBuffers = 4;
+
+// Recycled staging buffers of kStagingChunkBytes, keyed by host device type.
+class StagingBufferPool {
+public:
+    void* Acquire(Device host) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& idle = idle_[host.device_type];
+            if (!idle.empty()) {
+                void* ptr = idle.back();
+                idle.pop_back();
+                return ptr;
+            }
+        }
+        void* ptr = DeviceAPI::Get(host)->AllocDataSpace(host, kStagingChunkBytes, kAllocAlignment,
+                                                         DLDataType{kDLUInt, 8, 1});
+        DeviceAPI::RecordAlloc(host, kStagingChunkBytes, DeviceMemoryKind::kWorkspace);
+        return ptr;
+    }
+
+    void Release(Device host, void* ptr) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& idle = idle_[host.device_type];
+            if (idle.size() < kMaxIdleStagingBuffers) {
+                idle.push_back(ptr);
+                return;
+            }
+        }
+        DeviceAPI::Get(host)->FreeDataSpace(host, ptr);
+        DeviceAPI::RecordFree(host, kStagingChunkBytes, DeviceMemoryKind::kWorkspace);
+    }
+
+    static StagingBufferPool* Global() {
+        // NOTE: explicitly use new to avoid exit-time destruction of global state
+        static auto* inst = new StagingBufferPool();
+        return inst;
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<int, std::vector<void*>> idle_;
+};
+
+// A staging buffer borrowed from the pool for the lifetime of the object.
+class StagingBuffer {
+public:
+    explicit StagingBuffer(Device host) : host_(host), data_(StagingBufferPool::Global()->Acquire(host)) {}
+    ~StagingBuffer() { StagingBufferPool::Global()->Release(host_, data_); }
+    StagingBuffer(const StagingBuffer&) = delete;
+    StagingBuffer& operator=(const StagingBuffer&) = delete;
+
+    void* data() const { return data_; }
+
+private:
+    Device host_;
+    void* data_;
+};
+
+// Runs the copy tasks of one device and stream in submission order, on a
+// thread that is started when tasks are queued and exits once they drain.
+class CopyEngine {
+public:
+    // Run task for state. A task that may run inline runs on the caller when
+    // nothing is queued, so small copies skip the thread hop and still keep
+    // their order after earlier pipelined ones.
+    void Submit(const std::shared_ptr<CopyHandle::State>& state, std::function<void()> task,
+                bool may_run_inline) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!may_run_inline || pending_ != 0) {
+                queue_.emplace_back(state, std::move(task));
+                if (pending_++ == 0) {
+                    std::thread([this] { Run(); }).detach();
+                }
+                return;
+            }
+        }
+        std::exception_ptr error;
+        try {
+            task();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        Finish(state.get(), std::move(error));
+    }
+
+    // The engine of the device and stream, copies on different ones do not wait for each other.
+    static CopyEngine* Get(Device dev, TVMStreamHandle stream) {
+        // NOTE: explicitly use new to avoid exit-time destruction of global state
+        static auto* mutex = new std::mutex();
+        static auto* engines = new std::map<std::tuple<int, int, TVMStreamHandle>, CopyEngine*>();
+        std::lock_guard<std::mutex> lock(*mutex);
+        CopyEngine*& engine = (*engines)[std::make_tuple(static_cast<int>(dev.device_type), dev.device_id, stream)];
+        if (engine == nullptr) engine = new CopyEngine();
+        return engine;
+    }
+
+private:
+    static void Finish(CopyHandle::State* state, std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->done = true;
+        state->error = std::move(error);
+        state->cv.notify_all();
+    }
+
+    void Run() {
+        while (true) {
+            std::pair<std::shared_ptr<CopyHandle::State>, std::function<void()>> item;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                item = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            std::exception_ptr error;
+            try {
+                item.second();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            // finish before giving up the order, so an inline task submitted
+            // next is never completed ahead of this one
+            Finish(item.first.get(), std::move(error));
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) return;
+        }
+    }
+
+    std::mutex mutex_;
+    std::deque<std::pair<std::shared_ptr<CopyHandle::State>, std::function<void()>>> queue_;
+    // tasks queued or running on the copy thread, which runs while this is not 0
+    size_t pending_{0};
+};
+
+// A flat byte view of a contiguous tensor starting byte_offset bytes into data.
+DLTensor ByteView(void* data, Device dev, uint64_t byte_offset, int64_t* nbytes) {
+    DLTensor view;
+    view.data = data;
+    view.device = dev;
+    view.ndim = 1;
+    view.dtype = DLDataType{kDLUInt, 8, 1};
+    view.shape = nbytes;
+    view.strides = nullptr;
+    view.byte_offset = byte_offset;
+    return view;
+}
+
+// Whether a copy goes through staging buffers: a large contiguous copy
+// between pageable CPU memory and memory that is not on the host.
+bool UseStaging(const DLTensor* from, const DLTensor* to, size_t nbytes) {
+    if (nbytes <= kStagingChunkBytes) return false;
+    bool from_cpu = from->device.device_type == kDLCPU;
+    bool to_cpu = to->device.device_type == kDLCPU;
+    if (from_cpu == to_cpu) return false;
+    int other = from_cpu ? to->device.device_type : from->device.device_type;
+    if (other == kDLCUDAHost || other == kDLROCMHost) return false;
+    return IsContiguous(*from) && IsContiguous(*to);
+}
+
+// Copy host bytes to a device tensor, filling one staging buffer while the
+// device reads the other. Returns once every chunk has landed.
+void StagedCopyToDevice(const char* src, DLTensor to, size_t nbytes, Device host,
+                        TVMStreamHandle stream) {
+    DeviceAPI* api = DeviceAPI::Get(to.device);
+    StagingBuffer bufs[2] = {StagingBuffer(host), StagingBuffer(host)};
+    int64_t sizes[2];
+    for (size_t offset = 0, i = 0; offset < nbytes; offset += kStagingChunkBytes, ++i) {
+        size_t k = i % 2;
+        sizes[k] = static_cast<int64_t>(std::min(kStagingChunkBytes, nbytes - offset));
+        std::memcpy(bufs[k].data(), src + offset, sizes[k]);
+        // retire the previous chunk, which also frees the buffer filled next
+        if (i != 0) api->StreamSync(to.device, stream);
+        DLTensor chunk_from = ByteView(bufs[k].data(), host, 0, &sizes[k]);
+        DLTensor chunk_to = ByteView(to.data, to.device, to.byte_offset + offset, &sizes[k]);
+        api->CopyDataFromTo(&chunk_from, &chunk_to, stream);
+    }
+    api->StreamSync(to.device, stream);
+}
+
+// Copy a device tensor to host bytes, draining one staging buffer while the
+// device fills the other.
+void StagedCopyToHost(DLTensor from, char* dst, size_t nbytes, Device host, TVMStreamHandle stream) {
+    DeviceAPI* api = DeviceAPI::Get(from.device);
+    StagingBuffer bufs[2] = {StagingBuffer(host), StagingBuffer(host)};
+    int64_t sizes[2];
+    auto issue = [&](size_t offset, size_t k) {
+        sizes[k] = static_cast<int64_t>(std::min(kStagingChunkBytes, nbytes - offset));
+        DLTensor chunk_from = ByteView(from.data, from.device, from.byte_offset + offset, &sizes[k]);
+        DLTensor chunk_to = ByteView(bufs[k].data(), host, 0, &sizes[k]);
+        api->CopyDataFromTo(&chunk_from, &chunk_to, stream);
+    };
+    issue(0, 0);
+    for (size_t offset = 0, i = 0; offset < nbytes; offset += kStagingChunkBytes, ++i) {
+        size_t k = i % 2;
+        api->StreamSync(from.device, stream);
+        if (offset + kStagingChunkBytes < nbytes) issue(offset + kStagingChunkBytes, 1 - k);
+        std::memcpy(dst + offset, bufs[k].data(), sizes[k]);
+    }
+}
+
+}// namespace
+
+CopyHandle NDArray::CopyFromToAsync(const DLTensor* from, DLTensor* to, TVMStreamHandle stream) {
+    size_t nbytes = GetDataSize(*from);
+    ICHECK_EQ(nbytes, GetDataSize(*to)) << "CopyFromToAsync: The size in bytes must exactly match.";
+
+    auto state = std::make_shared<CopyHandle::State>();
+    state->dev = from->device.device_type != kDLCPU ? from->device : to->device;
+    state->stream = stream;
+    // the tasks keep copies of the tensor headers, shape and strides still
+    // point into the caller's arrays
+    DLTensor src = *from;
+    DLTensor dst = *to;
+    if (!UseStaging(from, to, nbytes)) {
+        CopyEngine::Get(state->dev, stream)->Submit(
+                state, [src, dst, stream]() mutable { CopyFromTo(&src, &dst, stream); }, true);
+        return CopyHandle(state);
+    }
+    Device host = GetPreferredHostDevice(state->dev);
+    std::function<void()> task;
+    if (src.device.device_type == kDLCPU) {
+        const char* bytes = static_cast<const char*>(src.data) + src.byte_offset;
+        task = [bytes, dst, nbytes, host, stream] { StagedCopyToDevice(bytes, dst, nbytes, host, stream); };
+    } else {
+        char* bytes = static_cast<char*>(dst.data) + dst.byte_offset;
+        task = [src, bytes, nbytes, host, stream] { StagedCopyToHost(src, bytes, nbytes, host, stream); };
+    }
+    CopyEngine::Get(state->dev, stream)->Submit(state, std::move(task), false);
+    return CopyHandle(state);
+}
+
+}// namespace litetvm::runtime
@@ -2,21 +2,33 @@
 // Created by richard on 2/5/25.
 //
 
+#include "ffi/container/tensor.h"
 #include "ffi/reflection/registry.h"
+#include "memory_copy.h"
 #include "runtime/device_api.h"
 #include "runtime/logging.h"
+#include "runtime/threading_backend.h"
 #include "workspace_pool.h"
 
 #include <dmlc/thread_local.h>
 
+#include <atomic>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #ifdef __ANDROID__
 #include <android/api-level.h>
 #endif
 
 #if defined(__linux__) || defined(__ANDROID__)
+#include <sys/mman.h>
 #include <sys/sysinfo.h>
+#include <fstream>
+#include <unordered_map>
 #endif
 
 #ifdef _WIN32
@@ -30,6 +42,53 @@
 
 namespace litetvm {
 namespace runtime {
+namespace {
+
+/*! \brief Large page policy of big allocations, values of kHugePageMode. */
+enum HugePageMode : int {
+    kHugePageOff = 0,
+    kHugePageTransparent = 1,
+    kHugePageHugeTLB = 2,
+};
+
+// big weight tensors cross this easily, activations and small buffers do not
+constexpr int64_t kDefaultHugePageThreshold = int64_t{32} << 20;
+constexpr size_t kDefaultHugePageSize = size_t{2} << 20;
+
+int GetDefaultHugePageMode() {
+    const char* val = getenv("TVM_CPU_HUGEPAGE");
+    if (!val) return kHugePageOff;
+    std::string mode(val);
+    if (mode == "off" || mode == "0") return kHugePageOff;
+    if (mode == "hugetlb" || mode == "2") return kHugePageHugeTLB;
+    return kHugePageTransparent;
+}
+
+int64_t GetDefaultHugePageThreshold() {
+    const char* val = getenv("TVM_CPU_HUGEPAGE_THRESHOLD");
+    if (!val) return kDefaultHugePageThreshold;
+    return atoll(val);
+}
+
+// Read the default huge page size from /proc/meminfo.
+size_t GetHugePageSize() {
+#if defined(__linux__)
+    std::ifstream ifs("/proc/meminfo");
+    std::string key;
+    while (ifs >> key) {
+        if (key == "Hugepagesize:") {
+            size_t kb;
+            if (ifs >> kb) return kb << 10;
+            break;
+        }
+        ifs.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+#endif
+    return kDefaultHugePageSize;
+}
+
+}// namespace
+
 class CPUDeviceAPI final : public DeviceAPI {
 public:
     void SetDevice(Device dev) final {}
@@ -41,6 +100,15 @@ public:
         switch (kind) {
             case kExist:
                 break;
+            case kHugePageMode:
+                *rv = huge_page_mode_.load(std::memory_order_relaxed);
+                break;
+            case kHugePageThreshold:
+                *rv = huge_page_threshold_.load(std::memory_order_relaxed);
+                break;
+            case kHugePageSize:
+                *rv = static_cast<int64_t>(huge_page_size_);
+                break;
             case kTotalGlobalMemory: {
 #if defined(__linux__) || defined(__ANDROID__)
                 struct sysinfo info;
@@ -68,13 +136,39 @@ public:
 #else
                 *rv = -1;
 #endif
+                break;
             }
             default:
                 break;
         }
     }
+
+    void SetAttr(Device dev, DeviceAttrKind kind, const ffi::Any& value) final {
+        switch (kind) {
+            case kHugePageMode: {
+                int mode = value.cast<int>();
+                CHECK(mode >= kHugePageOff && mode <= kHugePageHugeTLB) << "Invalid huge page mode " << mode;
+                huge_page_mode_.store(mode);
+                break;
+            }
+            case kHugePageThreshold:
+                huge_page_threshold_.store(value.cast<int64_t>());
+                break;
+            default:
+                DeviceAPI::SetAttr(dev, kind, value);
+        }
+    }
+
     void* AllocDataSpace(Device dev, size_t nbytes, size_t alignment, DLDataType type_hint) final {
         void* ptr;
+#if defined(__linux__)
+        if (huge_page_mode_.load(std::memory_order_relaxed) != kHugePageOff &&
+            static_cast<int64_t>(nbytes) >= huge_page_threshold_.load(std::memory_order_relaxed) &&
+            alignment <= huge_page_size_) {
+            ptr = AllocLargePages(nbytes);
+            if (ptr != nullptr) return ptr;
+        }
+#endif
 #if _MSC_VER
         ptr = _aligned_malloc(nbytes, alignment);
         if (ptr == nullptr) throw std::bad_alloc();
@@ -90,6 +184,13 @@ public:
     }
 
     void FreeDataSpace(Device dev, void* ptr) final {
+#if defined(__linux__)
+        // mappings start on a huge page boundary, other frees skip the lock
+        if (reinterpret_cast<uintptr_t>(ptr) % huge_page_size_ == 0 &&
+            num_mapped_.load(std::memory_order_acquire) != 0 && FreeLargePages(ptr)) {
+            return;
+        }
+#endif
 #if _MSC_VER
         _aligned_free(ptr);
 #else
@@ -97,6 +198,14 @@ public:
 #endif
     }
 
+    void CopyDataFromTo(DLTensor* from, DLTensor* to, TVMStreamHandle stream) final {
+        if (ffi::IsContiguous(*from) && ffi::IsContiguous(*to)) {
+            DeviceAPI::CopyDataFromTo(from, to, stream);
+        } else {
+            CopyStridedTensor(from, to);
+        }
+    }
+
     void StreamSync(Device dev, TVMStreamHandle stream) final {}
 
     void* AllocWorkspace(Device dev, size_t size, DLDataType type_hint) final;
@@ -115,20 +224,163 @@ protected:
     void CopyDataFromTo(const void* from, size_t from_offset, void* to, size_t to_offset, size_t size,
                         Device dev_from, Device dev_to, DLDataType type_hint,
                         TVMStreamHandle stream) final {
-        memcpy(static_cast<char*>(to) + to_offset, static_cast<const char*>(from) + from_offset, size);
+        CopyBytes(static_cast<char*>(to) + to_offset, static_cast<const char*>(from) + from_offset, size);
     }
+
+private:
+#if defined(__linux__)
+    /*!
+   * \brief Map nbytes backed by large pages, aligned to the huge page size.
+   *
+   *  kHugePageHugeTLB asks for explicit pages from the hugetlbfs pool and
+   *  falls back to transparent huge pages when the pool is exhausted.
+   * \return The mapping, nullptr to fall back to posix_memalign.
+   */
+    void* AllocLargePages(size_t nbytes) {
+        size_t length = (nbytes + huge_page_size_ - 1) / huge_page_size_ * huge_page_size_;
+        void* ptr = MAP_FAILED;
+        if (huge_page_mode_.load(std::memory_order_relaxed) == kHugePageHugeTLB) {
+            ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (ptr == MAP_FAILED) {
+            // over-map by one huge page and trim, so THP can back every aligned region
+            size_t span = length + huge_page_size_;
+            void* raw = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED) return nullptr;
+            uintptr_t begin = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t aligned = (begin + huge_page_size_ - 1) / huge_page_size_ * huge_page_size_;
+            if (aligned != begin) munmap(raw, aligned - begin);
+            size_t tail = begin + span - (aligned + length);
+            if (tail != 0) munmap(reinterpret_cast<void*>(aligned + length), tail);
+            ptr = reinterpret_cast<void*>(aligned);
+            madvise(ptr, length, MADV_HUGEPAGE);
+        }
+        std::lock_guard<std::mutex> lock(mapped_mutex_);
+        mapped_[ptr] = length;
+        num_mapped_.fetch_add(1, std::memory_order_release);
+        return ptr;
+    }
+
+    // Unmap ptr if it came from AllocLargePages.
+    bool FreeLargePages(void* ptr) {
+        size_t length;
+        {
+            std::lock_guard<std::mutex> lock(mapped_mutex_);
+            auto it = mapped_.find(ptr);
+            if (it == mapped_.end()) return false;
+            length = it->second;
+            mapped_.erase(it);
+            num_mapped_.fetch_sub(1, std::memory_order_release);
+        }
+        munmap(ptr, length);
+        return true;
+    }
+
+    /*! \brief large page mappings and their lengths */
+    std::unordered_map<void*, size_t> mapped_;
+    std::mutex mapped_mutex_;
+    std::atomic<int> num_mapped_{0};
+#endif
+    std::atomic<int> huge_page_mode_{GetDefaultHugePageMode()};
+    std::atomic<int64_t> huge_page_threshold_{GetDefaultHugePageThreshold()};
+    const size_t huge_page_size_{GetHugePageSize()};
 };
 
 struct CPUWorkspacePool : public WorkspacePool {
     CPUWorkspacePool() : WorkspacePool(kDLCPU, CPUDeviceAPI::Global()) {}
 };
 
+/*!
+ * \brief One workspace pool per NUMA node, used once workers are placed with
+ *  ThreadGroup::kNuma.
+ *
+ *  The pages of a node's pool are allocated and first written by threads
+ *  running on that node, so the kernel backs them with node-local memory,
+ *  and they are only ever handed out again to threads of the same node.
+ */
+class NumaWorkspacePools {
+public:
+    static NumaWorkspacePools* Global() {
+        // NOTE: explicitly use new to avoid exit-time destruction of global state
+        static auto* inst = new NumaWorkspacePools();
+        return inst;
+    }
+
+    void* AllocWorkspace(int node, Device dev, size_t size) {
+        Node& n = *nodes_[node];
+        std::lock_guard<std::mutex> lock(n.mutex);
+        return n.pool.AllocWorkspace(dev, size);
+    }
+
+    // Free data to the node pool it came from, trying first_node first, false if no node pool holds it.
+    bool FreeWorkspace(int first_node, Device dev, void* data) {
+        if (first_node >= 0 && TryFree(first_node, dev, data)) return true;
+        for (int node = 0; node < num_nodes(); ++node) {
+            if (node != first_node && TryFree(node, dev, data)) return true;
+        }
+        return false;
+    }
+
+    int num_nodes() const { return static_cast<int>(nodes_.size()); }
+
+private:
+    struct Node {
+        std::mutex mutex;
+        CPUWorkspacePool pool;
+    };
+
+    bool TryFree(int node, Device dev, void* data) {
+        Node& n = *nodes_[node];
+        std::lock_guard<std::mutex> lock(n.mutex);
+        return n.pool.TryFreeWorkspace(dev, data);
+    }
+
+    NumaWorkspacePools() {
+        for (int i = 0; i < threading::NumaNodeCount(); ++i) {
+            nodes_.emplace_back(new Node());
+        }
+    }
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+};
+
+/*!
+ * \brief The NUMA node whose pool serves new workspace of the calling thread,
+ *  -1 for the thread local pool.
+ *
+ *  Decided on the first workspace request of a thread and again whenever the
+ *  placement is reconfigured. Pinned workers never change node in between.
+ */
+int WorkspaceNode() {
+    thread_local uint64_t generation = 0;
+    thread_local int node = -1;
+    uint64_t current = threading::NumaPlacementGeneration();
+    if (current != generation) {
+        generation = current;
+        node = threading::NumaPlacementEnabled()
+                       ? std::min(threading::CurrentNumaNode(), NumaWorkspacePools::Global()->num_nodes() - 1)
+                       : -1;
+    }
+    return node;
+}
+
 void* CPUDeviceAPI::AllocWorkspace(Device dev, size_t size, DLDataType type_hint) {
+    int node = WorkspaceNode();
+    if (node >= 0) {
+        return NumaWorkspacePools::Global()->AllocWorkspace(node, dev, size);
+    }
     return dmlc::ThreadLocalStore<CPUWorkspacePool>::Get()->AllocWorkspace(dev, size);
 }
 
 void CPUDeviceAPI::FreeWorkspace(Device dev, void* data) {
-    dmlc::ThreadLocalStore<CPUWorkspacePool>::Get()->FreeWorkspace(dev, data);
+    // the pool that made the block, whatever the placement is now, each pool
+    // knows its own live blocks so the likely owner is asked first
+    CPUWorkspacePool* local = dmlc::ThreadLocalStore<CPUWorkspacePool>::Get();
+    int node = WorkspaceNode();
+    if (node < 0 && local->TryFreeWorkspace(dev, data)) return;
+    if (NumaWorkspacePools::Global()->FreeWorkspace(node, dev, data)) return;
+    local->FreeWorkspace(dev, data);
 }
 
 TVM_FFI_STATIC_INIT_BLOCK({
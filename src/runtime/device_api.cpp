@@ -3,6 +3,8 @@
 //
 
 #include "runtime/device_api.h"
+#include "ffi/container/array.h"
+#include "ffi/container/map.h"
 #include "ffi/container/tensor.h"
 #include "ffi/function.h"
 #include "ffi/optional.h"
@@ -12,9 +14,12 @@
 #include "runtime/base.h"
 #include "runtime/c_backend_api.h"
 #include "runtime/module.h"
+#include "workspace_planner.h"
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cctype>
 #include <cstdlib>
 #include <sstream>
@@ -93,6 +98,129 @@ static size_t GetDataAlignment(const DLDataType dtype) {
     return align;
 }
 
+/*!
+ * \brief Allocation counters of every device.
+ *
+ *  Counters are created on the first allocation of a device and never freed,
+ *  so the recording paths only touch atomics.
+ */
+class DeviceMemoryTracker {
+public:
+    struct Counters {
+        std::atomic<int64_t> current_bytes{0};
+        std::atomic<int64_t> peak_bytes{0};
+        // peak of the innermost open window, see StartPeakWindow
+        std::atomic<int64_t> window_peak_bytes{0};
+        std::atomic<int64_t> alloc_count{0};
+        std::atomic<int64_t> free_count{0};
+        std::atomic<int64_t> kind_bytes[2]{};
+        std::atomic<int64_t> histogram[DeviceMemoryStats::kNumBuckets]{};
+    };
+
+    static DeviceMemoryTracker* Global() {
+        // NOTE: explicitly use new to avoid exit-time destruction of global state
+        static auto* inst = new DeviceMemoryTracker();
+        return inst;
+    }
+
+    // Counters of dev, nullptr if it has none and create is false.
+    Counters* Get(Device dev, bool create) {
+        int type = static_cast<int>(dev.device_type);
+        if (type < 0 || type >= kMaxDeviceType || dev.device_id < 0 || dev.device_id >= kMaxDeviceId) {
+            return nullptr;
+        }
+        std::atomic<Counters*>& slot = table_[type][dev.device_id];
+        Counters* counters = slot.load(std::memory_order_acquire);
+        if (counters != nullptr || !create) return counters;
+        auto* fresh = new Counters();
+        if (slot.compare_exchange_strong(counters, fresh, std::memory_order_acq_rel)) return fresh;
+        delete fresh;
+        return counters;
+    }
+
+private:
+    static constexpr int kMaxDeviceType = TVMDeviceExtType_End;
+    static constexpr int kMaxDeviceId = 64;
+    std::atomic<Counters*> table_[kMaxDeviceType][kMaxDeviceId]{};
+};
+
+void DeviceAPI::RecordAlloc(Device dev, size_t nbytes, DeviceMemoryKind kind) {
+    auto* c = DeviceMemoryTracker::Global()->Get(dev, true);
+    if (c == nullptr) return;
+    int64_t bytes = static_cast<int64_t>(nbytes);
+    int64_t current = c->current_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = c->peak_bytes.load(std::memory_order_relaxed);
+    while (current > peak &&
+           !c->peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+    }
+    int64_t window_peak = c->window_peak_bytes.load(std::memory_order_relaxed);
+    while (current > window_peak &&
+           !c->window_peak_bytes.compare_exchange_weak(window_peak, current, std::memory_order_relaxed)) {
+    }
+    c->alloc_count.fetch_add(1, std::memory_order_relaxed);
+    c->kind_bytes[static_cast<int>(kind)].fetch_add(bytes, std::memory_order_relaxed);
+    int bucket = nbytes == 0 ? 0 : std::bit_width(nbytes) - 1;
+    c->histogram[std::min(bucket, DeviceMemoryStats::kNumBuckets - 1)].fetch_add(
+            1, std::memory_order_relaxed);
+}
+
+void DeviceAPI::RecordFree(Device dev, size_t nbytes, DeviceMemoryKind kind) {
+    auto* c = DeviceMemoryTracker::Global()->Get(dev, true);
+    if (c == nullptr) return;
+    int64_t bytes = static_cast<int64_t>(nbytes);
+    c->current_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    c->free_count.fetch_add(1, std::memory_order_relaxed);
+    c->kind_bytes[static_cast<int>(kind)].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+DeviceMemoryStats DeviceAPI::GetMemoryStats(Device dev) {
+    DeviceMemoryStats stats;
+    auto* c = DeviceMemoryTracker::Global()->Get(dev, false);
+    if (c == nullptr) return stats;
+    stats.current_bytes = c->current_bytes.load(std::memory_order_relaxed);
+    stats.peak_bytes = c->peak_bytes.load(std::memory_order_relaxed);
+    stats.alloc_count = c->alloc_count.load(std::memory_order_relaxed);
+    stats.free_count = c->free_count.load(std::memory_order_relaxed);
+    stats.ndarray_bytes =
+            c->kind_bytes[static_cast<int>(DeviceMemoryKind::kNDArray)].load(std::memory_order_relaxed);
+    stats.workspace_bytes =
+            c->kind_bytes[static_cast<int>(DeviceMemoryKind::kWorkspace)].load(std::memory_order_relaxed);
+    for (int i = 0; i < DeviceMemoryStats::kNumBuckets; ++i) {
+        stats.histogram[i] = c->histogram[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void DeviceAPI::ResetPeakMemory(Device dev) {
+    auto* c = DeviceMemoryTracker::Global()->Get(dev, false);
+    if (c == nullptr) return;
+    c->peak_bytes.store(c->current_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+int64_t DeviceAPI::StartPeakWindow(Device dev) {
+    auto* c = DeviceMemoryTracker::Global()->Get(dev, true);
+    if (c == nullptr) return 0;
+    return c->window_peak_bytes.exchange(c->current_bytes.load(std::memory_order_relaxed),
+                                         std::memory_order_relaxed);
+}
+
+int64_t DeviceAPI::StopPeakWindow(Device dev, int64_t outer_peak) {
+    auto* c = DeviceMemoryTracker::Global()->Get(dev, true);
+    if (c == nullptr) return 0;
+    int64_t peak = c->window_peak_bytes.load(std::memory_order_relaxed);
+    // hand the enclosing window the higher of its own peak and this one
+    int64_t window_peak = peak;
+    while (outer_peak > window_peak &&
+           !c->window_peak_bytes.compare_exchange_weak(window_peak, outer_peak, std::memory_order_relaxed)) {
+    }
+    return peak;
+}
+
+void DeviceAPI::SetAttr(Device dev, DeviceAttrKind kind, const Any& value) {
+    LOG(FATAL) << "Device " << DLDeviceType2Str(dev.device_type)
+               << " does not support setting attribute " << static_cast<int>(kind);
+}
+
 size_t DeviceAPI::GetDataSize(const DLTensor& arr, const Optional<String>& mem_scope) {
     if (!mem_scope.has_value() || mem_scope.value().empty() || mem_scope.value() == "global") {
         size_t size = 1;
@@ -208,6 +336,38 @@ TVM_FFI_STATIC_INIT_BLOCK({
                                 DeviceAPIManager::Get(dev)->GetAttr(dev, kind, ret);
                             }
                         })
+            .def_packed("runtime.SetDeviceAttr",
+                        [](litetvm::ffi::PackedArgs args, litetvm::ffi::Any* ret) {
+                            DLDevice dev;
+                            dev.device_type = static_cast<DLDeviceType>(args[0].cast<int>());
+                            dev.device_id = args[1].cast<int>();
+                            DeviceAttrKind kind = static_cast<DeviceAttrKind>(args[2].cast<int>());
+                            DeviceAPIManager::Get(dev)->SetAttr(dev, kind, args[3]);
+                        })
+            .def("runtime.DeviceMemoryStats",
+                 [](int device_type, int device_id) {
+                     Device dev;
+                     dev.device_type = static_cast<DLDeviceType>(device_type);
+                     dev.device_id = device_id;
+                     DeviceMemoryStats stats = DeviceAPI::GetMemoryStats(dev);
+                     ffi::Array<int64_t> histogram(stats.histogram.begin(), stats.histogram.end());
+                     ffi::Map<ffi::String, ffi::Any> ret;
+                     ret.Set("current_bytes", stats.current_bytes);
+                     ret.Set("peak_bytes", stats.peak_bytes);
+                     ret.Set("alloc_count", stats.alloc_count);
+                     ret.Set("free_count", stats.free_count);
+                     ret.Set("ndarray_bytes", stats.ndarray_bytes);
+                     ret.Set("workspace_bytes", stats.workspace_bytes);
+                     ret.Set("histogram", histogram);
+                     return ret;
+                 })
+            .def("runtime.DeviceMemoryResetPeak",
+                 [](int device_type, int device_id) {
+                     Device dev;
+                     dev.device_type = static_cast<DLDeviceType>(device_type);
+                     dev.device_id = device_id;
+                     DeviceAPI::ResetPeakMemory(dev);
+                 })
             .def("runtime.TVMSetStream", [](int device_type, int device_id, void* stream) {
                 Device dev;
                 dev.device_type = static_cast<DLDeviceType>(device_type);
@@ -238,6 +398,10 @@ void* TVMBackendAllocWorkspace(int device_type, int device_id, uint64_t size, in
     type_hint.bits = static_cast<decltype(type_hint.bits)>(dtype_bits_hint);
     type_hint.lanes = 1;
 
+    litetvm::runtime::WorkspacePlanner* planner = litetvm::runtime::WorkspacePlanner::ThreadLocal();
+    if (planner->active()) {
+        if (void* ptr = planner->Alloc(dev, size)) return ptr;
+    }
     return DeviceAPIManager::Get(dev)->AllocWorkspace(dev, size, type_hint);
 }
 
@@ -245,6 +409,8 @@ int TVMBackendFreeWorkspace(int device_type, int device_id, void* ptr) {
     DLDevice dev;
     dev.device_type = static_cast<DLDeviceType>(device_type);
     dev.device_id = device_id;
+    litetvm::runtime::WorkspacePlanner* planner = litetvm::runtime::WorkspacePlanner::ThreadLocal();
+    if (planner->active() && planner->Free(dev, ptr)) return 0;
     DeviceAPIManager::Get(dev)->FreeWorkspace(dev, ptr);
     return 0;
 }
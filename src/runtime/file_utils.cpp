@@ -7,13 +7,33 @@
 #include "ffi/reflection/registry.h"
 #include "runtime/logging.h"
 #include "runtime/serializer.h"
+#include "runtime/threading_backend.h"
 
 #include <dmlc/json.h>
 #include <dmlc/memory_io.h>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#endif
+
 namespace litetvm {
 namespace runtime {
 
@@ -113,20 +133,16 @@ std::string GetFileBasename(const std::string& file_name) {
 }
 
 void LoadBinaryFromFile(const std::string& file_name, std::string* data) {
-    std::ifstream fs(file_name, std::ios::in | std::ios::binary);
-    CHECK(!fs.fail()) << "Cannot open " << file_name;
-    // get its size:
-    fs.seekg(0, std::ios::end);
-    size_t size = static_cast<size_t>(fs.tellg());
-    fs.seekg(0, std::ios::beg);
+    BufferedFileStream strm(file_name, "rb");
+    size_t size = static_cast<size_t>(strm.file_size());
     data->resize(size);
-    fs.read(&(*data)[0], size);
+    CHECK_EQ(strm.Read(data->data(), size), size) << "Unable to read " << file_name;
 }
 
 void SaveBinaryToFile(const std::string& file_name, const std::string& data) {
-    std::ofstream fs(file_name, std::ios::out | std::ios::binary);
-    CHECK(!fs.fail()) << "Cannot open " << file_name;
-    fs.write(&data[0], data.length());
+    BufferedFileStream strm(file_name, "wb");
+    strm.Write(data.data(), data.size());
+    strm.Close();
 }
 
 void SaveMetaDataToFile(const std::string& file_name,
@@ -177,34 +193,1079 @@ void CopyFile(const std::string& src_file_name, const std::string& dest_file_nam
                 << " dest='" << dest_file_name << "'";
 }
 
-Map<String, NDArray> LoadParams(const std::string& param_blob) {
-    dmlc::MemoryStringStream strm(const_cast<std::string*>(&param_blob));
-    return LoadParams(&strm);
+MappedFile::MappedFile(const std::string& path) {
+#if !defined(_WIN32)
+    int fd = open(path.c_str(), O_RDONLY);
+    CHECK_GE(fd, 0) << "Unable to open file " << path << ": " << std::strerror(errno);
+    struct stat st;
+    CHECK_EQ(fstat(fd, &st), 0) << "Unable to stat file " << path << ": " << std::strerror(errno);
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ != 0) {
+        void* ptr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        CHECK(ptr != MAP_FAILED) << "Unable to map file " << path << ": " << std::strerror(errno);
+        data_ = static_cast<char*>(ptr);
+        mapped_ = true;
+    }
+    close(fd);
+#else
+    std::string bytes;
+    LoadBinaryFromFile(path, &bytes);
+    size_ = bytes.size();
+    if (size_ != 0) {
+        data_ = static_cast<char*>(_aligned_malloc(size_, kAllocAlignment));
+        CHECK(data_ != nullptr) << "Out of memory reading " << path;
+        std::memcpy(data_, bytes.data(), size_);
+    }
+#endif
 }
 
-Map<String, NDArray> LoadParams(dmlc::Stream* strm) {
-    Map<String, NDArray> params;
+MappedFile::~MappedFile() {
+    if (data_ == nullptr) return;
+#if !defined(_WIN32)
+    if (mapped_) munmap(data_, size_);
+#else
+    _aligned_free(data_);
+#endif
+}
+
+namespace {
+
+// read until size bytes arrived or the file ended, returns the bytes read or -1.
+int64_t ReadFull(int fd, void* buf, size_t size) {
+    auto* p = static_cast<char*>(buf);
+    size_t done = 0;
+    while (done < size) {
+#if !defined(_WIN32)
+        ssize_t n = read(fd, p + done, size - done);
+#else
+        int n = _read(fd, p + done, static_cast<unsigned>(std::min<size_t>(size - done, std::numeric_limits<int>::max())));
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        done += n;
+    }
+    return static_cast<int64_t>(done);
+}
+
+// write until size bytes left, returns an error message on failure.
+std::string WriteFull(int fd, const void* buf, size_t size) {
+    auto* p = static_cast<const char*>(buf);
+    while (size != 0) {
+#if !defined(_WIN32)
+        ssize_t n = write(fd, p, size);
+#else
+        int n = _write(fd, p, static_cast<unsigned>(std::min<size_t>(size, std::numeric_limits<int>::max())));
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return std::strerror(errno);
+        p += n;
+        size -= n;
+    }
+    return "";
+}
+
+}// namespace
+
+BufferedFileStream::BufferedFileStream(const std::string& path, const std::string& mode,
+                                       const FileStreamOptions& options)
+    : path_(path) {
+    CHECK(mode == "wb" || mode == "rb") << "Only allowed modes are 'wb' and 'rb'";
+    read_ = mode == "rb";
+    capacity_ = std::max<size_t>((options.buffer_size + kDirectIOAlignment - 1) / kDirectIOAlignment, 1) *
+                kDirectIOAlignment;
+#if !defined(_WIN32)
+    int flags = read_ ? O_RDONLY : O_WRONLY | O_CREAT | O_TRUNC;
+#if defined(O_DIRECT)
+    if (options.direct) {
+        // file systems without direct I/O, e.g. tmpfs, refuse the flag
+        fd_ = open(path.c_str(), flags | O_DIRECT, 0644);
+        direct_ = fd_ >= 0;
+    }
+#endif
+    if (fd_ < 0) fd_ = open(path.c_str(), flags, 0644);
+    CHECK_GE(fd_, 0) << "Unable to open file " << path << ": " << std::strerror(errno);
+    struct stat st;
+    CHECK_EQ(fstat(fd_, &st), 0) << "Unable to stat file " << path << ": " << std::strerror(errno);
+    file_size_ = static_cast<uint64_t>(st.st_size);
+#if defined(POSIX_FADV_SEQUENTIAL)
+    if (options.sequential) posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    void* ptr = nullptr;
+    CHECK_EQ(posix_memalign(&ptr, kDirectIOAlignment, capacity_), 0) << "Out of memory opening " << path;
+    buf_ = static_cast<char*>(ptr);
+#else
+    int flags = read_ ? _O_RDONLY : _O_WRONLY | _O_CREAT | _O_TRUNC;
+    fd_ = _open(path.c_str(), flags | _O_BINARY, _S_IREAD | _S_IWRITE);
+    CHECK_GE(fd_, 0) << "Unable to open file " << path << ": " << std::strerror(errno);
+    struct _stat64 st;
+    CHECK_EQ(_fstat64(fd_, &st), 0) << "Unable to stat file " << path << ": " << std::strerror(errno);
+    file_size_ = static_cast<uint64_t>(st.st_size);
+    buf_ = static_cast<char*>(_aligned_malloc(capacity_, kDirectIOAlignment));
+    CHECK(buf_ != nullptr) << "Out of memory opening " << path;
+#endif
+}
+
+BufferedFileStream::~BufferedFileStream() {
+    // writers call Close() themselves to see errors, a destructor must not throw
+    try {
+        Close();
+    } catch (const std::exception& e) {
+        LOG(ERROR) << e.what();
+    }
+#if !defined(_WIN32)
+    free(buf_);
+#else
+    _aligned_free(buf_);
+#endif
+}
+
+size_t BufferedFileStream::Read(void* ptr, size_t size) {
+    CHECK(read_) << "File opened in write-mode, cannot read.";
+    CHECK_GE(fd_, 0) << "File is closed";
+    auto* p = static_cast<char*>(ptr);
+    size_t done = 0;
+    while (done < size) {
+        if (pos_ == end_) {
+            if (!direct_ && size - done >= capacity_) {
+                // large reads skip the buffer
+                int64_t n = ReadFull(fd_, p + done, size - done);
+                CHECK_GE(n, 0) << "Unable to read " << path_ << ": " << std::strerror(errno);
+                done += static_cast<size_t>(n);
+                break;
+            }
+            if (!Fill()) break;
+        }
+        size_t n = std::min(end_ - pos_, size - done);
+        std::memcpy(p + done, buf_ + pos_, n);
+        pos_ += n;
+        done += n;
+    }
+    return done;
+}
+
+bool BufferedFileStream::Fill() {
+    // whole buffers keep the file offset aligned for O_DIRECT
+    int64_t n = ReadFull(fd_, buf_, capacity_);
+    CHECK_GE(n, 0) << "Unable to read " << path_ << ": " << std::strerror(errno);
+    pos_ = 0;
+    end_ = static_cast<size_t>(n);
+    return end_ != 0;
+}
+
+size_t BufferedFileStream::Write(const void* ptr, size_t size) {
+    CHECK(!read_) << "File opened in read-mode, cannot write.";
+    CHECK_GE(fd_, 0) << "File is closed";
+    const auto* p = static_cast<const char*>(ptr);
+#if !defined(_WIN32)
+    if (!direct_ && size >= capacity_) {
+        // the buffered bytes and a large write leave together
+        struct iovec iov[2] = {{buf_, end_}, {const_cast<char*>(p), size}};
+        struct iovec* cur = iov;
+        int count = 2;
+        while (count != 0) {
+            ssize_t n = writev(fd_, cur, count);
+            if (n < 0 && errno == EINTR) continue;
+            CHECK_GE(n, 0) << "Unable to write " << path_ << ": " << std::strerror(errno);
+            for (; count != 0 && static_cast<size_t>(n) >= cur->iov_len; ++cur, --count) n -= cur->iov_len;
+            if (count != 0) {
+                cur->iov_base = static_cast<char*>(cur->iov_base) + n;
+                cur->iov_len -= n;
+            }
+        }
+        end_ = 0;
+        return size;
+    }
+#endif
+    for (size_t left = size; left != 0;) {
+        size_t n = std::min(left, capacity_ - end_);
+        std::memcpy(buf_ + end_, p, n);
+        end_ += n;
+        p += n;
+        left -= n;
+        if (end_ == capacity_) Flush(false);
+    }
+    return size;
+}
+
+void BufferedFileStream::Flush(bool all) {
+    size_t n = direct_ ? end_ / kDirectIOAlignment * kDirectIOAlignment : end_;
+    std::string err = WriteFull(fd_, buf_, n);
+    CHECK(err.empty()) << "Unable to write " << path_ << ": " << err;
+    std::memmove(buf_, buf_ + n, end_ - n);
+    end_ -= n;
+#if defined(O_DIRECT)
+    if (all && end_ != 0) {
+        // O_DIRECT only moves whole blocks, the tail goes through the page cache
+        CHECK_EQ(fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT), 0)
+                << "Unable to write " << path_ << ": " << std::strerror(errno);
+        direct_ = false;
+        Flush(true);
+    }
+#endif
+}
+
+void BufferedFileStream::Close() {
+    if (fd_ < 0) return;
+    // the descriptor is released even when the last write fails
+    std::exception_ptr flush_error;
+    if (!read_) {
+        try {
+            Flush(true);
+        } catch (...) {
+            flush_error = std::current_exception();
+        }
+    }
+#if !defined(_WIN32)
+    int ret = close(fd_);
+#else
+    int ret = _close(fd_);
+#endif
+    fd_ = -1;
+    if (flush_error) std::rethrow_exception(flush_error);
+    CHECK(read_ || ret == 0) << "Unable to close " << path_ << ": " << std::strerror(errno);
+}
+
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc) {
+    // slicing-by-8 tables of the reflected Castagnoli polynomial
+    static const auto* tables = []() {
+        auto* t = new std::array<std::array<uint32_t, 256>, 8>();
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1u)));
+            (*t)[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < 8; ++k) (*t)[k][i] = ((*t)[k - 1][i] >> 8) ^ (*t)[0][(*t)[k - 1][i] & 0xFF];
+        }
+        return t;
+    }();
+    const auto& t = *tables;
+    const auto* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (; size >= 8; size -= 8, p += 8) {
+        uint32_t lo = (static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+                       static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24) ^
+                      crc;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    for (; size != 0; --size, ++p) crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+    return ~crc;
+}
+
+namespace {
+
+// Multiply a vector by a 32x32 matrix over GF(2).
+uint32_t Gf2MatrixTimes(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+    for (; vec != 0; vec >>= 1, ++mat) {
+        if (vec & 1) sum ^= *mat;
+    }
+    return sum;
+}
+
+void Gf2MatrixSquare(uint32_t* square, const uint32_t* mat) {
+    for (int n = 0; n < 32; ++n) square[n] = Gf2MatrixTimes(mat, mat[n]);
+}
+
+}// namespace
+
+uint32_t Crc32cCombine(uint32_t crc1, uint32_t crc2, size_t len2) {
+    if (len2 == 0) return crc1;
+    // operator that appends one zero bit, then squared to append zero bytes
+    uint32_t even[32], odd[32];
+    odd[0] = 0x82F63B78u;
+    for (int n = 1; n < 32; ++n) odd[n] = 1u << (n - 1);
+    Gf2MatrixSquare(even, odd);
+    Gf2MatrixSquare(odd, even);
+    // apply len2 zero bytes to crc1, one bit of len2 per squaring
+    while (true) {
+        Gf2MatrixSquare(even, odd);
+        if (len2 & 1) crc1 = Gf2MatrixTimes(even, crc1);
+        len2 >>= 1;
+        if (len2 == 0) break;
+        Gf2MatrixSquare(odd, even);
+        if (len2 & 1) crc1 = Gf2MatrixTimes(odd, crc1);
+        len2 >>= 1;
+        if (len2 == 0) break;
+    }
+    return crc1 ^ crc2;
+}
+
+namespace {
+
+// One piece of a tensor payload moved by a single task.
+struct PayloadBlock {
+    size_t tensor;
+    // offset inside the payload as stored
+    uint64_t begin;
+    uint64_t size;
+    uint32_t crc{0};
+    // offset inside the tensor data and size once decompressed
+    uint64_t out_begin{0};
+    uint64_t out_size{0};
+};
+
+// Cut payloads of the given sizes into blocks of at most block_size bytes.
+std::vector<PayloadBlock> SplitPayloads(const std::vector<uint64_t>& sizes, size_t block_size) {
+    block_size = std::max<size_t>((block_size + kAllocAlignment - 1) / kAllocAlignment, 1) * kAllocAlignment;
+    std::vector<PayloadBlock> blocks;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        for (uint64_t begin = 0; begin < sizes[i]; begin += block_size) {
+            uint64_t size = std::min<uint64_t>(block_size, sizes[i] - begin);
+            blocks.push_back({i, begin, size, 0, begin, size});
+        }
+    }
+    return blocks;
+}
+
+// Cut a compressed payload at its compression blocks.
+void SplitCompressedPayload(size_t tensor, const ParamsIndexEntry& entry, std::vector<PayloadBlock>* blocks) {
+    uint64_t begin = 0;
+    for (size_t k = 0; k < entry.block_sizes.size(); ++k) {
+        uint64_t out_begin = k * entry.block_size;
+        blocks->push_back({tensor, begin, entry.block_sizes[k], 0, out_begin,
+                           std::min(entry.block_size, entry.nbytes - out_begin)});
+        begin += entry.block_sizes[k];
+    }
+}
+
+// Checksum of every payload from the checksums of its blocks.
+std::vector<uint32_t> CombineBlockChecksums(const std::vector<PayloadBlock>& blocks, size_t num_tensors) {
+    std::vector<uint32_t> crcs(num_tensors, 0);
+    for (const auto& b: blocks) crcs[b.tensor] = Crc32cCombine(crcs[b.tensor], b.crc, b.size);
+    return crcs;
+}
+
+// Number of concurrent tasks of a parallel params transfer.
+int ParamsIOThreads(const ParamsIOOptions& options) {
+    int num_threads = options.num_threads;
+    if (num_threads <= 0) {
+        const char* val = getenv("TVM_PARAMS_IO_THREADS");
+        num_threads = val != nullptr ? atoi(val) : 0;
+    }
+    return num_threads > 0 ? num_threads : threading::NumThreads();
+}
+
+// Run f on every block with at most num_threads tasks.
+// f returns an error message, the first one is raised once all tasks are done.
+template<typename F>
+void ForEachBlock(std::vector<PayloadBlock>* blocks, int num_threads, F f) {
+    const int64_t n = static_cast<int64_t>(blocks->size());
+    if (n == 0) return;
+    // one grain per task caps the number of tasks, blocks are still claimed one at a time
+    const int64_t num_task = std::min<int64_t>(std::max(num_threads, 1), n);
+    const int64_t grain = (n + num_task - 1) / num_task;
+    std::mutex mutex;
+    std::string error;
+    parallel_for_with_threading_backend(
+            [&](int64_t i) {
+                std::string err = f(&(*blocks)[i]);
+                if (!err.empty()) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (error.empty()) error = std::move(err);
+                }
+            },
+            0, n, ParallelForSchedule::Dynamic(1, grain));
+    CHECK(error.empty()) << error;
+}
+
+// Read the header of a SaveDLTensor record, leaving strm at the payload.
+void ReadTensorHeader(dmlc::Stream* strm, std::vector<int64_t>* shape, DLDataType* dtype,
+                      int64_t* data_byte_size) {
     uint64_t header, reserved;
-    CHECK(strm->Read(&header)) << "Invalid parameters file format";
-    CHECK(header == kTVMNDArrayListMagic) << "Invalid parameters file format";
+    ICHECK(strm->Read(&header)) << "Invalid DLTensor file format";
+    ICHECK(strm->Read(&reserved)) << "Invalid DLTensor file format";
+    ICHECK(header == kTVMNDArrayMagic) << "Invalid DLTensor file format";
+    Device dev;
+    int ndim;
+    ICHECK(strm->Read(&dev)) << "Invalid DLTensor file format";
+    ICHECK(strm->Read(&ndim)) << "Invalid DLTensor file format";
+    ICHECK(strm->Read(dtype)) << "Invalid DLTensor file format";
+    ICHECK_EQ(dev.device_type, kDLCPU) << "Invalid DLTensor device: can only save as CPU tensor";
+    shape->resize(ndim);
+    if (ndim != 0) {
+        ICHECK(strm->ReadArray(shape->data(), ndim)) << "Invalid DLTensor file format";
+    }
+    int64_t num_elems = 1;
+    for (int64_t extent: *shape) num_elems *= extent;
+    ICHECK(strm->Read(data_byte_size)) << "Invalid DLTensor file format";
+    ICHECK(*data_byte_size == num_elems * ((dtype->bits + 7) / 8)) << "Invalid DLTensor file format";
+}
+
+// Size of the SaveDLTensor record header of a tensor with ndim dimensions.
+size_t TensorHeaderSize(int ndim) {
+    return sizeof(uint64_t) * 2 + sizeof(Device) + sizeof(int) + sizeof(DLDataType) +
+           sizeof(int64_t) * ndim + sizeof(int64_t);
+}
+
+// Skip the padding in front of a record of the aligned format.
+void SkipPadding(dmlc::Stream* strm) {
+    uint64_t pad;
+    CHECK(strm->Read(&pad)) << "Invalid parameters file format";
+    CHECK_LT(pad, static_cast<uint64_t>(kAllocAlignment)) << "Invalid parameters file format";
+    char zeros[kAllocAlignment];
+    CHECK_EQ(strm->Read(zeros, pad), pad) << "Invalid parameters file format";
+}
+
+// Forwards writes to another stream and counts the bytes written.
+class CountingStream : public dmlc::Stream {
+public:
+    explicit CountingStream(dmlc::Stream* strm) : strm_(strm) {}
+
+    using dmlc::Stream::Read;
+    using dmlc::Stream::Write;
+
+    size_t Read(void* ptr, size_t size) override {
+        LOG(FATAL) << "CountingStream is write-only";
+        return 0;
+    }
+
+    size_t Write(const void* ptr, size_t size) override {
+        size_t nwrite = strm_->Write(ptr, size);
+        written_ += nwrite;
+        return nwrite;
+    }
+
+    size_t written() const { return written_; }
+
+    // Write zeros until the count is a multiple of kAllocAlignment.
+    void Align() {
+        const char zeros[kAllocAlignment] = {};
+        Write(zeros, (kAllocAlignment - written_ % kAllocAlignment) % kAllocAlignment);
+    }
+
+private:
+    dmlc::Stream* strm_;
+    size_t written_{0};
+};
+
+// Keeps the mapping of a parameter file alive for the NDArrays that alias it.
+struct MappedFileAlloc {
+    void AllocData(DLTensor* tensor, std::shared_ptr<MappedFile> file, size_t offset) {
+        tensor->data = file->data() + offset;
+        file_ = std::move(file);
+    }
+    void FreeData(DLTensor* tensor) { file_.reset(); }
+
+    std::shared_ptr<MappedFile> file_;
+};
+
+// Read the header of a packed or aligned list and return the tensor names.
+std::vector<std::string> ReadListHeader(dmlc::Stream* strm, uint64_t magic) {
+    CHECK(magic == kTVMNDArrayListMagic || magic == kTVMNDArrayListAlignedMagic)
+            << "Invalid parameters file format";
+    uint64_t reserved;
     CHECK(strm->Read(&reserved)) << "Invalid parameters file format";
 
     std::vector<std::string> names;
     CHECK(strm->Read(&names)) << "Invalid parameters file format";
     uint64_t sz;
-    strm->Read(&sz);
-    size_t size = static_cast<size_t>(sz);
-    CHECK(size == names.size()) << "Invalid parameters file format";
-    for (size_t i = 0; i < size; ++i) {
+    CHECK(strm->Read(&sz)) << "Invalid parameters file format";
+    CHECK(static_cast<size_t>(sz) == names.size()) << "Invalid parameters file format";
+    return names;
+}
+
+// Version of indexed lists without compressed payloads, readable by older runtimes.
+constexpr uint64_t kIndexedParamsRawVersion = 1;
+
+void CheckIndexedVersion(uint64_t version) {
+    CHECK_LE(version, kIndexedParamsVersion) << "Parameters file version " << version
+                                             << " is newer than this runtime supports";
+}
+
+// Read the index of an indexed list whose payloads end at index_offset.
+void ReadIndexRecords(dmlc::Stream* strm, uint64_t index_offset, uint64_t version,
+                      std::vector<std::string>* names,
+                      std::unordered_map<std::string, ParamsIndexEntry>* index) {
+    uint64_t count;
+    CHECK(strm->Read(&count)) << "Invalid parameters file format";
+    names->resize(count);
+    for (auto& name: *names) {
+        ParamsIndexEntry entry;
+        CHECK(strm->Read(&name)) << "Invalid parameters file format";
+        CHECK(strm->Read(&entry.offset)) << "Invalid parameters file format";
+        CHECK(strm->Read(&entry.dtype)) << "Invalid parameters file format";
+        CHECK(strm->Read(&entry.shape)) << "Invalid parameters file format";
+        CHECK(strm->Read(&entry.nbytes)) << "Invalid parameters file format";
+        CHECK(strm->Read(&entry.checksum)) << "Invalid parameters file format";
+        entry.has_checksum = true;
+        CHECK_EQ(entry.nbytes, ffi::GetDataSize(ffi::Shape(entry.shape).Product(), entry.dtype))
+                << "Invalid parameters file format";
+        if (version >= kIndexedParamsCompressedVersion) {
+            uint32_t codec;
+            CHECK(strm->Read(&codec)) << "Invalid parameters file format";
+            CHECK_LE(codec, static_cast<uint32_t>(CompressionCodec::kLZHigh))
+                    << "Unknown compression codec " << codec << " of parameter " << name;
+            entry.codec = static_cast<CompressionCodec>(codec);
+        }
+        entry.stored_nbytes = entry.nbytes;
+        if (entry.codec != CompressionCodec::kNone) {
+            CHECK(strm->Read(&entry.block_size)) << "Invalid parameters file format";
+            CHECK(strm->Read(&entry.block_sizes)) << "Invalid parameters file format";
+            CHECK(entry.block_size != 0 &&
+                  entry.block_sizes.size() == (entry.nbytes + entry.block_size - 1) / entry.block_size)
+                    << "Invalid parameters file format";
+            entry.stored_nbytes = 0;
+            for (size_t k = 0; k < entry.block_sizes.size(); ++k) {
+                CHECK_LE(entry.block_sizes[k], std::min(entry.block_size, entry.nbytes - k * entry.block_size))
+                        << "Invalid parameters file format";
+                entry.stored_nbytes += entry.block_sizes[k];
+            }
+        }
+        CHECK_LE(entry.offset + entry.stored_nbytes, index_offset) << "Invalid parameters file format";
+        (*index)[name] = std::move(entry);
+    }
+}
+
+// Write the index of an indexed list.
+void WriteIndexRecords(dmlc::Stream* strm, uint64_t version, const std::vector<std::string>& names,
+                       const std::vector<ParamsIndexEntry>& entries) {
+    uint64_t sz = entries.size();
+    strm->Write(sz);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        strm->Write(names[i]);
+        strm->Write(entries[i].offset);
+        strm->Write(entries[i].dtype);
+        strm->Write(entries[i].shape);
+        strm->Write(entries[i].nbytes);
+        strm->Write(entries[i].checksum);
+        if (version >= kIndexedParamsCompressedVersion) {
+            uint32_t codec = static_cast<uint32_t>(entries[i].codec);
+            strm->Write(codec);
+            if (entries[i].codec != CompressionCodec::kNone) {
+                strm->Write(entries[i].block_size);
+                strm->Write(entries[i].block_sizes);
+            }
+        }
+    }
+}
+
+// Locate every tensor of a serialized parameter list held in memory.
+void ParseParamsIndex(char* data, size_t size, std::vector<std::string>* names,
+                      std::unordered_map<std::string, ParamsIndexEntry>* index) {
+    dmlc::MemoryFixedSizeStream mstrm(data, size);
+    dmlc::Stream* strm = &mstrm;
+    uint64_t magic;
+    CHECK(strm->Read(&magic)) << "Invalid parameters file format";
+    if (magic != kTVMNDArrayListIndexedMagic) {
+        // walk the records, payloads are never touched
+        *names = ReadListHeader(strm, magic);
+        for (const auto& name: *names) {
+            if (magic == kTVMNDArrayListAlignedMagic) SkipPadding(strm);
+            ParamsIndexEntry entry;
+            int64_t nbytes;
+            ReadTensorHeader(strm, &entry.shape, &entry.dtype, &nbytes);
+            entry.offset = mstrm.Tell();
+            entry.nbytes = static_cast<uint64_t>(nbytes);
+            entry.stored_nbytes = entry.nbytes;
+            CHECK_LE(entry.offset + entry.nbytes, size) << "Invalid parameters file format";
+            mstrm.Seek(entry.offset + entry.nbytes);
+            (*index)[name] = std::move(entry);
+        }
+        return;
+    }
+    uint64_t version;
+    CHECK(strm->Read(&version)) << "Invalid parameters file format";
+    CheckIndexedVersion(version);
+    uint64_t trailer[2];
+    CHECK_GE(size, sizeof(uint64_t) * 2 + sizeof(trailer)) << "Invalid parameters file format";
+    std::memcpy(trailer, data + size - sizeof(trailer), sizeof(trailer));
+    CHECK_EQ(trailer[1], kTVMNDArrayListIndexedMagic) << "Truncated parameters file";
+    const uint64_t index_offset = trailer[0];
+    CHECK_LE(index_offset, size - sizeof(trailer)) << "Invalid parameters file format";
+    mstrm.Seek(index_offset);
+    ReadIndexRecords(strm, index_offset, version, names, index);
+}
+
+// Decompress one stored block of a payload into the tensor data and byte swap it.
+std::string DecodePayloadBlock(const std::string& name, const ParamsIndexEntry& entry, const char* src,
+                               char* data, const PayloadBlock& b) {
+    const size_t elem_bytes = (entry.dtype.bits + 7) / 8;
+    if (!DecompressBlock(src, b.size, data + b.out_begin, b.out_size, elem_bytes)) {
+        return "Corrupt compressed block in parameter " + name;
+    }
+    if (!DMLC_IO_NO_ENDIAN_SWAP) {
+        dmlc::ByteSwap(data + b.out_begin, elem_bytes, b.out_size / elem_bytes);
+    }
+    return "";
+}
+
+// Turn the payload of one tensor into an NDArray, aliasing owner when possible.
+NDArray MaterializeParam(const std::string& name, const ParamsIndexEntry& entry, char* base,
+                         const std::shared_ptr<MappedFile>& owner) {
+    char* payload = base + entry.offset;
+    if (entry.has_checksum) {
+        CHECK_EQ(Crc32c(payload, entry.stored_nbytes), entry.checksum)
+                << "Checksum mismatch in parameter " << name;
+    }
+    Device cpu_dev;
+    cpu_dev.device_type = kDLCPU;
+    cpu_dev.device_id = 0;
+    if (entry.codec != CompressionCodec::kNone) {
+        NDArray arr = NDArray::Empty(ffi::Shape(entry.shape), entry.dtype, cpu_dev);
+        std::vector<PayloadBlock> blocks;
+        SplitCompressedPayload(0, entry, &blocks);
+        ForEachBlock(&blocks, threading::NumThreads(), [&](PayloadBlock* b) {
+            return DecodePayloadBlock(name, entry, payload + b->begin, static_cast<char*>(arr->data), *b);
+        });
+        return arr;
+    }
+    if (owner != nullptr && DMLC_IO_NO_ENDIAN_SWAP &&
+        reinterpret_cast<uintptr_t>(payload) % kAllocAlignment == 0) {
+        return ffi::Tensor::FromNDAlloc(MappedFileAlloc(), ffi::Shape(entry.shape), entry.dtype,
+                                        cpu_dev, owner, static_cast<size_t>(entry.offset));
+    }
+    NDArray arr = NDArray::Empty(ffi::Shape(entry.shape), entry.dtype, cpu_dev);
+    CHECK_LE(entry.nbytes, GetDataSize(*arr.operator->())) << "Invalid parameters file format";
+    std::memcpy(arr->data, payload, entry.nbytes);
+    if (!DMLC_IO_NO_ENDIAN_SWAP) {
+        int elem_bytes = (entry.dtype.bits + 7) / 8;
+        dmlc::ByteSwap(arr->data, elem_bytes, entry.nbytes / elem_bytes);
+    }
+    return arr;
+}
+
+// Copy every tensor of a serialized parameter list held in memory.
+Map<String, NDArray> LoadParamsFromMemory(char* data, size_t size) {
+    std::vector<std::string> names;
+    std::unordered_map<std::string, ParamsIndexEntry> index;
+    ParseParamsIndex(data, size, &names, &index);
+    Map<String, NDArray> params;
+    for (const auto& name: names) {
+        params.Set(name, MaterializeParam(name, index.at(name), data, nullptr));
+    }
+    return params;
+}
+
+// Whether the payload of a tensor can be written straight from its data pointer.
+bool IsWritableInPlace(const DLTensor* tensor) {
+    return DMLC_IO_NO_ENDIAN_SWAP && tensor->device.device_type == kDLCPU &&
+           ffi::IsContiguous(*tensor) && tensor->byte_offset == 0;
+}
+
+// Forwards writes to another stream and checksums the bytes written.
+class ChecksumStream : public dmlc::Stream {
+public:
+    explicit ChecksumStream(dmlc::Stream* strm) : strm_(strm) {}
+
+    using dmlc::Stream::Read;
+    using dmlc::Stream::Write;
+
+    size_t Read(void* ptr, size_t size) override {
+        LOG(FATAL) << "ChecksumStream is write-only";
+        return 0;
+    }
+
+    size_t Write(const void* ptr, size_t size) override {
+        crc_ = Crc32c(ptr, size, crc_);
+        return strm_->Write(ptr, size);
+    }
+
+    uint32_t crc() const { return crc_; }
+
+private:
+    dmlc::Stream* strm_;
+    uint32_t crc_{0};
+};
+
+// Write the payload of a tensor as SaveDLTensor does and return its checksum.
+uint32_t WriteTensorPayload(dmlc::Stream* strm, const DLTensor* tensor) {
+    ChecksumStream checksum(strm);
+    SaveDLTensorData(&checksum, tensor);
+    return checksum.crc();
+}
+
+// Compresses the tensor data written to it block by block into another stream.
+// Blocks are buffered in batches that are compressed in parallel.
+class CompressStream : public dmlc::Stream {
+public:
+    CompressStream(dmlc::Stream* strm, const ParamsIOOptions& options, size_t elem_bytes, uint64_t nbytes)
+        : strm_(strm), codec_(options.codec), elem_bytes_(elem_bytes), num_threads_(ParamsIOThreads(options)) {
+        // blocks hold whole elements so that every block can be byte swapped on its own
+        block_size_ = std::max<size_t>(options.compress_block_size / elem_bytes, 1) * elem_bytes;
+        CHECK_LE(block_size_, std::numeric_limits<uint32_t>::max()) << "Compression block size too large";
+        uint64_t num_blocks = (nbytes + block_size_ - 1) / block_size_;
+        buf_.resize(block_size_ * std::min<uint64_t>(std::max(num_threads_, 1), num_blocks));
+    }
+
+    using dmlc::Stream::Read;
+    using dmlc::Stream::Write;
+
+    size_t Read(void* ptr, size_t size) override {
+        LOG(FATAL) << "CompressStream is write-only";
+        return 0;
+    }
+
+    size_t Write(const void* ptr, size_t size) override {
+        const char* p = static_cast<const char*>(ptr);
+        for (size_t left = size; left != 0;) {
+            size_t n = std::min(left, buf_.size() - used_);
+            std::memcpy(buf_.data() + used_, p, n);
+            used_ += n;
+            p += n;
+            left -= n;
+            if (used_ == buf_.size()) Flush();
+        }
+        return size;
+    }
+
+    // Compress and write the buffered blocks, the last one may be partial.
+    void Flush() {
+        std::vector<PayloadBlock> blocks;
+        for (uint64_t begin = 0; begin < used_; begin += block_size_) {
+            blocks.push_back({0, begin, std::min<uint64_t>(block_size_, used_ - begin)});
+        }
+        outs_.resize(blocks.size());
+        ForEachBlock(&blocks, num_threads_, [&](PayloadBlock* b) -> std::string {
+            CompressBlock(codec_, buf_.data() + b->begin, b->size, elem_bytes_, &outs_[b->begin / block_size_]);
+            return "";
+        });
+        for (size_t k = 0; k < blocks.size(); ++k) {
+            strm_->Write(outs_[k].data(), outs_[k].size());
+            block_sizes_.push_back(static_cast<uint32_t>(outs_[k].size()));
+            stored_nbytes_ += outs_[k].size();
+        }
+        used_ = 0;
+    }
+
+    size_t block_size() const { return block_size_; }
+    const std::vector<uint32_t>& block_sizes() const { return block_sizes_; }
+    uint64_t stored_nbytes() const { return stored_nbytes_; }
+
+private:
+    dmlc::Stream* strm_;
+    CompressionCodec codec_;
+    size_t elem_bytes_;
+    int num_threads_;
+    size_t block_size_;
+    std::vector<char> buf_;
+    size_t used_{0};
+    std::vector<std::vector<char>> outs_;
+    std::vector<uint32_t> block_sizes_;
+    uint64_t stored_nbytes_{0};
+};
+
+// Write the compressed payload of a tensor, fill in the compression fields
+// of its entry and return the checksum of the stored bytes.
+uint32_t WriteCompressedPayload(dmlc::Stream* strm, const DLTensor* tensor, const ParamsIOOptions& options,
+                                ParamsIndexEntry* entry) {
+    ChecksumStream checksum(strm);
+    CompressStream compress(&checksum, options, (tensor->dtype.bits + 7) / 8, entry->nbytes);
+    SaveDLTensorData(&compress, tensor);
+    compress.Flush();
+    // blocks that do not shrink are stored raw, so if none shrank the payload is a raw one
+    if (compress.stored_nbytes() < entry->nbytes) {
+        entry->codec = options.codec;
+        entry->block_size = compress.block_size();
+        entry->block_sizes = compress.block_sizes();
+    }
+    return checksum.crc();
+}
+
+#if !defined(_WIN32)
+// Closes a file descriptor when it goes out of scope.
+struct ScopedFd {
+    explicit ScopedFd(int fd) : fd(fd) {}
+    ~ScopedFd() {
+        if (fd >= 0) close(fd);
+    }
+    int fd;
+};
+
+// pread until size bytes arrived, returns an error message on failure.
+std::string PreadFull(int fd, void* buf, size_t size, uint64_t offset) {
+    auto* p = static_cast<char*>(buf);
+    while (size != 0) {
+        ssize_t n = pread(fd, p, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return std::strerror(errno);
+        if (n == 0) return "unexpected end of file";
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return "";
+}
+
+// pwrite until size bytes left, returns an error message on failure.
+std::string PwriteFull(int fd, const void* buf, size_t size, uint64_t offset) {
+    auto* p = static_cast<const char*>(buf);
+    while (size != 0) {
+        ssize_t n = pwrite(fd, p, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return std::strerror(errno);
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return "";
+}
+
+// Writes to a file at an advancing offset with pwrite.
+class PwriteStream : public dmlc::Stream {
+public:
+    PwriteStream(int fd, uint64_t offset) : fd_(fd), offset_(offset) {}
+
+    using dmlc::Stream::Read;
+    using dmlc::Stream::Write;
+
+    size_t Read(void* ptr, size_t size) override {
+        LOG(FATAL) << "PwriteStream is write-only";
+        return 0;
+    }
+
+    size_t Write(const void* ptr, size_t size) override {
+        std::string err = PwriteFull(fd_, ptr, size, offset_);
+        CHECK(err.empty()) << "Unable to write parameters: " << err;
+        offset_ += size;
+        return size;
+    }
+
+private:
+    int fd_;
+    uint64_t offset_;
+};
+#endif
+
+}// namespace
+
+LazyParams::LazyParams(const std::string& path) : file_(std::make_shared<MappedFile>(path)) {
+    ParseParamsIndex(file_->data(), file_->size(), &names_, &index_);
+}
+
+const ParamsIndexEntry& LazyParams::Entry(const std::string& name) const {
+    auto it = index_.find(name);
+    CHECK(it != index_.end()) << "Cannot find parameter " << name;
+    return it->second;
+}
+
+NDArray LazyParams::Get(const std::string& name) {
+    const ParamsIndexEntry& entry = Entry(name);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = loaded_.find(name);
+        if (it != loaded_.end()) return it->second;
+    }
+    // materialize outside the lock, a concurrent first access of the same name
+    // keeps whichever copy is published first
+    NDArray arr = MaterializeParam(name, entry, file_->data(), file_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loaded_.emplace(name, arr).first->second;
+}
+
+size_t LazyParams::num_loaded() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return loaded_.size();
+}
+
+Map<String, NDArray> LazyParams::ToMap() {
+    Map<String, NDArray> params;
+    for (const auto& name: names_) params.Set(name, Get(name));
+    return params;
+}
+
+Map<String, NDArray> LoadParams(const std::string& param_blob) {
+    return LoadParamsFromMemory(const_cast<char*>(param_blob.data()), param_blob.size());
+}
+
+Map<String, NDArray> LoadParams(dmlc::Stream* strm) {
+    uint64_t magic;
+    CHECK(strm->Read(&magic)) << "Invalid parameters file format";
+    if (magic == kTVMNDArrayListIndexedMagic) {
+        // the index sits at the end, slurp the rest of the stream
+        std::string blob(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        char buf[1 << 16];
+        for (size_t n; (n = strm->Read(buf, sizeof(buf))) != 0;) blob.append(buf, n);
+        return LoadParams(blob);
+    }
+    Map<String, NDArray> params;
+    std::vector<std::string> names = ReadListHeader(strm, magic);
+    for (const auto& name: names) {
+        if (magic == kTVMNDArrayListAlignedMagic) SkipPadding(strm);
         // The data_entry is allocated on device, NDArray.load always load the array into CPU.
         NDArray temp;
         temp.Load(strm);
-        params.Set(names[i], temp);
+        params.Set(name, temp);
+    }
+    return params;
+}
+
+Map<String, NDArray> LoadParamsFromFile(const std::string& path) {
+    return LazyParams(path).ToMap();
+}
+
+Map<String, NDArray> LoadParamsParallel(const std::string& path, const ParamsIOOptions& options) {
+#if defined(_WIN32)
+    BufferedFileStream strm(path, "rb");
+    return LoadParams(&strm);
+#else
+    ScopedFd fd(open(path.c_str(), O_RDONLY));
+    CHECK_GE(fd.fd, 0) << "Unable to open file " << path << ": " << std::strerror(errno);
+    struct stat st;
+    CHECK_EQ(fstat(fd.fd, &st), 0) << "Unable to stat file " << path << ": " << std::strerror(errno);
+    const uint64_t size = static_cast<uint64_t>(st.st_size);
+    uint64_t header[2];
+    CHECK(size >= sizeof(header) && PreadFull(fd.fd, header, sizeof(header), 0).empty())
+            << "Invalid parameters file format";
+
+    std::vector<std::string> names;
+    std::unordered_map<std::string, ParamsIndexEntry> index;
+    // older formats interleave headers and payloads, they are read from a mapping
+    std::unique_ptr<MappedFile> file;
+    if (header[0] == kTVMNDArrayListIndexedMagic) {
+        CheckIndexedVersion(header[1]);
+        uint64_t trailer[2];
+        CHECK(size >= sizeof(header) + sizeof(trailer) &&
+              PreadFull(fd.fd, trailer, sizeof(trailer), size - sizeof(trailer)).empty())
+                << "Invalid parameters file format";
+        CHECK_EQ(trailer[1], kTVMNDArrayListIndexedMagic) << "Truncated parameters file";
+        const uint64_t index_offset = trailer[0];
+        CHECK_LE(index_offset, size - sizeof(trailer)) << "Invalid parameters file format";
+        std::string buf(size - sizeof(trailer) - index_offset, '\0');
+        std::string err = PreadFull(fd.fd, buf.data(), buf.size(), index_offset);
+        CHECK(err.empty()) << "Unable to read " << path << ": " << err;
+        dmlc::MemoryStringStream strm(&buf);
+        ReadIndexRecords(&strm, index_offset, header[1], &names, &index);
+    } else {
+        file = std::make_unique<MappedFile>(path);
+        ParseParamsIndex(file->data(), file->size(), &names, &index);
+    }
+
+    Device cpu_dev;
+    cpu_dev.device_type = kDLCPU;
+    cpu_dev.device_id = 0;
+    std::vector<const ParamsIndexEntry*> entries;
+    std::vector<NDArray> arrays;
+    std::vector<uint64_t> sizes;
+    for (const auto& name: names) {
+        const ParamsIndexEntry& entry = index.at(name);
+        NDArray arr = NDArray::Empty(ffi::Shape(entry.shape), entry.dtype, cpu_dev);
+        CHECK_LE(entry.nbytes, GetDataSize(*arr.operator->())) << "Invalid parameters file format";
+        entries.push_back(&entry);
+        arrays.push_back(arr);
+        // compressed payloads are cut at their compression blocks instead
+        sizes.push_back(entry.codec == CompressionCodec::kNone ? entry.nbytes : 0);
+    }
+    std::vector<PayloadBlock> blocks = SplitPayloads(sizes, options.block_size);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i]->codec != CompressionCodec::kNone) SplitCompressedPayload(i, *entries[i], &blocks);
+    }
+    ForEachBlock(&blocks, ParamsIOThreads(options), [&](PayloadBlock* b) -> std::string {
+        const ParamsIndexEntry& entry = *entries[b->tensor];
+        if (entry.codec != CompressionCodec::kNone) {
+            // only the indexed format compresses, so the block is read with pread
+            thread_local std::vector<char> stored;
+            stored.resize(b->size);
+            std::string err = PreadFull(fd.fd, stored.data(), b->size, entry.offset + b->begin);
+            if (!err.empty()) return "Unable to read parameter " + names[b->tensor] + ": " + err;
+            if (entry.has_checksum) b->crc = Crc32c(stored.data(), b->size);
+            return DecodePayloadBlock(names[b->tensor], entry, stored.data(),
+                                      static_cast<char*>(arrays[b->tensor]->data), *b);
+        }
+        char* dst = static_cast<char*>(arrays[b->tensor]->data) + b->begin;
+        if (file != nullptr) {
+            std::memcpy(dst, file->data() + entry.offset + b->begin, b->size);
+        } else {
+            std::string err = PreadFull(fd.fd, dst, b->size, entry.offset + b->begin);
+            if (!err.empty()) return "Unable to read parameter " + names[b->tensor] + ": " + err;
+        }
+        if (entry.has_checksum) b->crc = Crc32c(dst, b->size);
+        if (!DMLC_IO_NO_ENDIAN_SWAP) {
+            int elem_bytes = (entry.dtype.bits + 7) / 8;
+            dmlc::ByteSwap(dst, elem_bytes, b->size / elem_bytes);
+        }
+        return "";
+    });
+    std::vector<uint32_t> crcs = CombineBlockChecksums(blocks, names.size());
+    Map<String, NDArray> params;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (entries[i]->has_checksum) {
+            CHECK_EQ(crcs[i], entries[i]->checksum) << "Checksum mismatch in parameter " << names[i];
+        }
+        params.Set(names[i], arrays[i]);
     }
     return params;
+#endif
 }
 
-void SaveParams(dmlc::Stream* strm, const Map<String, NDArray>& params) {
+void SaveParamsParallel(const std::string& path, const Map<String, NDArray>& params,
+                        const ParamsIOOptions& options) {
+#if defined(_WIN32)
+    BufferedFileStream strm(path, "wb");
+    SaveParams(&strm, params, ParamsFormat::kIndexed, options);
+    strm.Close();
+#else
+    if (options.codec != CompressionCodec::kNone) {
+        // compressed sizes are only known once compressed, the payloads are laid out as they stream
+        BufferedFileStream strm(path, "wb");
+        SaveParams(&strm, params, ParamsFormat::kIndexed, options);
+        strm.Close();
+        return;
+    }
+    // lay out the file of SaveParams(strm, params, ParamsFormat::kIndexed)
+    std::vector<std::string> names;
+    std::vector<ParamsIndexEntry> entries;
+    std::vector<const DLTensor*> tensors;
+    // payloads written in place by the parallel tasks, the others are streamed afterwards
+    std::vector<uint64_t> sizes;
+    uint64_t offset = sizeof(uint64_t) * 2;
+    for (auto& p: params) {
+        const DLTensor* tensor = p.second.operator->();
+        ParamsIndexEntry entry;
+        offset = (offset + kAllocAlignment - 1) / kAllocAlignment * kAllocAlignment;
+        entry.offset = offset;
+        entry.dtype = tensor->dtype;
+        entry.shape.assign(tensor->shape, tensor->shape + tensor->ndim);
+        entry.nbytes = GetDataSize(*tensor);
+        entry.stored_nbytes = entry.nbytes;
+        offset += entry.nbytes;
+        tensors.push_back(tensor);
+        sizes.push_back(IsWritableInPlace(tensor) ? entry.nbytes : 0);
+        names.push_back(p.first);
+        entries.push_back(std::move(entry));
+    }
+    const uint64_t index_offset = offset;
+
+    ScopedFd fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    CHECK_GE(fd.fd, 0) << "Unable to open file " << path << ": " << std::strerror(errno);
+    std::vector<PayloadBlock> blocks = SplitPayloads(sizes, options.block_size);
+    ForEachBlock(&blocks, ParamsIOThreads(options), [&](PayloadBlock* b) -> std::string {
+        const char* src = static_cast<const char*>(tensors[b->tensor]->data) + b->begin;
+        b->crc = Crc32c(src, b->size);
+        std::string err = PwriteFull(fd.fd, src, b->size, entries[b->tensor].offset + b->begin);
+        if (!err.empty()) return "Unable to write parameter " + names[b->tensor] + ": " + err;
+        return "";
+    });
+    std::vector<uint32_t> crcs = CombineBlockChecksums(blocks, names.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (sizes[i] == entries[i].nbytes) {
+            entries[i].checksum = crcs[i];
+        } else {
+            PwriteStream out(fd.fd, entries[i].offset);
+            entries[i].checksum = WriteTensorPayload(&out, tensors[i]);
+        }
+    }
+
+    // the gaps before aligned payloads are left as holes, which read as zeros
+    uint64_t header[2] = {kTVMNDArrayListIndexedMagic, kIndexedParamsRawVersion};
+    std::string tail;
+    dmlc::MemoryStringStream strm(&tail);
+    WriteIndexRecords(&strm, header[1], names, entries);
+    strm.Write(&index_offset, sizeof(index_offset));
+    strm.Write(&header[0], sizeof(header[0]));
+    std::string err = PwriteFull(fd.fd, header, sizeof(header), 0);
+    if (err.empty()) err = PwriteFull(fd.fd, tail.data(), tail.size(), index_offset);
+    if (err.empty() && ftruncate(fd.fd, static_cast<off_t>(index_offset + tail.size())) != 0) {
+        err = std::strerror(errno);
+    }
+    CHECK(err.empty()) << "Unable to write " << path << ": " << err;
+#endif
+}
+
+void SaveParams(dmlc::Stream* strm, const Map<String, NDArray>& params, ParamsFormat format,
+                const ParamsIOOptions& options) {
     std::vector<std::string> names;
     std::vector<const DLTensor*> arrays;
     for (auto& p: params) {
@@ -212,15 +1273,48 @@ void SaveParams(dmlc::Stream* strm, const Map<String, NDArray>& params) {
         arrays.push_back(p.second.operator->());
     }
 
-    uint64_t header = kTVMNDArrayListMagic, reserved = 0;
-    strm->Write(header);
-    strm->Write(reserved);
-    strm->Write(names);
+    CountingStream counter(strm);
+    if (format == ParamsFormat::kIndexed) {
+        uint64_t header = kTVMNDArrayListIndexedMagic;
+        const bool compress = options.codec != CompressionCodec::kNone;
+        uint64_t version = compress ? kIndexedParamsCompressedVersion : kIndexedParamsRawVersion;
+        counter.Write(header);
+        counter.Write(version);
+        std::vector<ParamsIndexEntry> entries(arrays.size());
+        for (size_t i = 0; i < arrays.size(); ++i) {
+            counter.Align();
+            entries[i].offset = counter.written();
+            entries[i].dtype = arrays[i]->dtype;
+            entries[i].shape.assign(arrays[i]->shape, arrays[i]->shape + arrays[i]->ndim);
+            entries[i].nbytes = GetDataSize(*arrays[i]);
+            entries[i].checksum = compress ? WriteCompressedPayload(&counter, arrays[i], options, &entries[i])
+                                           : WriteTensorPayload(&counter, arrays[i]);
+            entries[i].stored_nbytes = counter.written() - entries[i].offset;
+        }
+        uint64_t index_offset = counter.written();
+        WriteIndexRecords(&counter, version, names, entries);
+        counter.Write(index_offset);
+        counter.Write(header);
+        return;
+    }
+
+    const bool aligned = format == ParamsFormat::kAligned;
+    uint64_t header = aligned ? kTVMNDArrayListAlignedMagic : kTVMNDArrayListMagic, reserved = 0;
+    counter.Write(header);
+    counter.Write(reserved);
+    counter.Write(names);
     {
         uint64_t sz = arrays.size();
-        strm->Write(sz);
+        counter.Write(sz);
         for (size_t i = 0; i < sz; ++i) {
-            SaveDLTensor(strm, arrays[i]);
+            if (aligned) {
+                size_t payload = counter.written() + sizeof(uint64_t) + TensorHeaderSize(arrays[i]->ndim);
+                uint64_t pad = (kAllocAlignment - payload % kAllocAlignment) % kAllocAlignment;
+                const char zeros[kAllocAlignment] = {};
+                counter.Write(pad);
+                counter.Write(zeros, pad);
+            }
+            SaveDLTensor(&counter, arrays[i]);
         }
     }
 }
@@ -243,13 +1337,39 @@ TVM_FFI_STATIC_INIT_BLOCK({
                  })
             .def("runtime.SaveParamsToFile",
                  [](const Map<String, NDArray>& params, const String& path) {
-                     litetvm::runtime::SimpleBinaryFileStream strm(path, "wb");
+                     litetvm::runtime::BufferedFileStream strm(path, "wb");
                      SaveParams(&strm, params);
+                     strm.Close();
+                 })
+            .def("runtime.SaveParamsToFileWithFormat",
+                 [](const Map<String, NDArray>& params, const String& path, int format) {
+                     CHECK(format == static_cast<int>(ParamsFormat::kPacked) ||
+                           format == static_cast<int>(ParamsFormat::kAligned) ||
+                           format == static_cast<int>(ParamsFormat::kIndexed))
+                             << "Unknown parameters format " << format;
+                     litetvm::runtime::BufferedFileStream strm(path, "wb");
+                     SaveParams(&strm, params, static_cast<ParamsFormat>(format));
+                     strm.Close();
+                 })
+            .def("runtime.SaveParamsToFileParallel",
+                 [](const Map<String, NDArray>& params, const String& path, int num_threads) {
+                     ParamsIOOptions options;
+                     options.num_threads = num_threads;
+                     SaveParamsParallel(path, params, options);
+                 })
+            .def("runtime.SaveParamsToFileCompressed",
+                 [](const Map<String, NDArray>& params, const String& path, int codec) {
+                     ParamsIOOptions options;
+                     options.codec = static_cast<CompressionCodec>(codec);
+                     SaveParamsParallel(path, params, options);
                  })
             .def("runtime.LoadParams", [](const ffi::Bytes& s) { return ::litetvm::runtime::LoadParams(s); })
-            .def("runtime.LoadParamsFromFile", [](const String& path) {
-                litetvm::runtime::SimpleBinaryFileStream strm(path, "rb");
-                return LoadParams(&strm);
+            .def("runtime.LoadParamsFromFile",
+                 [](const String& path) { return ::litetvm::runtime::LoadParamsFromFile(path); })
+            .def("runtime.LoadParamsFromFileParallel", [](const String& path, int num_threads) {
+                ParamsIOOptions options;
+                options.num_threads = num_threads;
+                return LoadParamsParallel(path, options);
             });
 });
 
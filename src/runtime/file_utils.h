@@ -5,12 +5,16 @@
 #ifndef LITETVM_RUNTIME_FILE_UTILS_H
 #define LITETVM_RUNTIME_FILE_UTILS_H
 
+#include "compression.h"
 #include "ffi/container/map.h"
 #include "ffi/string.h"
 #include "meta_data.h"
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace litetvm {
 namespace runtime {
@@ -85,6 +89,176 @@ void CopyFile(const std::string& src_file_name, const std::string& dest_file_nam
 void RemoveFile(const std::string& file_name);
 
 constexpr uint64_t kTVMNDArrayListMagic = 0xF7E58D4F05049CB7;
+/*! \brief Magic number of a parameter list whose payloads are kAllocAlignment aligned. */
+constexpr uint64_t kTVMNDArrayListAlignedMagic = 0xF7E58D4F05049CB8;
+/*! \brief Magic number at both ends of an indexed parameter list. */
+constexpr uint64_t kTVMNDArrayListIndexedMagic = 0xF7E58D4F05049CB9;
+/*! \brief Newest version of the indexed parameter list this runtime reads and writes. */
+constexpr uint64_t kIndexedParamsVersion = 2;
+/*!
+ * \brief First version of the indexed parameter list whose index records the
+ *  compression of every payload. Lists without compressed payloads are still
+ *  written as version 1.
+ */
+constexpr uint64_t kIndexedParamsCompressedVersion = 2;
+
+/*! \brief Layout of a serialized parameter list. */
+enum class ParamsFormat : int {
+    /*! \brief Tensors written back to back, see kTVMNDArrayListMagic. */
+    kPacked = 0,
+    /*!
+   * \brief Every tensor record is preceded by a uint64 pad length and that many
+   *  zero bytes, chosen so the payload starts at a kAllocAlignment multiple of
+   *  the list start. See kTVMNDArrayListAlignedMagic.
+   */
+    kAligned = 1,
+    /*!
+   * \brief Magic and version, the kAllocAlignment aligned payloads, then
+   *  an index of ParamsIndexEntry records, the offset of the index and the
+   *  magic again. Payloads are raw unless compressed, see ParamsIOOptions::codec.
+   *  See kTVMNDArrayListIndexedMagic.
+   */
+    kIndexed = 2,
+};
+
+/*! \brief Location of one tensor in a serialized parameter list. */
+struct ParamsIndexEntry {
+    /*! \brief Byte offset of the payload from the start of the list. */
+    uint64_t offset{0};
+    /*! \brief The data type. */
+    DLDataType dtype;
+    /*! \brief The shape. */
+    std::vector<int64_t> shape;
+    /*! \brief Size of the tensor data. */
+    uint64_t nbytes{0};
+    /*! \brief Crc32c of the payload as stored, only in the indexed format. */
+    uint32_t checksum{0};
+    /*! \brief Whether checksum is valid. */
+    bool has_checksum{false};
+    /*! \brief Codec of the payload. */
+    CompressionCodec codec{CompressionCodec::kNone};
+    /*! \brief Tensor bytes per block of a compressed payload, the last block may be shorter. */
+    uint64_t block_size{0};
+    /*!
+   * \brief Stored size of every block of a compressed payload, in order.
+   *  A block stored as large as its tensor bytes is not compressed.
+   */
+    std::vector<uint32_t> block_sizes;
+    /*! \brief Size of the payload in the file, nbytes unless compressed. */
+    uint64_t stored_nbytes{0};
+};
+
+/*!
+ * \brief Compute the CRC-32C (Castagnoli) checksum of a buffer.
+ * \param data The buffer.
+ * \param size Size of the buffer.
+ * \param crc Checksum of the preceding bytes, to checksum a buffer in pieces.
+ * \return The checksum.
+ */
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+/*!
+ * \brief Checksum of the concatenation of two buffers from their checksums.
+ * \param crc1 Crc32c of the first buffer.
+ * \param crc2 Crc32c of the second buffer.
+ * \param len2 Size of the second buffer.
+ * \return Crc32c of both buffers.
+ */
+uint32_t Crc32cCombine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+/*! \brief Options of LoadParamsParallel, SaveParamsParallel and compressed SaveParams. */
+struct ParamsIOOptions {
+    /*!
+   * \brief Maximum number of concurrent I/O tasks. 0 reads TVM_PARAMS_IO_THREADS
+   *  and falls back to every thread pool worker.
+   */
+    int num_threads{0};
+    /*! \brief Bytes moved by a task at a time, rounded up to kAllocAlignment. */
+    size_t block_size{size_t{4} << 20};
+    /*!
+   * \brief Codec of the payloads written in the indexed format. A tensor
+   *  none of whose blocks shrinks is stored raw.
+   */
+    CompressionCodec codec{CompressionCodec::kNone};
+    /*!
+   * \brief Tensor bytes compressed as one independent block, the unit of
+   *  parallel compression and decompression.
+   */
+    size_t compress_block_size{size_t{256} << 10};
+};
+
+/*!
+ * \brief Private read-write mapping of a whole file.
+ *
+ *  Pages are loaded on first touch and writes never reach the file.
+ */
+class MappedFile {
+public:
+    /*! \param path The file to map. */
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /*! \return The start of the mapping. */
+    char* data() const { return data_; }
+    /*! \return The size of the file. */
+    size_t size() const { return size_; }
+
+private:
+    char* data_{nullptr};
+    size_t size_{0};
+    // whether data_ came from mmap rather than a heap copy
+    bool mapped_{false};
+};
+
+/*!
+ * \brief Parameter file whose tensors are only read when first accessed.
+ *
+ *  Opening maps the file and reads the index, or the record headers for the
+ *  packed and aligned formats. A tensor is checksummed and materialized on
+ *  its first Get, aliasing the mapping when its payload is aligned and raw,
+ *  and the result is cached. Compressed payloads are decompressed block by
+ *  block on the runtime thread pool. Tensors that are never requested are never read.
+ *  Get is safe to call from several threads.
+ */
+class LazyParams {
+public:
+    /*! \param path The parameter file. */
+    explicit LazyParams(const std::string& path);
+
+    /*! \return The number of parameters. */
+    size_t size() const { return names_.size(); }
+    /*! \return The parameter names in file order. */
+    const std::vector<std::string>& names() const { return names_; }
+    /*! \return Whether the file holds a parameter called name. */
+    bool count(const std::string& name) const { return index_.count(name) != 0; }
+    /*! \return The location of a parameter. */
+    const ParamsIndexEntry& Entry(const std::string& name) const;
+
+    /*!
+   * \brief Get a parameter, reading it on first access.
+   * \param name The parameter name.
+   * \return The parameter value.
+   */
+    NDArray Get(const std::string& name);
+    NDArray operator[](const std::string& name) { return Get(name); }
+
+    /*! \return The number of parameters read so far. */
+    size_t num_loaded() const;
+
+    /*! \return Every parameter, reading the ones not accessed yet. */
+    Map<String, NDArray> ToMap();
+
+private:
+    std::shared_ptr<MappedFile> file_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, ParamsIndexEntry> index_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, NDArray> loaded_;
+};
+
 /*!
  * \brief Load parameters from a string.
  * \param param_blob Serialized string of parameters.
@@ -97,6 +271,43 @@ Map<String, NDArray> LoadParams(const std::string& param_blob);
  * \return Map of parameter name to parameter value.
  */
 Map<String, NDArray> LoadParams(dmlc::Stream* strm);
+/*!
+ * \brief Load parameters from a file without copying them.
+ *
+ *  The file is mapped into memory and every aligned payload is returned as an
+ *  NDArray that aliases the mapping, the mapping lives as long as any of them.
+ *  Payloads that are not aligned, e.g. in the packed format, are copied.
+ * \param path The parameter file.
+ * \return Map of parameter name to parameter value.
+ */
+Map<String, NDArray> LoadParamsFromFile(const std::string& path);
+/*!
+ * \brief Load parameters from a file on the runtime thread pool.
+ *
+ *  Payloads are cut into blocks that are read with pread, checksummed and
+ *  byte swapped in parallel into freshly allocated NDArrays, blocks of
+ *  compressed payloads are decompressed by the same tasks. Files of the
+ *  packed and aligned formats are copied out of a mapping instead.
+ * \param path The parameter file.
+ * \param options The I/O options.
+ * \return Map of parameter name to parameter value.
+ */
+Map<String, NDArray> LoadParamsParallel(const std::string& path,
+                                        const ParamsIOOptions& options = ParamsIOOptions());
+/*!
+ * \brief Save parameters in the indexed format on the runtime thread pool.
+ *
+ *  Produces the same file as SaveParams with ParamsFormat::kIndexed, with
+ *  the payload blocks written by pwrite and checksummed in parallel.
+ *  Tensors that cannot be written in place, e.g. strided or on another
+ *  device, are streamed through SaveDLTensorData afterwards. With a codec
+ *  the file is written by SaveParams, which compresses in parallel.
+ * \param path The parameter file.
+ * \param params Parameters to save.
+ * \param options The I/O options.
+ */
+void SaveParamsParallel(const std::string& path, const Map<String, NDArray>& params,
+                        const ParamsIOOptions& options = ParamsIOOptions());
 /*!
  * \brief Serialize parameters to a byte array.
  * \param params Parameters to save.
@@ -107,8 +318,88 @@ std::string SaveParams(const Map<String, NDArray>& params);
  * \brief Serialize parameters to a stream.
  * \param strm Stream to write to.
  * \param params Parameters to save.
+ * \param format The layout to write.
+ * \param options The compression of the indexed format, ignored by the others.
  */
-void SaveParams(dmlc::Stream* strm, const Map<String, NDArray>& params);
+void SaveParams(dmlc::Stream* strm, const Map<String, NDArray>& params,
+                ParamsFormat format = ParamsFormat::kPacked,
+                const ParamsIOOptions& options = ParamsIOOptions());
+
+/*! \brief Alignment of the buffer, file offsets and sizes of O_DIRECT transfers. */
+constexpr size_t kDirectIOAlignment = 4096;
+
+/*! \brief Options of BufferedFileStream. */
+struct FileStreamOptions {
+    /*! \brief Size of the stream buffer, rounded up to kDirectIOAlignment. */
+    size_t buffer_size{size_t{4} << 20};
+    /*!
+   * \brief Transfer with O_DIRECT, bypassing the page cache. Falls back to
+   *  buffered I/O where the file system does not support it.
+   */
+    bool direct{false};
+    /*! \brief Hint sequential access with posix_fadvise so the kernel reads ahead further. */
+    bool sequential{true};
+};
+
+/*!
+ * \brief A dmlc stream over a file descriptor with a large buffer.
+ *
+ *  Small reads and writes, e.g. the record headers of NDArray::Load, are
+ *  served from the buffer instead of costing a system call each. Reads of
+ *  at least a buffer go straight to the caller's memory, and writes of at
+ *  least a buffer are issued with the buffered bytes in one writev. In
+ *  direct mode every transfer goes through the aligned buffer, and Close
+ *  writes the unaligned tail of the file without O_DIRECT.
+ */
+class BufferedFileStream : public dmlc::Stream {
+public:
+    /*!
+   * \param path The file.
+   * \param mode "rb" or "wb".
+   * \param options The buffering options.
+   */
+    BufferedFileStream(const std::string& path, const std::string& mode,
+                       const FileStreamOptions& options = FileStreamOptions());
+    ~BufferedFileStream() override;
+
+    BufferedFileStream(const BufferedFileStream&) = delete;
+    BufferedFileStream& operator=(const BufferedFileStream&) = delete;
+
+    using dmlc::Stream::Read;
+    using dmlc::Stream::Write;
+
+    size_t Read(void* ptr, size_t size) override;
+    size_t Write(const void* ptr, size_t size) override;
+
+    /*!
+   * \brief Write out the buffered bytes and close the file.
+   *  Writers should call it before the stream goes away, the destructor
+   *  only logs the errors it raises.
+   */
+    void Close();
+
+    /*! \return The size of the file when it was opened. */
+    uint64_t file_size() const { return file_size_; }
+    /*! \return Whether transfers bypass the page cache. */
+    bool direct() const { return direct_; }
+
+private:
+    // Write out the buffered bytes, in direct mode only the whole aligned blocks unless all.
+    void Flush(bool all);
+    // Refill the read buffer, returns false at end of file.
+    bool Fill();
+
+    std::string path_;
+    int fd_{-1};
+    bool read_;
+    bool direct_{false};
+    uint64_t file_size_{0};
+    char* buf_{nullptr};
+    size_t capacity_{0};
+    // unread bytes are buf_[pos_, end_) when reading, unwritten bytes buf_[0, end_) when writing
+    size_t pos_{0};
+    size_t end_{0};
+};
 
 /*!
  * \brief A dmlc stream which wraps standard file operations.
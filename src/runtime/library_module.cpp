@@ -8,6 +8,7 @@
 #include "runtime/c_backend_api.h"
 #include "runtime/logging.h"
 #include "runtime/module.h"
+#include "workspace_planner.h"
 
 #include <dmlc/memory_io.h>
 #include <string>
@@ -53,6 +54,7 @@ private:
 ffi::Function WrapFFIFunction(TVMFFISafeCallType faddr, const ObjectPtr<Object>& sptr_to_self) {
     return ffi::Function::FromPacked([faddr, sptr_to_self](ffi::PackedArgs args, ffi::Any* rv) {
         ICHECK_LT(rv->type_index(), ffi::TypeIndex::kTVMFFIStaticObjectBegin);
+        WorkspacePlanScope plan_scope(reinterpret_cast<const void*>(faddr));
         TVM_FFI_CHECK_SAFE_CALL((*faddr)(nullptr, reinterpret_cast<const TVMFFIAny*>(args.data()),
                                          args.size(), reinterpret_cast<TVMFFIAny*>(rv)));
     });
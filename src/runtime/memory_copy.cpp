@@ -0,0 +1,263 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+
+#include "memory_copy.h"
+#include "runtime/logging.h"
+#include "runtime/threading_backend.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LITETVM_STREAMING_COPY 1
+#include <immintrin.h>
+#endif
+
+namespace litetvm::runtime {
+namespace {
+
+// Bytes each task of a parallel copy claims at a time.
+constexpr size_t kCopyChunkBytes = size_t{1} << 20;
+constexpr int64_t kDefaultStreamingCopyThreshold = int64_t{16} << 20;
+
+int64_t GetStreamingCopyThreshold() {
+    static const int64_t threshold = [] {
+        const char* val = getenv("TVM_CPU_STREAMING_COPY_THRESHOLD");
+        return val ? atoll(val) : kDefaultStreamingCopyThreshold;
+    }();
+    return threshold;
+}
+
+#if defined(LITETVM_STREAMING_COPY)
+enum class StreamingISA : int {
+    kNone = 0,
+    kAVX2 = 1,
+    kAVX512 = 2,
+};
+
+StreamingISA DetectStreamingISA() {
+    static const StreamingISA isa = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return StreamingISA::kAVX512;
+        if (__builtin_cpu_supports("avx2")) return StreamingISA::kAVX2;
+        return StreamingISA::kNone;
+    }();
+    return isa;
+}
+
+// Bytes to copy before dst reaches the given alignment.
+size_t HeadBytes(const char* dst, size_t alignment, size_t n) {
+    size_t misalign = reinterpret_cast<uintptr_t>(dst) % alignment;
+    return std::min(n, misalign == 0 ? 0 : alignment - misalign);
+}
+
+__attribute__((target("avx2"))) void StreamCopyAVX2(char* dst, const char* src, size_t n) {
+    size_t head = HeadBytes(dst, 32, n);
+    std::memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    n -= head;
+    for (; n >= 128; n -= 128, dst += 128, src += 128) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 64));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 96));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), b);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 64), c);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 96), d);
+    }
+    for (; n >= 32; n -= 32, dst += 32, src += 32) {
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst),
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+    }
+    // order the streaming stores before anything this thread writes next
+    _mm_sfence();
+    std::memcpy(dst, src, n);
+}
+
+__attribute__((target("avx512f"))) void StreamCopyAVX512(char* dst, const char* src, size_t n) {
+    size_t head = HeadBytes(dst, 64, n);
+    std::memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    n -= head;
+    for (; n >= 256; n -= 256, dst += 256, src += 256) {
+        __m512i a = _mm512_loadu_si512(src);
+        __m512i b = _mm512_loadu_si512(src + 64);
+        __m512i c = _mm512_loadu_si512(src + 128);
+        __m512i d = _mm512_loadu_si512(src + 192);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst), a);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + 64), b);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + 128), c);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + 192), d);
+    }
+    for (; n >= 64; n -= 64, dst += 64, src += 64) {
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst), _mm512_loadu_si512(src));
+    }
+    _mm_sfence();
+    std::memcpy(dst, src, n);
+}
+#endif
+
+// Copy one chunk of a large copy, with non-temporal stores when streaming.
+void CopyChunk(char* dst, const char* src, size_t n, bool streaming) {
+#if defined(LITETVM_STREAMING_COPY)
+    if (streaming) {
+        switch (DetectStreamingISA()) {
+            case StreamingISA::kAVX512:
+                StreamCopyAVX512(dst, src, n);
+                return;
+            case StreamingISA::kAVX2:
+                StreamCopyAVX2(dst, src, n);
+                return;
+            default:
+                break;
+        }
+    }
+#endif
+    std::memcpy(dst, src, n);
+}
+
+// Copy n elements of kBytes bytes between strided rows.
+template<size_t kBytes>
+void CopyElems(char* dst, int64_t dst_stride, const char* src, int64_t src_stride, int64_t n) {
+    for (int64_t i = 0; i < n; ++i, dst += dst_stride, src += src_stride) {
+        std::memcpy(dst, src, kBytes);
+    }
+}
+
+// Byte strides of a tensor, compact row-major ones when it has none.
+std::vector<int64_t> ByteStrides(const DLTensor* t, int64_t elem_bytes) {
+    std::vector<int64_t> strides(t->ndim);
+    int64_t compact = elem_bytes;
+    for (int i = t->ndim - 1; i >= 0; --i) {
+        strides[i] = t->strides != nullptr ? t->strides[i] * elem_bytes : compact;
+        compact *= t->shape[i];
+    }
+    return strides;
+}
+
+// One dimension of a copy, strides in bytes.
+struct CopyDim {
+    int64_t extent;
+    int64_t src_stride;
+    int64_t dst_stride;
+};
+
+// Drop unit dimensions and merge each dimension into its outer neighbour
+// when both tensors step over the pair contiguously, which makes the
+// innermost run as long as the layouts allow.
+std::vector<CopyDim> CollapseDims(const DLTensor* from, const DLTensor* to, int64_t elem_bytes) {
+    std::vector<int64_t> src = ByteStrides(from, elem_bytes);
+    std::vector<int64_t> dst = ByteStrides(to, elem_bytes);
+    std::vector<CopyDim> dims;
+    for (int i = 0; i < from->ndim; ++i) {
+        const int64_t extent = from->shape[i];
+        if (extent == 1) continue;
+        if (!dims.empty()) {
+            CopyDim& outer = dims.back();
+            if (outer.src_stride == src[i] * extent && outer.dst_stride == dst[i] * extent) {
+                outer.extent *= extent;
+                outer.src_stride = src[i];
+                outer.dst_stride = dst[i];
+                continue;
+            }
+        }
+        dims.push_back({extent, src[i], dst[i]});
+    }
+    return dims;
+}
+
+}// namespace
+
+void CopyBytes(void* dst, const void* src, size_t nbytes) {
+    if (nbytes < kParallelCopyThreshold) {
+        std::memcpy(dst, src, nbytes);
+        return;
+    }
+    const int64_t threshold = GetStreamingCopyThreshold();
+    const bool streaming = threshold >= 0 && static_cast<int64_t>(nbytes) >= threshold;
+    auto* d = static_cast<char*>(dst);
+    const auto* s = static_cast<const char*>(src);
+    const auto num_chunks = static_cast<int64_t>((nbytes + kCopyChunkBytes - 1) / kCopyChunkBytes);
+    parallel_for_with_threading_backend(
+            [&](int64_t i) {
+                size_t begin = static_cast<size_t>(i) * kCopyChunkBytes;
+                CopyChunk(d + begin, s + begin, std::min(kCopyChunkBytes, nbytes - begin), streaming);
+            },
+            0, num_chunks, ParallelForSchedule::Dynamic(1));
+}
+
+void CopyStridedTensor(const DLTensor* from, DLTensor* to) {
+    CHECK_EQ(from->ndim, to->ndim) << "CopyStridedTensor: dimension mismatch";
+    for (int i = 0; i < from->ndim; ++i) {
+        CHECK_EQ(from->shape[i], to->shape[i]) << "CopyStridedTensor: shape mismatch at dimension " << i;
+    }
+    const int64_t elem_bits = from->dtype.bits * from->dtype.lanes;
+    CHECK_EQ(elem_bits, to->dtype.bits * to->dtype.lanes) << "CopyStridedTensor: element size mismatch";
+    CHECK_EQ(elem_bits % 8, 0) << "CopyStridedTensor: sub-byte elements can not be strided";
+    const int64_t elem_bytes = elem_bits / 8;
+    const auto* src = static_cast<const char*>(from->data) + from->byte_offset;
+    auto* dst = static_cast<char*>(to->data) + to->byte_offset;
+    for (int i = 0; i < from->ndim; ++i) {
+        if (from->shape[i] == 0) return;
+    }
+
+    std::vector<CopyDim> dims = CollapseDims(from, to, elem_bytes);
+    if (dims.empty()) {
+        std::memcpy(dst, src, elem_bytes);
+        return;
+    }
+    const int ndim = static_cast<int>(dims.size());
+    int64_t rows = 1;
+    for (int i = 0; i < ndim - 1; ++i) rows *= dims[i].extent;
+    const int64_t inner = dims[ndim - 1].extent;
+    const int64_t src_inner = dims[ndim - 1].src_stride;
+    const int64_t dst_inner = dims[ndim - 1].dst_stride;
+    const bool dense_rows = src_inner == elem_bytes && dst_inner == elem_bytes;
+    const size_t row_bytes = static_cast<size_t>(inner * elem_bytes);
+    if (rows == 1 && dense_rows) {
+        CopyBytes(dst, src, row_bytes);
+        return;
+    }
+
+    auto copy_row = [&](int64_t r) {
+        int64_t src_offset = 0, dst_offset = 0;
+        for (int i = ndim - 2; i >= 0; --i) {
+            int64_t idx = r % dims[i].extent;
+            r /= dims[i].extent;
+            src_offset += idx * dims[i].src_stride;
+            dst_offset += idx * dims[i].dst_stride;
+        }
+        char* d = dst + dst_offset;
+        const char* s = src + src_offset;
+        if (dense_rows) {
+            std::memcpy(d, s, row_bytes);
+            return;
+        }
+        switch (elem_bytes) {
+            case 1: CopyElems<1>(d, dst_inner, s, src_inner, inner); break;
+            case 2: CopyElems<2>(d, dst_inner, s, src_inner, inner); break;
+            case 4: CopyElems<4>(d, dst_inner, s, src_inner, inner); break;
+            case 8: CopyElems<8>(d, dst_inner, s, src_inner, inner); break;
+            default:
+                for (int64_t j = 0; j < inner; ++j) {
+                    std::memcpy(d + j * dst_inner, s + j * src_inner, elem_bytes);
+                }
+        }
+    };
+    if (rows * row_bytes < kParallelCopyThreshold) {
+        for (int64_t r = 0; r < rows; ++r) copy_row(r);
+        return;
+    }
+    // every grain of rows is worth about one chunk of a flat copy
+    const int64_t grain = std::max<int64_t>(1, kCopyChunkBytes / row_bytes);
+    parallel_for_with_threading_backend(copy_row, 0, rows, ParallelForSchedule::Dynamic(0, grain));
+}
+
+}// namespace litetvm::runtime
@@ -0,0 +1,46 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+
+#ifndef LITETVM_RUNTIME_MEMORY_COPY_H
+#define LITETVM_RUNTIME_MEMORY_COPY_H
+
+#include <dlpack/dlpack.h>
+
+#include <cstddef>
+
+namespace litetvm::runtime {
+
+/*! \brief Copies of at least this many bytes are split across the runtime thread pool. */
+constexpr size_t kParallelCopyThreshold = size_t{4} << 20;
+
+/*!
+ * \brief Copy nbytes between non-overlapping host buffers, sized to the copy.
+ *
+ *  Small copies are a plain memcpy. Large copies are split across the
+ *  runtime thread pool, and copies from the streaming threshold on use
+ *  non-temporal stores when the CPU has AVX2 or AVX-512, so they do not
+ *  evict the working set from the cache. The threshold defaults to 16 MiB
+ *  and is read from TVM_CPU_STREAMING_COPY_THRESHOLD, a negative value
+ *  disables streaming stores.
+ * \param dst The destination.
+ * \param src The source.
+ * \param nbytes Number of bytes to copy.
+ */
+void CopyBytes(void* dst, const void* src, size_t nbytes);
+
+/*!
+ * \brief Copy between host tensors of the same shape and dtype, either may be strided.
+ *
+ *  Unit dimensions are dropped and dimensions that both tensors step over
+ *  contiguously are merged, so the copy runs over the fewest and longest
+ *  innermost runs. Runs that are dense on both sides are copied with
+ *  memcpy, strided ones element by element with fixed size moves.
+ * \param from The source tensor.
+ * \param to The destination tensor.
+ */
+void CopyStridedTensor(const DLTensor* from, DLTensor* to);
+
+}// namespace litetvm::runtime
+
+#endif// LITETVM_RUNTIME_MEMORY_COPY_H
@@ -9,6 +9,11 @@
 #include "runtime/data_type.h"
 #include "runtime/device_api.h"
 #include "runtime/logging.h"
+#include "runtime/ndarray_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 namespace litetvm::runtime {
 
@@ -41,7 +46,6 @@ inline void VerifyDataType(DLDataType dtype) {
 void ArrayCopyFromBytes(DLTensor* handle, const void* data, size_t nbytes) {
     size_t arr_size = GetDataSize(*handle);
     ICHECK_EQ(arr_size, nbytes) << "ArrayCopyFromBytes: size mismatch";
-    ICHECK(IsContiguous(*handle)) << "ArrayCopyFromBytes only support contiguous array for now";
 
     DLTensor from;
     from.data = const_cast<void*>(data);
@@ -60,7 +64,6 @@ void NDArray::CopyToBytes(const DLTensor* handle, void* data, size_t nbytes,
                           TVMStreamHandle stream) {
     size_t arr_size = GetDataSize(*handle);
     ICHECK_EQ(arr_size, nbytes) << "ArrayCopyToBytes: size mismatch";
-    ICHECK(ffi::IsContiguous(*handle)) << "ArrayCopyToBytes only support contiguous array for now";
 
     DLTensor to;
     to.data = data;
@@ -76,16 +79,153 @@ void NDArray::CopyToBytes(const DLTensor* handle, void* data, size_t nbytes,
     DeviceAPI::Get(handle->device)->StreamSync(handle->device, stream);
 }
 
+namespace {
+
+// Size of each host buffer SaveDLTensorData streams through.
+constexpr size_t kSaveChunkBytes = 1 << 20;
+
+// Byte swap a chunk of payload if needed and write it.
+void WriteSaveChunk(dmlc::Stream* strm, char* data, size_t nbytes, int type_bytes) {
+    if (!DMLC_IO_NO_ENDIAN_SWAP) {
+        dmlc::ByteSwap(data, type_bytes, nbytes / type_bytes);
+    }
+    strm->Write(data, nbytes);
+}
+
+// Gather the elements of a CPU tensor in row-major order through buf.
+void SaveStridedCPUData(dmlc::Stream* strm, const DLTensor* tensor, char* buf, int type_bytes) {
+    ICHECK_EQ(tensor->dtype.bits % 8, 0) << "Cannot save strided tensors of sub-byte types";
+    const int64_t elem_bytes = type_bytes * tensor->dtype.lanes;
+    const int ndim = tensor->ndim;
+    const char* base = static_cast<const char*>(tensor->data) + tensor->byte_offset;
+    // rows along the innermost axis, the outer axes are walked by an index counter
+    const int64_t row_len = ndim == 0 ? 1 : tensor->shape[ndim - 1];
+    const int64_t row_stride = ndim == 0 ? 1 : tensor->strides[ndim - 1];
+    int64_t num_rows = 1;
+    for (int i = 0; i + 1 < ndim; ++i) num_rows *= tensor->shape[i];
+    std::vector<int64_t> index(std::max(ndim - 1, 0), 0);
+    const size_t capacity = kSaveChunkBytes / elem_bytes * elem_bytes;
+    size_t used = 0;
+    for (int64_t row = 0; row < num_rows && row_len != 0; ++row) {
+        int64_t offset = 0;
+        for (int i = 0; i + 1 < ndim; ++i) offset += index[i] * tensor->strides[i];
+        const char* src = base + offset * elem_bytes;
+        for (int64_t i = 0; i < row_len;) {
+            if (used == capacity) {
+                WriteSaveChunk(strm, buf, used, type_bytes);
+                used = 0;
+            }
+            int64_t n = std::min<int64_t>(row_len - i, (capacity - used) / elem_bytes);
+            if (row_stride == 1) {
+                std::memcpy(buf + used, src + i * elem_bytes, n * elem_bytes);
+            } else {
+                for (int64_t k = 0; k < n; ++k) {
+                    std::memcpy(buf + used + k * elem_bytes, src + (i + k) * row_stride * elem_bytes,
+                                elem_bytes);
+                }
+            }
+            used += n * elem_bytes;
+            i += n;
+        }
+        for (int d = ndim - 2; d >= 0; --d) {
+            if (++index[d] < tensor->shape[d]) break;
+            index[d] = 0;
+        }
+    }
+    if (used != 0) WriteSaveChunk(strm, buf, used, type_bytes);
+}
+
+// Copy a contiguous device tensor to the host chunk by chunk, writing one
+// chunk while the next one is in flight.
+void SaveDeviceData(dmlc::Stream* strm, const DLTensor* tensor, size_t nbytes, int type_bytes) {
+    DeviceAPI* api = DeviceAPI::Get(tensor->device);
+    TVMStreamHandle stream = api->CreateStream(tensor->device);
+    std::vector<char> bufs[2] = {std::vector<char>(std::min(nbytes, kSaveChunkBytes)),
+                                 std::vector<char>(std::min(nbytes, kSaveChunkBytes))};
+    int64_t extents[2];
+    auto issue = [&](size_t begin, int slot) {
+        extents[slot] = static_cast<int64_t>(std::min(kSaveChunkBytes, nbytes - begin));
+        DLDataType bytes_type{kDLUInt, 8, 1};
+        DLTensor from{tensor->data, tensor->device, 1, bytes_type, &extents[slot], nullptr,
+                      tensor->byte_offset + begin};
+        DLTensor to{bufs[slot].data(), Device{kDLCPU, 0}, 1, bytes_type, &extents[slot], nullptr, 0};
+        api->CopyDataFromTo(&from, &to, stream);
+    };
+    issue(0, 0);
+    api->StreamSync(tensor->device, stream);
+    int cur = 0;
+    for (size_t begin = 0; begin < nbytes;) {
+        size_t next = begin + static_cast<size_t>(extents[cur]);
+        if (next < nbytes) issue(next, 1 - cur);
+        WriteSaveChunk(strm, bufs[cur].data(), static_cast<size_t>(extents[cur]), type_bytes);
+        if (next < nbytes) api->StreamSync(tensor->device, stream);
+        begin = next;
+        cur = 1 - cur;
+    }
+    api->FreeStream(tensor->device, stream);
+}
+
+}// namespace
+
+void SaveDLTensorData(dmlc::Stream* strm, const DLTensor* tensor) {
+    const size_t nbytes = GetDataSize(*tensor);
+    if (nbytes == 0) return;
+    const int type_bytes = (tensor->dtype.bits + 7) / 8;
+    const bool contiguous = IsContiguous(*tensor);
+    if (tensor->device.device_type != kDLCPU) {
+        // device copies only move contiguous data
+        ICHECK(contiguous) << "SaveDLTensorData: cannot save a non-contiguous tensor on "
+                           << tensor->device << ", make it contiguous on the device first";
+        SaveDeviceData(strm, tensor, nbytes, type_bytes);
+        return;
+    }
+    const char* data = static_cast<const char*>(tensor->data) + tensor->byte_offset;
+    if (contiguous && DMLC_IO_NO_ENDIAN_SWAP) {
+        // quick path
+        strm->Write(data, nbytes);
+        return;
+    }
+    std::vector<char> buf(std::min(nbytes, kSaveChunkBytes));
+    if (contiguous) {
+        for (size_t begin = 0; begin < nbytes; begin += buf.size()) {
+            size_t n = std::min(buf.size(), nbytes - begin);
+            std::memcpy(buf.data(), data + begin, n);
+            WriteSaveChunk(strm, buf.data(), n, type_bytes);
+        }
+    } else {
+        buf.resize(kSaveChunkBytes);
+        SaveStridedCPUData(strm, tensor, buf.data(), type_bytes);
+    }
+}
+
 NDArray NDArray::Empty(ffi::Shape shape, DLDataType dtype, Device dev, Optional<String> mem_scope) {
     struct DeviceAPIAlloc {
         void AllocData(DLTensor* tensor, Optional<String> mem_scope) {
-            tensor->data = DeviceAPI::Get(tensor->device)
-                                   ->AllocDataSpace(tensor->device, tensor->ndim, tensor->shape,
-                                                    tensor->dtype, mem_scope);
+            // the cache hands out blocks of kAllocAlignment, plain host memory only
+            cached_ = NDArrayCache::Enabled() && tensor->device.device_type == kDLCPU &&
+                      (!mem_scope.has_value() || mem_scope.value().empty() || mem_scope.value() == "global") &&
+                      static_cast<size_t>(tensor->dtype.bits) / 8 * tensor->dtype.lanes <= kAllocAlignment;
+            if (cached_) {
+                tensor->data = NDArrayCache::Alloc(tensor->device, GetDataSize(*tensor), tensor->dtype, &nbytes_);
+                return;
+            }
+            DeviceAPI* api = DeviceAPI::Get(tensor->device);
+            tensor->data = api->AllocDataSpace(tensor->device, tensor->ndim, tensor->shape,
+                                               tensor->dtype, mem_scope);
+            nbytes_ = api->GetDataSize(*tensor, mem_scope);
+            DeviceAPI::RecordAlloc(tensor->device, nbytes_, DeviceMemoryKind::kNDArray);
         }
         void FreeData(DLTensor* tensor) {
+            if (cached_) {
+                NDArrayCache::Free(tensor->device, tensor->data, nbytes_);
+                return;
+            }
             DeviceAPI::Get(tensor->device)->FreeDataSpace(tensor->device, tensor->data);
+            DeviceAPI::RecordFree(tensor->device, nbytes_, DeviceMemoryKind::kNDArray);
         }
+        // size accounted in the device statistics, the block size when cached
+        size_t nbytes_{0};
+        bool cached_{false};
     };
     return ffi::Tensor::FromNDAlloc(DeviceAPIAlloc(), shape, dtype, dev, mem_scope);
 }
@@ -0,0 +1,217 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+
+#include "runtime/ndarray_cache.h"
+#include "ffi/container/map.h"
+#include "ffi/function.h"
+#include "ffi/reflection/registry.h"
+#include "ffi/string.h"
+#include "runtime/logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace litetvm::runtime {
+namespace {
+
+// Requests below this size round up to kSmallStep, larger ones to a quarter power of two.
+constexpr size_t kSmallLimit = size_t{1} << 20;
+constexpr size_t kSmallStep = 512;
+constexpr int64_t kDefaultMaxBytes = int64_t{1} << 30;
+
+// The size of the bucket of a request.
+size_t BucketBytes(size_t nbytes) {
+    if (nbytes <= kSmallLimit) {
+        return std::max(kSmallStep, (nbytes + kSmallStep - 1) / kSmallStep * kSmallStep);
+    }
+    // four buckets per power of two, at most a quarter of a block is slack
+    size_t step = size_t{1} << (std::bit_width(nbytes - 1) - 3);
+    return (nbytes + step - 1) / step * step;
+}
+
+class NDArrayCachePool {
+public:
+    NDArrayCachePool() {
+        const char* enabled = getenv("TVM_NDARRAY_CACHE");
+        enabled_.store(enabled != nullptr && atoi(enabled) != 0);
+        const char* limit = getenv("TVM_NDARRAY_CACHE_LIMIT");
+        max_bytes_ = limit ? atoll(limit) : kDefaultMaxBytes;
+    }
+
+    static NDArrayCachePool* Global() {
+        // NOTE: explicitly use new to avoid exit-time destruction of global state
+        static auto* inst = new NDArrayCachePool();
+        return inst;
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void SetEnabled(bool enabled) {
+        enabled_.store(enabled);
+        if (!enabled) Trim(0);
+    }
+
+    int64_t max_bytes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return max_bytes_;
+    }
+
+    void SetMaxBytes(int64_t max_bytes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            max_bytes_ = max_bytes;
+        }
+        Trim(max_bytes);
+    }
+
+    void* Alloc(Device dev, size_t nbytes, DLDataType type_hint, size_t* block_bytes) {
+        ICHECK_EQ(dev.device_type, kDLCPU) << "NDArrayCache only holds CPU memory";
+        *block_bytes = BucketBytes(nbytes);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = buckets_.find(Key{*block_bytes, dev.device_type, dev.device_id});
+            if (it != buckets_.end() && !it->second.empty()) {
+                void* ptr = it->second.back();
+                it->second.pop_back();
+                stats_.cached_bytes -= static_cast<int64_t>(*block_bytes);
+                stats_.cached_blocks -= 1;
+                stats_.hits += 1;
+                return ptr;
+            }
+            stats_.misses += 1;
+        }
+        void* ptr = DeviceAPI::Get(dev)->AllocDataSpace(dev, *block_bytes, kAllocAlignment, type_hint);
+        DeviceAPI::RecordAlloc(dev, *block_bytes, DeviceMemoryKind::kNDArray);
+        return ptr;
+    }
+
+    void Free(Device dev, void* ptr, size_t block_bytes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (enabled() && stats_.cached_bytes + static_cast<int64_t>(block_bytes) <= max_bytes_) {
+                buckets_[Key{block_bytes, dev.device_type, dev.device_id}].push_back(ptr);
+                stats_.cached_bytes += static_cast<int64_t>(block_bytes);
+                stats_.cached_blocks += 1;
+                return;
+            }
+            stats_.trimmed_blocks += 1;
+        }
+        Release(Key{block_bytes, dev.device_type, dev.device_id}, ptr);
+    }
+
+    void Trim(int64_t target_bytes) {
+        std::vector<std::pair<Key, void*>> victims;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto it = buckets_.rbegin(); it != buckets_.rend() && stats_.cached_bytes > target_bytes;
+                 ++it) {
+                std::vector<void*>& blocks = it->second;
+                while (!blocks.empty() && stats_.cached_bytes > target_bytes) {
+                    victims.emplace_back(it->first, blocks.back());
+                    blocks.pop_back();
+                    stats_.cached_bytes -= static_cast<int64_t>(std::get<0>(it->first));
+                    stats_.cached_blocks -= 1;
+                    stats_.trimmed_blocks += 1;
+                }
+            }
+        }
+        // free outside the lock, device frees may synchronize
+        for (const auto& [key, ptr]: victims) Release(key, ptr);
+    }
+
+    NDArrayCacheStats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void ResetStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.hits = 0;
+        stats_.misses = 0;
+        stats_.trimmed_blocks = 0;
+    }
+
+private:
+    // block size first, so buckets iterate by size
+    using Key = std::tuple<size_t, int, int>;
+
+    static void Release(const Key& key, void* ptr) {
+        Device dev{static_cast<DLDeviceType>(std::get<1>(key)), std::get<2>(key)};
+        DeviceAPI::Get(dev)->FreeDataSpace(dev, ptr);
+        DeviceAPI::RecordFree(dev, std::get<0>(key), DeviceMemoryKind::kNDArray);
+    }
+
+    std::atomic<bool> enabled_{false};
+    std::mutex mutex_;
+    int64_t max_bytes_;
+    std::map<Key, std::vector<void*>> buckets_;
+    NDArrayCacheStats stats_;
+};
+
+}// namespace
+
+void NDArrayCache::SetEnabled(bool enabled) {
+    NDArrayCachePool::Global()->SetEnabled(enabled);
+}
+
+bool NDArrayCache::Enabled() {
+    return NDArrayCachePool::Global()->enabled();
+}
+
+void NDArrayCache::SetMaxBytes(int64_t max_bytes) {
+    NDArrayCachePool::Global()->SetMaxBytes(max_bytes);
+}
+
+int64_t NDArrayCache::MaxBytes() {
+    return NDArrayCachePool::Global()->max_bytes();
+}
+
+void NDArrayCache::Trim(int64_t target_bytes) {
+    NDArrayCachePool::Global()->Trim(target_bytes);
+}
+
+NDArrayCacheStats NDArrayCache::GetStats() {
+    return NDArrayCachePool::Global()->stats();
+}
+
+void NDArrayCache::ResetStats() {
+    NDArrayCachePool::Global()->ResetStats();
+}
+
+void* NDArrayCache::Alloc(Device dev, size_t nbytes, DLDataType type_hint, size_t* block_bytes) {
+    return NDArrayCachePool::Global()->Alloc(dev, nbytes, type_hint, block_bytes);
+}
+
+void NDArrayCache::Free(Device dev, void* ptr, size_t block_bytes) {
+    NDArrayCachePool::Global()->Free(dev, ptr, block_bytes);
+}
+
+}// namespace litetvm::runtime
+
+using namespace litetvm::runtime;
+
+TVM_FFI_STATIC_INIT_BLOCK({
+    namespace refl = litetvm::ffi::reflection;
+    refl::GlobalDef()
+            .def("runtime.NDArrayCacheSetEnabled", [](bool enabled) { NDArrayCache::SetEnabled(enabled); })
+            .def("runtime.NDArrayCacheSetMaxBytes",
+                 [](int64_t max_bytes) { NDArrayCache::SetMaxBytes(max_bytes); })
+            .def("runtime.NDArrayCacheTrim", [](int64_t target_bytes) { NDArrayCache::Trim(target_bytes); })
+            .def("runtime.NDArrayCacheStats", []() {
+                NDArrayCacheStats stats = NDArrayCache::GetStats();
+                litetvm::ffi::Map<litetvm::ffi::String, litetvm::ffi::Any> ret;
+                ret.Set("cached_bytes", stats.cached_bytes);
+                ret.Set("cached_blocks", stats.cached_blocks);
+                ret.Set("hits", stats.hits);
+                ret.Set("misses", stats.misses);
+                ret.Set("trimmed_blocks", stats.trimmed_blocks);
+                return ret;
+            });
+});
@@ -14,9 +14,15 @@
 #include <dmlc/json.h>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <locale>
 #include <map>
+#include <mutex>
 #include <numeric>
+#include <set>
+#include <sstream>
 #include <thread>
+#include <unordered_set>
 
 namespace litetvm {
 namespace runtime {
@@ -122,7 +128,11 @@ Profiler::Profiler(std::vector<Device> devs, std::vector<MetricCollector> metric
 
 void Profiler::Start() {
     is_running_ = true;
+    start_memory_.clear();
+    outer_peaks_.clear();
     for (auto dev: devs_) {
+        start_memory_.push_back(DeviceAPI::GetMemoryStats(dev));
+        outer_peaks_.push_back(DeviceAPI::StartPeakWindow(dev));
         StartCall("Total", dev, {});
     }
 }
@@ -161,6 +171,12 @@ void Profiler::Stop() {
     for (size_t i = 0; i < devs_.size(); i++) {
         StopCall();
     }
+    stop_memory_.clear();
+    window_peaks_.clear();
+    for (size_t i = 0; i < devs_.size(); i++) {
+        stop_memory_.push_back(DeviceAPI::GetMemoryStats(devs_[i]));
+        window_peaks_.push_back(DeviceAPI::StopPeakWindow(devs_[i], outer_peaks_[i]));
+    }
 }
 
 std::vector<int64_t> ToShape(NDArray shape_tensor) {
@@ -268,8 +284,8 @@ String ReportNode::AsCSV() const {
                     s << (*it).second.as<PercentNode>()->percent;
                 } else if ((*it).second.as<RatioNode>()) {
                     s << (*it).second.as<RatioNode>()->ratio;
-                } else if ((*it).second.as<ffi::StringObj>()) {
-                    s << "\"" << Downcast<String>((*it).second) << "\"";
+                } else if ((*it).second.as<String>()) {
+                    s << "\"" << (*it).second.cast<String>() << "\"";
                 }
             }
             if (i < headers.size() - 1) {
@@ -373,7 +389,7 @@ String ReportNode::AsJSON() const {
 // Aggregate a set of values for a metric. Computes sum for Duration, Count,
 // and Percent; average for Ratio; and assumes all Strings are the same. All
 // ObjectRefs in metrics must have the same type.
-ObjectRef AggregateMetric(const std::vector<Any>& metrics) {
+Any AggregateMetric(const std::vector<Any>& metrics) {
     ICHECK_GT(metrics.size(), 0) << "Must pass a non-zero number of metrics";
     if (metrics[0].as<DurationNode>()) {
         double sum = 0;
@@ -399,9 +415,9 @@ ObjectRef AggregateMetric(const std::vector<Any>& metrics) {
             sum += metric.as<RatioNode>()->ratio;
         }
         return ObjectRef(make_object<RatioNode>(sum / metrics.size()));
-    } else if (metrics[0].as<ffi::StringObj>()) {
+    } else if (metrics[0].as<String>()) {
         for (auto& m: metrics) {
-            if (Downcast<String>(metrics[0]) != Downcast<String>(m)) {
+            if (metrics[0].cast<String>() != m.cast<String>()) {
                 return String("");
             }
         }
@@ -448,8 +464,8 @@ static String print_metric(Any metric) {
         set_locale_for_separators(s);
         s << std::setprecision(2) << metric.as<RatioNode>()->ratio;
         val = s.str();
-    } else if (metric.as<ffi::StringObj>()) {
-        val = Downcast<String>(metric);
+    } else if (metric.as<String>()) {
+        val = metric.cast<String>();
     } else {
         LOG(FATAL) << "Cannot print metric of type " << metric.GetTypeKey();
     }
@@ -464,15 +480,15 @@ String ReportNode::AsTable(bool sort, bool aggregate, bool compute_col_sums) con
         for (size_t i = 0; i < calls.size(); i++) {
             auto& frame = calls[i];
             auto it = frame.find("Hash");
-            std::string name = Downcast<String>(frame["Name"]);
+            std::string name = frame["Name"].cast<String>();
             if (it != frame.end()) {
-                name = Downcast<String>((*it).second);
+                name = (*it).second.cast<String>();
             }
             if (frame.find("Argument Shapes") != frame.end()) {
-                name += Downcast<String>(frame["Argument Shapes"]);
+                name += frame["Argument Shapes"].cast<String>();
             }
             if (frame.find("Device") != frame.end()) {
-                name += Downcast<String>(frame["Device"]);
+                name += frame["Device"].cast<String>();
             }
 
             if (aggregates.find(name) == aggregates.end()) {
@@ -668,11 +684,25 @@ Report Profiler::Report() {
     for (size_t i = 0; i < devs_.size(); i++) {
         auto row = rows[rows.size() - 1];
         rows.pop_back();
-        device_metrics[Downcast<String>(row["Device"])] = row;
+        device_metrics[row["Device"].cast<String>()] = row;
         overall_time_us =
                 std::max(overall_time_us, row["Duration (us)"].as<DurationNode>()->microseconds);
     }
 
+    // memory usage of each device between Start and Stop, the peak is the
+    // highest usage inside the window over the usage at Start
+    for (size_t i = 0; i < start_memory_.size() && i < stop_memory_.size(); i++) {
+        const DeviceMemoryStats& start = start_memory_[i];
+        const DeviceMemoryStats& stats = stop_memory_[i];
+        auto& row = device_metrics[String(DeviceString(devs_[i]))];
+        row.Set("Peak Memory Increase (bytes)",
+                ObjectRef(make_object<CountNode>(window_peaks_[i] - start.current_bytes)));
+        row.Set("Memory Growth (bytes)",
+                ObjectRef(make_object<CountNode>(stats.current_bytes - start.current_bytes)));
+        row.Set("Allocations", ObjectRef(make_object<CountNode>(stats.alloc_count - start.alloc_count)));
+        row.Set("Frees", ObjectRef(make_object<CountNode>(stats.free_count - start.free_count)));
+    }
+
     // Calculate percentages
     for (auto& row: rows) {
         row["Percent"] = ObjectRef(make_object<PercentNode>(
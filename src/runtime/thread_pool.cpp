@@ -1,27 +1,33 @@
 //
 // Created by 赵丹 on 25-3-6.
 //
-#include "runtime/array.h"
+#include "ffi/container/array.h"
+#include "ffi/function.h"
+#include "ffi/reflection/registry.h"
 #include "runtime/c_backend_api.h"
-#include "runtime/c_runtime_api.h"
-#include "runtime/packed_func.h"
-#include "runtime/registry.h"
+#include "runtime/logging.h"
 #include "runtime/threading_backend.h"
 #include "support/utils.h"
 
 #include <algorithm>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <climits>
 #include <cstring>
-#include <dmlc/logging.h>
 #include <dmlc/thread_local.h>
 #include <memory>
-#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_set>
 #include <vector>
 
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 constexpr int kL1CacheBytes = 64;
 
 namespace litetvm {
@@ -38,10 +44,417 @@ uint32_t GetSpinCount() {
     }
     return atoi(val);
 }
+
+// number of tasks per worker when the work-stealing scheduler picks num_task itself
+constexpr int kDefaultStealSplitFactor = 4;
+
+int GetStealSplitFactor() {
+    const char* val = getenv("TVM_THREAD_POOL_STEAL_SPLIT_FACTOR");
+    if (!val || atoi(val) <= 0) {
+        return kDefaultStealSplitFactor;
+    }
+    return atoi(val);
+}
+
+threading::SchedulerMode ParseSchedulerMode(const std::string& name) {
+    if (name == "static") return threading::SchedulerMode::kStatic;
+    if (name == "work_stealing") return threading::SchedulerMode::kWorkStealing;
+    LOG(FATAL) << "Unknown thread pool scheduler '" << name
+               << "', expected one of 'static', 'work_stealing'";
+    return threading::SchedulerMode::kStatic;
+}
+
+threading::SchedulerMode GetDefaultSchedulerMode() {
+    const char* val = getenv("TVM_THREAD_POOL_SCHEDULER");
+    if (!val) {
+        return threading::SchedulerMode::kStatic;
+    }
+    return ParseSchedulerMode(val);
+}
+
+/*! \brief The process-wide scheduler mode, read by every pool at launch time. */
+std::atomic<threading::SchedulerMode>& SchedulerModeStore() {
+    static std::atomic<threading::SchedulerMode> mode{GetDefaultSchedulerMode()};
+    return mode;
+}
+
+threading::PoolMode ParsePoolMode(const std::string& name) {
+    if (name == "thread_local") return threading::PoolMode::kThreadLocal;
+    if (name == "shared") return threading::PoolMode::kShared;
+    LOG(FATAL) << "Unknown thread pool mode '" << name
+               << "', expected one of 'thread_local', 'shared'";
+    return threading::PoolMode::kThreadLocal;
+}
+
+threading::PoolMode GetDefaultPoolMode() {
+    const char* val = getenv("TVM_THREAD_POOL_MODE");
+    if (!val) {
+        return threading::PoolMode::kThreadLocal;
+    }
+    return ParsePoolMode(val);
+}
+
+/*! \brief The process-wide pool mode, read when a launch picks its pool. */
+std::atomic<threading::PoolMode>& PoolModeStore() {
+    static std::atomic<threading::PoolMode> mode{GetDefaultPoolMode()};
+    return mode;
+}
+
+threading::BarrierMode ParseBarrierMode(const std::string& name) {
+    if (name == "flat") return threading::BarrierMode::kFlat;
+    if (name == "tree") return threading::BarrierMode::kTree;
+    LOG(FATAL) << "Unknown parallel barrier '" << name << "', expected one of 'flat', 'tree'";
+    return threading::BarrierMode::kTree;
+}
+
+threading::BarrierMode GetDefaultBarrierMode() {
+    const char* val = getenv("TVM_THREAD_POOL_BARRIER");
+    if (!val) {
+        return threading::BarrierMode::kTree;
+    }
+    return ParseBarrierMode(val);
+}
+
+/*! \brief The barrier used by launches, read when a launch starts. */
+std::atomic<threading::BarrierMode>& BarrierModeStore() {
+    static std::atomic<threading::BarrierMode> mode{GetDefaultBarrierMode()};
+    return mode;
+}
+
+/*!
+ * \brief Run a launch on the calling thread as a single task.
+ *  Used when there is a single worker or when the launch is nested
+ *  inside another one, so the number of threads stays bounded.
+ */
+int RunInline(FTVMParallelLambda flambda, void* cdata) {
+    TVMParallelGroupEnv env;
+    env.num_task = 1;
+    // a barrier of a single task returns at once and never looks at the handle
+    env.sync_handle = nullptr;
+    return (*flambda)(0, &env, cdata) == 0 ? 0 : -1;
+}
+
+/*! \brief Pop the error raised by a failed parallel lambda, if any. */
+std::string MoveRaisedErrorMessage() {
+    TVMFFIObjectHandle handle = nullptr;
+    TVMFFIErrorMoveFromRaised(&handle);
+    if (handle == nullptr) {
+        return "parallel lambda returned non-zero without raising an error";
+    }
+    ffi::Error err(ffi::details::ObjectUnsafe::ObjectPtrFromOwned<ffi::Object>(
+            static_cast<TVMFFIObject*>(handle)));
+    return err.kind() + ": " + err.message();
+}
+
+/*! \brief Hint the CPU that the caller is in a spin-wait loop. */
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+/*!
+ * \brief Tiered backoff for waits that are expected to be short.
+ *
+ *  The first rounds issue an exponentially growing burst of CPU pause
+ *  instructions, which keeps the core hot without hammering the polled
+ *  cache line. Once the bursts are exhausted every round yields the time slice.
+ */
+class Backoff {
+public:
+    void Pause() {
+        if (round_ < kPauseRounds) {
+            for (int i = 0; i < (1 << round_); ++i) {
+                CpuRelax();
+            }
+            ++round_;
+        } else {
+            threading::Yield();
+            ++yields_;
+        }
+    }
+
+    /*! \return The number of rounds that yielded the time slice. */
+    int yields() const { return yields_; }
+
+private:
+    // up to 64 pause instructions in the last burst
+    static constexpr int kPauseRounds = 7;
+    int round_{0};
+    int yields_{0};
+};
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "futex words must be plain 32-bit integers");
+
+/*!
+ * \brief Park the calling thread while *addr still holds expected.
+ *  May return spuriously, callers re-check their condition in a loop.
+ */
+inline void FutexWait(std::atomic<int32_t>* addr, int32_t expected) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<int32_t*>(addr), FUTEX_WAIT_PRIVATE, expected, nullptr,
+            nullptr, 0);
+#else
+    addr->wait(expected);
+#endif
+}
+
+/*! \brief Wake up to count threads parked on addr. */
+inline void FutexWake(std::atomic<int32_t>* addr, int count) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<int32_t*>(addr), FUTEX_WAKE_PRIVATE, count, nullptr,
+            nullptr, 0);
+#else
+    if (count == 1) {
+        addr->notify_one();
+    } else {
+        addr->notify_all();
+    }
+#endif
+}
+
+/*!
+ * \brief Predict how long a worker should spin before it parks.
+ *
+ *  Keeps an exponential moving average of the observed gap between a worker
+ *  becoming idle and its next task arriving. Back-to-back small launches keep
+ *  the average short and the worker spins through the gap; sparse launches
+ *  push it past kMaxSpinNs and the worker parks almost immediately.
+ */
+class SpinPredictor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /*! \return The spin budget in nanoseconds for the next wait. */
+    int64_t BudgetNs() const {
+        if (avg_gap_ns_ > kMaxSpinNs) return kMinSpinNs;
+        return std::min<int64_t>(2 * avg_gap_ns_ + kMinSpinNs, kMaxSpinNs);
+    }
+
+    /*! \brief Record the gap of a finished wait. */
+    void Record(int64_t gap_ns) { avg_gap_ns_ += (gap_ns - avg_gap_ns_) / 8; }
+
+    static int64_t ElapsedNs(Clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+private:
+    static constexpr int64_t kMinSpinNs = 2000;
+    static constexpr int64_t kMaxSpinNs = 200000;
+    int64_t avg_gap_ns_{kMaxSpinNs / 4};
+};
 }// namespace
 
 // stride in the page, fit to cache line.
 constexpr int kSyncStride = 64 / sizeof(std::atomic<int>);
+// offset of the parked-waiter count in a task's cache line of the page.
+constexpr int kSyncParkedOffset = 1;
+// yield rounds a barrier waiter spends before it parks on the futex.
+constexpr int kBarrierYieldRounds = 64;
+
+/*!
+ * \brief The barrier of one launch, TVMParallelGroupEnv::sync_handle points to it.
+ *
+ *  BarrierMode::kFlat: every task bumps its own padded counter and then waits
+ *  for the counters of all other tasks, O(n^2) cache line transfers per barrier.
+ *
+ *  BarrierMode::kTree: a combining tree with fan-in kFanIn. Task i of a static
+ *  launch runs on worker i and the workers are pinned following the sorted core
+ *  order of ThreadGroup, so every leaf groups neighbouring cores of the same
+ *  cluster. The last task to arrive at a node carries the arrival upwards, the
+ *  one reaching the root releases everybody by bumping a single epoch word.
+ */
+class ParallelBarrier {
+public:
+    ~ParallelBarrier() { delete[] counters_; }
+
+    /*!
+   * \brief Prepare the barrier for a launch of num_task tasks.
+   * \param num_task The number of tasks of the launch.
+   * \param mode The barrier algorithm to use.
+   */
+    void Reset(int num_task, threading::BarrierMode mode) {
+        enabled_ = true;
+        used_.store(false, std::memory_order_relaxed);
+        mode_ = mode;
+        if (mode == threading::BarrierMode::kFlat) {
+            if (num_task > capacity_) {
+                delete[] counters_;
+                counters_ = new std::atomic<int32_t>[num_task * kSyncStride];
+                capacity_ = num_task;
+            }
+            for (int i = 0; i < num_task; ++i) {
+                counters_[i * kSyncStride].store(0, std::memory_order_relaxed);
+                counters_[i * kSyncStride + kSyncParkedOffset].store(0, std::memory_order_relaxed);
+            }
+        } else {
+            if (num_task != tree_tasks_) {
+                BuildTree(num_task);
+            }
+            for (int i = 0; i < num_nodes_; ++i) {
+                nodes_[i].count.store(0, std::memory_order_relaxed);
+            }
+            parked_.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /*!
+   * \brief Prepare the barrier for a launch whose tasks may share a thread,
+   *  only recording whether a task tries to wait.
+   */
+    void Disable() {
+        enabled_ = false;
+        used_.store(false, std::memory_order_relaxed);
+    }
+
+    /*!
+   * \brief Block until all tasks of the launch reached the barrier.
+   * \param task_id The id of the calling task.
+   * \param num_task The number of tasks of the launch.
+   * \return false if the barrier is disabled for the launch.
+   */
+    bool Wait(int task_id, int num_task) {
+        if (!used_.load(std::memory_order_relaxed)) {
+            used_.store(true, std::memory_order_relaxed);
+        }
+        if (!enabled_) return false;
+        if (num_task <= 1) return true;
+        if (mode_ == threading::BarrierMode::kFlat) {
+            WaitFlat(task_id, num_task);
+        } else {
+            WaitTree(task_id);
+        }
+        return true;
+    }
+
+    /*! \return Whether a task of the last launch called Wait, read after the launch finished. */
+    bool used() const { return used_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int kFanIn = 4;
+
+    struct alignas(kL1CacheBytes) TreeNode {
+        // arrivals of the current episode
+        std::atomic<int32_t> count{0};
+        // arrivals expected, fan-in of the node
+        int32_t fan_in{0};
+        // index of the parent node, -1 for the root
+        int32_t parent{-1};
+    };
+
+    void BuildTree(int num_task) {
+        int total = 0;
+        for (int width = num_task; width > 1 || total == 0;) {
+            width = (width + kFanIn - 1) / kFanIn;
+            total += width;
+        }
+        nodes_.reset(new TreeNode[total]);
+        num_nodes_ = total;
+        tree_tasks_ = num_task;
+        // level 0 holds the leaves, task t arrives at leaf t / kFanIn
+        int begin = 0;
+        int prev_begin = -1;
+        int prev_width = num_task;
+        while (true) {
+            int width = (prev_width + kFanIn - 1) / kFanIn;
+            for (int j = 0; j < width; ++j) {
+                nodes_[begin + j].fan_in = std::min(kFanIn, prev_width - j * kFanIn);
+            }
+            if (prev_begin >= 0) {
+                for (int c = 0; c < prev_width; ++c) {
+                    nodes_[prev_begin + c].parent = begin + c / kFanIn;
+                }
+            }
+            if (width == 1) break;
+            prev_begin = begin;
+            prev_width = width;
+            begin += width;
+        }
+    }
+
+    void WaitFlat(int task_id, int num_task) {
+        // Parking pairs a seq_cst increment of the counter with a seq_cst read of the
+        // parked count, so either the arriving task sees the waiter or the waiter sees
+        // the new counter value and the futex wait returns at once.
+        std::atomic<int32_t>* self = counters_ + task_id * kSyncStride;
+        int old_counter = self->fetch_add(1);
+        if (self[kSyncParkedOffset].load() != 0) {
+            FutexWake(self, INT_MAX);
+        }
+        for (int i = 0; i < num_task; ++i) {
+            if (i == task_id) continue;
+            std::atomic<int32_t>* other = counters_ + i * kSyncStride;
+            Backoff backoff;
+            int val;
+            while ((val = other->load(std::memory_order_relaxed)) <= old_counter) {
+                if (backoff.yields() < kBarrierYieldRounds) {
+                    backoff.Pause();
+                    continue;
+                }
+                other[kSyncParkedOffset].fetch_add(1);
+                if ((val = other->load()) <= old_counter) {
+                    FutexWait(other, val);
+                }
+                other[kSyncParkedOffset].fetch_sub(1);
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+
+    void WaitTree(int task_id) {
+        // read the epoch before arriving, the release may happen right after
+        const int32_t epoch = epoch_.load(std::memory_order_acquire);
+        int node = task_id / kFanIn;
+        while (true) {
+            TreeNode& n = nodes_[node];
+            if (n.count.fetch_add(1, std::memory_order_acq_rel) + 1 < n.fan_in) break;
+            // nobody touches this node again before the release below
+            n.count.store(0, std::memory_order_relaxed);
+            if (n.parent < 0) {
+                epoch_.fetch_add(1);
+                if (parked_.load() != 0) {
+                    FutexWake(&epoch_, INT_MAX);
+                }
+                return;
+            }
+            node = n.parent;
+        }
+        Backoff backoff;
+        while (epoch_.load(std::memory_order_acquire) == epoch) {
+            if (backoff.yields() < kBarrierYieldRounds) {
+                backoff.Pause();
+                continue;
+            }
+            parked_.fetch_add(1);
+            if (epoch_.load() == epoch) {
+                FutexWait(&epoch_, epoch);
+            }
+            parked_.fetch_sub(1);
+        }
+    }
+
+    threading::BarrierMode mode_{threading::BarrierMode::kTree};
+    // false for work-stealing launches
+    bool enabled_{true};
+    // whether a task called Wait during the launch
+    std::atomic<bool> used_{false};
+    // the counter page of the flat barrier
+    std::atomic<int32_t>* counters_{nullptr};
+    // the number of tasks the counter page can serve
+    int capacity_{0};
+    // nodes of the combining tree, leaves first and the root last
+    std::unique_ptr<TreeNode[]> nodes_;
+    int num_nodes_{0};
+    // the number of tasks the tree was built for
+    int tree_tasks_{0};
+    // release word of the tree barrier, read-shared by the waiters
+    alignas(kL1CacheBytes) std::atomic<int32_t> epoch_{0};
+    // waiters parked on epoch_
+    std::atomic<int32_t> parked_{0};
+};
 
 /*!
  * \brief Thread local main environment.
@@ -58,24 +471,22 @@ public:
         // reshape
         if (static_cast<size_t>(num_task) > par_errors_.size()) {
             par_errors_.resize(num_task + 1);
-            if (need_sync) {
-                delete[] sync_counter_;
-                sync_counter_ = new std::atomic<int>[num_task * kSyncStride];
-            }
         }
         if (need_sync) {
-            for (int i = 0; i < num_task; ++i) {
-                sync_counter_[i * kSyncStride].store(0, std::memory_order_relaxed);
-            }
-            this->env.sync_handle = sync_counter_;
+            barrier_.Reset(num_task, threading::GetBarrierMode());
         } else {
-            this->env.sync_handle = nullptr;
+            barrier_.Disable();
         }
+        this->env.sync_handle = &barrier_;
     }
-    ~ParallelLauncher() { delete[] sync_counter_; }
     // Wait n jobs to finish
     int WaitForJobs() {
+        Backoff backoff;
         while (num_pending_.load() != 0) {
+            backoff.Pause();
+        }
+        // stealers may still be scanning the deques after the last job finished.
+        while (num_active_stealers_.load(std::memory_order_acquire) != 0) {
             threading::Yield();
         }
         if (!has_error_.load()) return 0;
@@ -86,17 +497,43 @@ public:
                 par_errors_[i].clear();
             }
         }
-        TVMAPISetLastError(os.str().c_str());
+        TVMFFIErrorSetRaisedFromCStr("RuntimeError", os.str().c_str());
         return -1;
     }
     // Signal that one job has finished.
     void SignalJobError(int task_id) {
-        num_pending_.fetch_sub(1);
-        par_errors_[task_id] = TVMGetLastError();
+        par_errors_[task_id] = MoveRaisedErrorMessage();
         has_error_.store(true);
+        num_pending_.fetch_sub(1);
     }
     // Signal that one job has finished.
     void SignalJobFinish() { num_pending_.fetch_sub(1); }
+    // Run one task of the launch and record its completion.
+    void RunTask(int task_id) {
+        if ((*flambda)(task_id, &env, cdata) == 0) {
+            SignalJobFinish();
+        } else {
+            SignalJobError(task_id);
+        }
+    }
+    // Whether some jobs of the current launch have not finished yet.
+    bool HasPendingJobs() const { return num_pending_.load(std::memory_order_acquire) != 0; }
+    // Register a worker that takes part in stealing for the current launch.
+    void EnterStealing() { num_active_stealers_.fetch_add(1, std::memory_order_relaxed); }
+    // Unregister a worker once it no longer touches the launch.
+    void LeaveStealing() { num_active_stealers_.fetch_sub(1, std::memory_order_release); }
+    // Whether a task of the finished launch reached TVMBackendParallelBarrier.
+    bool UsedBarrier() const { return barrier_.used(); }
+    // Whether a finished static launch of flambda never reached the barrier.
+    bool StealSafe(FTVMParallelLambda flambda) const { return steal_safe_.count(flambda) != 0; }
+    // Record whether flambda may run on the work-stealing engine.
+    void SetStealSafe(FTVMParallelLambda flambda, bool safe) {
+        if (safe) {
+            steal_safe_.insert(flambda);
+        } else {
+            steal_safe_.erase(flambda);
+        }
+    }
     // Get thread local version of the store.
     static ParallelLauncher* ThreadLocal() { return dmlc::ThreadLocalStore<ParallelLauncher>::Get(); }
     // The parallel lambda
@@ -106,18 +543,24 @@ public:
     // Local env
     TVMParallelGroupEnv env;
     // Whether this thread is worker of the pool.
-    // used to prevent recursive launch.
+    // used to run nested launches inline.
     bool is_worker{false};
+    // Whether this thread is currently driving a launch.
+    bool is_launching{false};
 
 private:
     // The pending jobs.
     std::atomic<int32_t> num_pending_;
+    // The workers that are still running the steal loop of this launch.
+    std::atomic<int32_t> num_active_stealers_{0};
     // Whether error has been countered.
     std::atomic<bool> has_error_;
-    // The counter page.
-    std::atomic<int32_t>* sync_counter_{nullptr};
+    // The barrier of the launch.
+    ParallelBarrier barrier_;
     // The error message
     std::vector<std::string> par_errors_;
+    // lambdas launched from this thread that are known not to use the barrier
+    std::unordered_set<FTVMParallelLambda> steal_safe_;
 };
 
 /*! \brief Lock-free single-producer-single-consumer queue for each thread */
@@ -142,31 +585,44 @@ public:
             threading::Yield();
         }
         if (pending_.fetch_add(1) == -1) {
-            std::unique_lock<std::mutex> lock(mutex_);
-            cv_.notify_one();
+            FutexWake(&pending_, 1);
         }
     }
 
     /*!
-   * \brief Pop a task out of the queue and condition wait if no tasks.
+   * \brief Pop a task out of the queue and park on a futex if no tasks.
+   *
+   *  The worker first spins with a tiered backoff for a window predicted from
+   *  the gaps it has observed between launches, then parks.
    * \param output The pointer to the task to be dequeued.
-   * \param spin_count The number of iterations to spin before sleep.
+   * \param spin_count Upper bound on the number of spin rounds before parking.
    * \return Whether pop is successful (true) or we need to exit now (false).
    */
     bool Pop(Task* output, uint32_t spin_count) {
-        // Busy wait a bit when the queue is empty.
-        // If a new task comes to the queue quickly, this wait avoid the worker from sleeping.
-        // The default spin count is set by following the typical omp convention
-        for (uint32_t i = 0; i < spin_count && pending_.load() == 0; ++i) {
-            threading::Yield();
+        const bool idle = pending_.load(std::memory_order_acquire) <= 0;
+        const auto start = SpinPredictor::Clock::now();
+        if (idle) {
+            // Busy wait a bit when the queue is empty.
+            // If a new task comes to the queue quickly, this wait avoid the worker from sleeping.
+            const int64_t budget_ns = predictor_.BudgetNs();
+            Backoff backoff;
+            for (uint32_t i = 0; i < spin_count && pending_.load(std::memory_order_relaxed) == 0; ++i) {
+                backoff.Pause();
+                if ((i & 15) == 15 && SpinPredictor::ElapsedNs(start) > budget_ns) break;
+            }
         }
         if (pending_.fetch_sub(1) == 0) {
-            std::unique_lock<std::mutex> lock(mutex_);
-            cv_.wait(lock, [this] { return pending_.load() >= 0 || exit_now_.load(); });
+            int32_t val;
+            while ((val = pending_.load(std::memory_order_acquire)) < 0) {
+                FutexWait(&pending_, val);
+            }
         }
         if (exit_now_.load(std::memory_order_relaxed)) {
             return false;
         }
+        if (idle) {
+            predictor_.Record(SpinPredictor::ElapsedNs(start));
+        }
         const uint32_t head = head_.load(std::memory_order_relaxed);
         // sanity check if the queue is empty
         CHECK(tail_.load(std::memory_order_acquire) != head);
@@ -179,9 +635,10 @@ public:
    * \brief Signal to terminate the worker.
    */
     void SignalForKill() {
-        std::lock_guard<std::mutex> lock(mutex_);
         exit_now_.store(true);
-        cv_.notify_all();
+        // bump the futex word so a worker about to park observes the change
+        pending_.fetch_add(1);
+        FutexWake(&pending_, INT_MAX);
     }
 
 protected:
@@ -221,17 +678,186 @@ protected:
     std::atomic<uint32_t> tail_;
 
     cache_line_pad_t pad3_;
-    // pending tasks in the queue
-    std::atomic<int8_t> pending_{0};
+    // pending tasks in the queue, -1 when the consumer is parked on it
+    std::atomic<int32_t> pending_{0};
 
     cache_line_pad_t pad4_;
     // signal for exit now
     std::atomic<bool> exit_now_{false};
 
-    // internal mutex
-    std::mutex mutex_;
-    // cv for consumer
-    std::condition_variable cv_;
+    // spin window of the consumer, only touched by the consumer
+    SpinPredictor predictor_;
+};
+
+/*!
+ * \brief Chase-Lev work-stealing deque of task ranges.
+ *
+ *  The owner thread pushes and pops at the bottom, other workers steal
+ *  from the top. Memory orderings follow Le et al., "Correct and Efficient
+ *  Work-Stealing for Weak Memory Models" (PPoPP'13).
+ *
+ *  Ranges are only produced by recursive halving, so the number of items a
+ *  worker holds is bounded by twice the depth of the split tree and a fixed
+ *  ring is sufficient.
+ */
+class StealDeque {
+public:
+    /*! \brief A half-open range [begin, end) of task ids. */
+    struct Range {
+        int32_t begin;
+        int32_t end;
+    };
+
+    StealDeque() : buffer_(new std::atomic<uint64_t>[kRingSize]), top_(0), bottom_(0) {}
+
+    ~StealDeque() { delete[] buffer_; }
+
+    /*!
+   * \brief Push a range at the bottom. Only called by the owner.
+   * \param range The range to be pushed.
+   * \return Whether there was room for the range.
+   */
+    bool Push(Range range) {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_acquire);
+        if (b - t >= kRingSize) return false;
+        buffer_[b & kRingMask].store(Pack(range), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /*!
+   * \brief Pop the most recently pushed range. Only called by the owner.
+   * \param output The popped range.
+   * \return Whether a range was popped.
+   */
+    bool Pop(Range* output) {
+        const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        *output = Unpack(buffer_[b & kRingMask].load(std::memory_order_relaxed));
+        if (t == b) {
+            // last item, race against the thieves.
+            bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /*!
+   * \brief Steal the oldest range. Can be called by any thread.
+   * \param output The stolen range.
+   * \return Whether a range was stolen.
+   */
+    bool Steal(Range* output) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return false;
+        Range range = Unpack(buffer_[t & kRingMask].load(std::memory_order_relaxed));
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return false;
+        }
+        *output = range;
+        return true;
+    }
+
+private:
+    static uint64_t Pack(Range range) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(range.begin)) << 32 |
+               static_cast<uint32_t>(range.end);
+    }
+
+    static Range Unpack(uint64_t value) {
+        return Range{static_cast<int32_t>(value >> 32), static_cast<int32_t>(value & 0xFFFFFFFF)};
+    }
+
+    typedef char cache_line_pad_t[kL1CacheBytes];
+    // capacity of the ring, must be a power of two
+    static constexpr const int64_t kRingSize = 128;
+    static constexpr const int64_t kRingMask = kRingSize - 1;
+    // packed ranges
+    std::atomic<uint64_t>* const buffer_;
+
+    cache_line_pad_t pad0_;
+    // steal end, advanced by thieves
+    std::atomic<int64_t> top_;
+
+    cache_line_pad_t pad1_;
+    // owner end
+    std::atomic<int64_t> bottom_;
+    cache_line_pad_t pad2_;
+};
+
+/*!
+ * \brief FIFO ticket lock that admits launches to a pool one at a time.
+ *
+ *  Launchers are admitted in arrival order, so a thread that keeps issuing
+ *  small launches cannot starve another one waiting on the shared pool.
+ *  A waiter spins briefly, then parks on now_serving_ until its turn comes,
+ *  since the launch ahead of it may run for a long time.
+ */
+class AdmissionQueue {
+public:
+    void Enter() {
+        const int32_t ticket = next_ticket_.fetch_add(1, std::memory_order_relaxed);
+        Backoff backoff;
+        int32_t serving;
+        while ((serving = now_serving_.load(std::memory_order_acquire)) != ticket) {
+            if (backoff.yields() < kAdmissionYieldRounds) {
+                backoff.Pause();
+                continue;
+            }
+            parked_.fetch_add(1);
+            FutexWait(&now_serving_, serving);
+            parked_.fetch_sub(1);
+        }
+    }
+
+    void Leave() {
+        now_serving_.fetch_add(1);
+        // every parked waiter re-checks, only the next ticket goes on
+        if (parked_.load() != 0) {
+            FutexWake(&now_serving_, INT_MAX);
+        }
+    }
+
+    /*! \brief RAII helper of Enter/Leave. */
+    class Guard {
+    public:
+        explicit Guard(AdmissionQueue* queue) : queue_(queue) { queue_->Enter(); }
+        ~Guard() { Release(); }
+
+        /*! \brief Admit the next launcher before the guard goes out of scope. */
+        void Release() {
+            if (queue_ == nullptr) return;
+            queue_->Leave();
+            queue_ = nullptr;
+        }
+
+    private:
+        AdmissionQueue* queue_;
+    };
+
+private:
+    // yield rounds a waiter spends before it parks on the futex.
+    static constexpr int kAdmissionYieldRounds = 8;
+
+    typedef char cache_line_pad_t[kL1CacheBytes];
+    std::atomic<int32_t> next_ticket_{0};
+    cache_line_pad_t pad0_;
+    std::atomic<int32_t> now_serving_{0};
+    // waiters parked on now_serving_
+    std::atomic<int32_t> parked_{0};
 };
 
 // The thread pool
@@ -253,19 +879,93 @@ public:
     }
 
     void Reset() {
+        AdmissionQueue::Guard guard(&admission_);
+        WaitForLaunches();
         for (std::unique_ptr<SpscTaskQueue>& q: queues_) {
             q->SignalForKill();
         }
         // Destroy threads before we destory the shared queue, otherwise we segfault on MacOS
         threads_.reset();
         queues_.clear();
+        deques_.clear();
         Init();
     }
 
     int Launch(FTVMParallelLambda flambda, void* cdata, int num_task, int need_sync) {
         ParallelLauncher* launcher = ParallelLauncher::ThreadLocal();
-        CHECK(!launcher->is_worker)
-                << "Cannot launch parallel job inside worker, consider fuse then parallel";
+        if (launcher->is_worker || launcher->is_launching) {
+            // Nested launch: the workers are busy with the enclosing job,
+            // run on the calling thread instead of spawning more threads.
+            return RunInline(flambda, cdata);
+        }
+        // cleared however the launch ends, so later launches do not all run inline
+        struct LaunchingScope {
+            explicit LaunchingScope(ParallelLauncher* launcher) : launcher(launcher) {
+                launcher->is_launching = true;
+            }
+            ~LaunchingScope() { launcher->is_launching = false; }
+            ParallelLauncher* launcher;
+        } launching(launcher);
+        AdmissionQueue::Guard guard(&admission_);
+        if (threading::GetSchedulerMode() == threading::SchedulerMode::kWorkStealing) {
+            // Tasks that share a thread cannot meet at a barrier. A lambda runs on
+            // the static engine until a launch showed that it does not use one,
+            // launches with more tasks than workers cannot use one anyway.
+            if (need_sync == 0 || num_task > num_workers_used_ || launcher->StealSafe(flambda)) {
+                // the deques are shared by the whole pool, the launch keeps it to itself
+                int res = LaunchWorkStealing(launcher, flambda, cdata, num_task);
+                if (launcher->UsedBarrier()) launcher->SetStealSafe(flambda, false);
+                return res;
+            }
+            int res = LaunchStatic(launcher, flambda, cdata, num_task, need_sync, &guard);
+            if (res == 0 && !launcher->UsedBarrier()) launcher->SetStealSafe(flambda, true);
+            return res;
+        }
+        return LaunchStatic(launcher, flambda, cdata, num_task, need_sync, &guard);
+    }
+
+    /*!
+   * \brief Get the pool used by launches from the calling thread.
+   *
+   *  In PoolMode::kThreadLocal every launching thread owns a pool. In
+   *  PoolMode::kShared all launchers share one process-wide pool, so
+   *  the number of worker threads stays bounded by MaxConcurrency.
+   */
+    static ThreadPool* Current() {
+        if (threading::GetPoolMode() == threading::PoolMode::kShared) {
+            return Shared();
+        }
+        return ThreadLocal();
+    }
+
+    static ThreadPool* ThreadLocal() { return dmlc::ThreadLocalStore<ThreadPool>::Get(); }
+
+    static ThreadPool* Shared() {
+        // NOTE: explicitly use new to avoid exit-time destruction of the workers
+        static auto* inst = new ThreadPool();
+        return inst;
+    }
+
+    void UpdateWorkerConfiguration(threading::ThreadGroup::AffinityMode mode, int nthreads,
+                                   const std::vector<unsigned int>& cpus) {
+        AdmissionQueue::Guard guard(&admission_);
+        WaitForLaunches();
+        // this will also reset the affinity of the ThreadGroup
+        // may use less than the MaxConcurrency number of workers
+        num_workers_used_ = threads_->Configure(mode, nthreads, exclude_worker0_, cpus);
+        // if MaxConcurrency restricted the number of workers (e.g., due to
+        // hyperthreading), respect the restriction
+        num_workers_used_ = std::min(num_workers_, num_workers_used_);
+    }
+
+    int32_t NumThreads() const { return num_workers_used_; }
+
+private:
+    // Launch on the static engine, one task per worker.
+    // The next launcher is admitted once every task is queued, its tasks
+    // queue up behind these on the workers.
+    int LaunchStatic(ParallelLauncher* launcher, FTVMParallelLambda flambda, void* cdata,
+                     int num_task, int need_sync, AdmissionQueue::Guard* guard) {
         if (num_task == 0) {
             num_task = num_workers_used_;
         }
@@ -282,39 +982,123 @@ public:
             tsk.task_id = i;
             queues_[i]->Push(tsk);
         }
+        in_flight_.fetch_add(1);
+        guard->Release();
         // use the main thread to run task 0
         if (exclude_worker0_) {
-            TVMParallelGroupEnv* penv = &(tsk.launcher->env);
-            if ((*tsk.launcher->flambda)(0, penv, cdata) == 0) {
-                tsk.launcher->SignalJobFinish();
-            } else {
-                tsk.launcher->SignalJobError(tsk.task_id);
-            }
+            launcher->RunTask(0);
         }
         int res = launcher->WaitForJobs();
+        in_flight_.fetch_sub(1, std::memory_order_release);
         return res;
     }
 
-    static ThreadPool* ThreadLocal() { return dmlc::ThreadLocalStore<ThreadPool>::Get(); }
+    // Wait for the static launches that left the admission queue, under the admission guard.
+    void WaitForLaunches() {
+        while (in_flight_.load(std::memory_order_acquire) != 0) {
+            threading::Yield();
+        }
+    }
 
-    void UpdateWorkerConfiguration(threading::ThreadGroup::AffinityMode mode, int nthreads,
-                                   const std::vector<unsigned int>& cpus) {
-        // this will also reset the affinity of the ThreadGroup
-        // may use less than the MaxConcurrency number of workers
-        num_workers_used_ = threads_->Configure(mode, nthreads, exclude_worker0_, cpus);
-        // if MaxConcurrency restricted the number of workers (e.g., due to
-        // hyperthreading), respect the restriction
-        num_workers_used_ = std::min(num_workers_, num_workers_used_);
+    // Task id sent through the SpscTaskQueue to ask a worker to join the steal loop.
+    static constexpr int32_t kStealTaskId = -1;
+
+    /*!
+   * \brief Launch on the work-stealing engine.
+   *
+   *  The task range is dealt out in equal blocks to the participating workers'
+   *  deques. Every worker splits its range recursively, keeps the lower half
+   *  and exposes the upper half for stealing, so a slow core or an expensive
+   *  task only delays the tasks it actually runs.
+   *
+   * \note Tasks of one launch may run one after another on the same thread,
+   *  hence TVMBackendParallelBarrier fails with an error in its tasks.
+   */
+    int LaunchWorkStealing(ParallelLauncher* launcher, FTVMParallelLambda flambda, void* cdata,
+                           int num_task) {
+        if (num_task == 0) {
+            // over-decompose so that idle workers have something to steal
+            static int split_factor = GetStealSplitFactor();
+            num_task = num_workers_used_ * split_factor;
+        }
+        launcher->Init(flambda, cdata, num_task, false);
+        int num_participants = std::min(num_workers_used_, num_task);
+        // Deal the initial ranges. Participants are parked, so it is safe to push
+        // into their deques from here; the queue push below publishes the ranges.
+        int64_t step = (num_task + num_participants - 1) / num_participants;
+        for (int i = 0; i < num_participants; ++i) {
+            int32_t begin = static_cast<int32_t>(std::min<int64_t>(step * i, num_task));
+            int32_t end = static_cast<int32_t>(std::min<int64_t>(begin + step, num_task));
+            if (begin < end) {
+                CHECK(deques_[i]->Push(StealDeque::Range{begin, end}));
+            }
+        }
+        num_stealers_ = num_participants;
+        SpscTaskQueue::Task tsk;
+        tsk.launcher = launcher;
+        tsk.task_id = kStealTaskId;
+        for (int i = exclude_worker0_; i < num_participants; ++i) {
+            launcher->EnterStealing();
+            queues_[i]->Push(tsk);
+        }
+        if (exclude_worker0_) {
+            launcher->EnterStealing();
+            RunStealLoop(0, launcher);
+        }
+        return launcher->WaitForJobs();
     }
 
-    int32_t NumThreads() const { return num_workers_used_; }
+    /*!
+   * \brief Execute tasks of the current launch until none is left.
+   * \param worker_id The id of the calling worker, which owns deques_[worker_id].
+   * \param launcher The launcher of the current job.
+   */
+    void RunStealLoop(int worker_id, ParallelLauncher* launcher) {
+        StealDeque* own = deques_[worker_id].get();
+        uint32_t seed = static_cast<uint32_t>(worker_id) * 2654435761U + 1;
+        StealDeque::Range range;
+        while (launcher->HasPendingJobs()) {
+            if (own->Pop(&range) || TrySteal(worker_id, &seed, &range)) {
+                // keep the lower half, expose the upper half to thieves.
+                while (range.end - range.begin > 1) {
+                    int32_t mid = range.begin + (range.end - range.begin) / 2;
+                    if (!own->Push(StealDeque::Range{mid, range.end})) break;
+                    range.end = mid;
+                }
+                for (int32_t task_id = range.begin; task_id < range.end; ++task_id) {
+                    launcher->RunTask(task_id);
+                }
+            } else {
+                threading::Yield();
+            }
+        }
+        launcher->LeaveStealing();
+    }
+
+    // Try to steal from the other participants, starting at a random victim.
+    bool TrySteal(int worker_id, uint32_t* seed, StealDeque::Range* range) {
+        int num_stealers = num_stealers_;
+        if (num_stealers <= 1) return false;
+        // xorshift32
+        *seed ^= *seed << 13;
+        *seed ^= *seed >> 17;
+        *seed ^= *seed << 5;
+        int start = static_cast<int>(*seed % num_stealers);
+        for (int i = 0; i < num_stealers; ++i) {
+            int victim = (start + i) % num_stealers;
+            if (victim != worker_id && deques_[victim]->Steal(range)) {
+                return true;
+            }
+        }
+        return false;
+    }
 
-private:
     // Shared initialization code
     void Init() {
         for (int i = 0; i < num_workers_; ++i) {
             // The SpscTaskQueue only hosts ONE item at a time
             queues_.emplace_back(std::make_unique<SpscTaskQueue>());
+            deques_.emplace_back(std::make_unique<StealDeque>());
         }
         threads_ = std::make_unique<threading::ThreadGroup>(
                 num_workers_, [this](int worker_id) { this->RunWorker(worker_id); },
@@ -333,12 +1117,10 @@ private:
         static size_t spin_count = GetSpinCount();
         while (queue->Pop(&task, spin_count)) {
             CHECK(task.launcher != nullptr);
-            TVMParallelGroupEnv* penv = &(task.launcher->env);
-            void* cdata = task.launcher->cdata;
-            if ((*task.launcher->flambda)(task.task_id, penv, cdata) == 0) {
-                task.launcher->SignalJobFinish();
+            if (task.task_id == kStealTaskId) {
+                RunStealLoop(worker_id, task.launcher);
             } else {
-                task.launcher->SignalJobError(task.task_id);
+                task.launcher->RunTask(task.task_id);
             }
         }
     }
@@ -348,30 +1130,46 @@ private:
     // if or not to exclude worker 0 and use main to run task 0
     bool exclude_worker0_{true};
     std::vector<std::unique_ptr<SpscTaskQueue>> queues_;
+    // per worker deques of the work-stealing engine
+    std::vector<std::unique_ptr<StealDeque>> deques_;
+    // number of workers taking part in the current work-stealing launch
+    int num_stealers_{0};
     std::unique_ptr<threading::ThreadGroup> threads_;
+    // admits one launch at a time, matters when the pool is shared
+    AdmissionQueue admission_;
+    // static launches whose tasks may still run on the workers
+    std::atomic<int32_t> in_flight_{0};
 };
 
 /*!
  * \brief args[0] is the AffinityMode, args[1] is the number of threads.
  *  args2 is a list of CPUs which is used to set the CPU affinity.
  */
-TVM_REGISTER_GLOBAL("runtime.config_threadpool").set_body([](TVMArgs args, TVMRetValue* rv) {
-    threading::ThreadGroup::AffinityMode mode =
-            static_cast<threading::ThreadGroup::AffinityMode>(static_cast<int>(args[0]));
-    int nthreads(args[1]);
-    std::vector<unsigned int> cpus;
-    if (args.num_args >= 3) {
-        Array<String> cpu_array(args[2]);
-        for (auto cpu: cpu_array) {
-            CHECK(IsNumber(cpu)) << "The CPU core information '" << cpu << "' is not a number.";
-            cpus.push_back(std::stoi(cpu));
-        }
-    }
-    threading::Configure(mode, nthreads, cpus);
-});
-
-TVM_REGISTER_GLOBAL("runtime.NumThreads").set_body_typed([]() -> int32_t {
-    return threading::NumThreads();
+TVM_FFI_STATIC_INIT_BLOCK({
+    namespace refl = litetvm::ffi::reflection;
+    refl::GlobalDef()
+            .def_packed("runtime.config_threadpool",
+                        [](ffi::PackedArgs args, ffi::Any* rv) {
+                            threading::ThreadGroup::AffinityMode mode =
+                                    static_cast<threading::ThreadGroup::AffinityMode>(args[0].cast<int>());
+                            int nthreads = args[1].cast<int>();
+                            std::vector<unsigned int> cpus;
+                            if (args.size() >= 3) {
+                                auto cpu_array = args[2].cast<ffi::Array<ffi::String>>();
+                                for (auto cpu: cpu_array) {
+                                    CHECK(IsNumber(cpu)) << "The CPU core information '" << cpu << "' is not a number.";
+                                    cpus.push_back(std::stoi(cpu));
+                                }
+                            }
+                            threading::Configure(mode, nthreads, cpus);
+                        })
+            .def("runtime.config_threadpool_scheduler",
+                 [](const ffi::String& name) { threading::SetSchedulerMode(ParseSchedulerMode(name)); })
+            .def("runtime.config_threadpool_mode",
+                 [](const ffi::String& name) { threading::SetPoolMode(ParsePoolMode(name)); })
+            .def("runtime.config_threadpool_barrier",
+                 [](const ffi::String& name) { threading::SetBarrierMode(ParseBarrierMode(name)); })
+            .def("runtime.NumThreads", []() -> int32_t { return threading::NumThreads(); });
 });
 
 namespace threading {
@@ -387,7 +1185,7 @@ namespace threading {
  * \param cpus A list of CPU ids to set 'cpu affinity'.
  *
  */
-static void ConfigureOMP(tvm::runtime::threading::ThreadGroup::AffinityMode mode, int nthreads,
+static void ConfigureOMP(ThreadGroup::AffinityMode mode, int nthreads,
                          const std::vector<unsigned int>& cpus) {
 #if defined(__linux__) || defined(__ANDROID__)
     const int num_workers = MaxConcurrency();
@@ -426,7 +1224,7 @@ static void ConfigureOMP(tvm::runtime::threading::ThreadGroup::AffinityMode mode
 
 #endif
 
-void ResetThreadPool() { ThreadPool::ThreadLocal()->Reset(); }
+void ResetThreadPool() { ThreadPool::Current()->Reset(); }
 /*!
  * \brief configure the CPU id affinity
  * \param mode The preferred CPU type (1 = big, -1 = little, -2 = kSpecifyOneCorePerThread,
@@ -435,16 +1233,30 @@ void ResetThreadPool() { ThreadPool::ThreadLocal()->Reset(); }
  * \param cpus cpus A list of CPUs is used to set the 'cpu affinity' for the worker threads.
  *
  */
-LITETVM_API void Configure(ThreadGroup::AffinityMode mode, int nthreads,
-                           std::vector<unsigned int> cpus) {
+TVM_DLL void Configure(ThreadGroup::AffinityMode mode, int nthreads,
+                       std::vector<unsigned int> cpus) {
     SetMaxConcurrency(cpus.size());
+    // kNuma turns it on once the workers are pinned
+    if (mode != ThreadGroup::kNuma) DisableNumaPlacement();
 #if !TVM_THREADPOOL_USE_OPENMP
-    ThreadPool::ThreadLocal()->UpdateWorkerConfiguration(mode, nthreads, cpus);
+    ThreadPool::Current()->UpdateWorkerConfiguration(mode, nthreads, cpus);
 #else
     ConfigureOMP(mode, nthreads, cpus);
 #endif
 }
-int32_t NumThreads() { return ThreadPool::ThreadLocal()->NumThreads(); }
+int32_t NumThreads() { return ThreadPool::Current()->NumThreads(); }
+
+void SetPoolMode(PoolMode mode) { PoolModeStore().store(mode); }
+
+PoolMode GetPoolMode() { return PoolModeStore().load(std::memory_order_relaxed); }
+
+void SetBarrierMode(BarrierMode mode) { BarrierModeStore().store(mode); }
+
+BarrierMode GetBarrierMode() { return BarrierModeStore().load(std::memory_order_relaxed); }
+
+void SetSchedulerMode(SchedulerMode mode) { SchedulerModeStore().store(mode); }
+
+SchedulerMode GetSchedulerMode() { return SchedulerModeStore().load(std::memory_order_relaxed); }
 }// namespace threading
 
 }// namespace runtime
@@ -453,16 +1265,11 @@ int32_t NumThreads() { return ThreadPool::ThreadLocal()->NumThreads(); }
 int TVMBackendParallelLaunch(FTVMParallelLambda flambda, void* cdata, int num_task) {
     int num_workers = litetvm::runtime::threading::MaxConcurrency();
     if (num_workers == 1) {
-        std::atomic<int32_t> sync_counter{0};
-        TVMParallelGroupEnv env;
-        env.num_task = 1;
-        env.sync_handle = &sync_counter;
-        (*flambda)(0, &env, cdata);
-        return 0;
+        return litetvm::runtime::RunInline(flambda, cdata);
     }
 
 #if !TVM_THREADPOOL_USE_OPENMP
-    int res = litetvm::runtime::ThreadPool::ThreadLocal()->Launch(flambda, cdata, num_task, 1);
+    int res = litetvm::runtime::ThreadPool::Current()->Launch(flambda, cdata, num_task, 1);
     return res;
 #else
     if (num_task == 0) num_task = num_workers;
@@ -481,18 +1288,16 @@ int TVMBackendParallelBarrier(int task_id, TVMParallelGroupEnv* penv) {
 #if TVM_THREADPOOL_USE_OPENMP
 #pragma omp barrier
 #else
-    using litetvm::runtime::kSyncStride;
-    int num_task = penv->num_task;
-    std::atomic<int>* sync_counter = reinterpret_cast<std::atomic<int>*>(penv->sync_handle);
-    int old_counter = sync_counter[task_id * kSyncStride].fetch_add(1, std::memory_order_release);
-    for (int i = 0; i < num_task; ++i) {
-        if (i != task_id) {
-            while (sync_counter[i * kSyncStride].load(std::memory_order_relaxed) <= old_counter) {
-                litetvm::runtime::threading::Yield();
-            }
-        }
+    auto* barrier = static_cast<litetvm::runtime::ParallelBarrier*>(penv->sync_handle);
+    // inline runs have a single task and no barrier
+    if (barrier == nullptr) return 0;
+    if (!barrier->Wait(task_id, penv->num_task)) {
+        // later launches of the lambda go to the static engine
+        TVMFFIErrorSetRaisedFromCStr("RuntimeError",
+                                     "TVMBackendParallelBarrier is not supported by a work-stealing "
+                                     "launch, tasks of one launch may run on the same thread");
+        return -1;
     }
-    std::atomic_thread_fence(std::memory_order_acquire);
 #endif
     return 0;
 }
\ No newline at end of file
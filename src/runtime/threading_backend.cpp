@@ -17,6 +17,7 @@
 #else
 #endif
 #if defined(__linux__)
+#include <dirent.h>
 #include <sched.h>
 #endif
 #if defined(__hexagon__)
@@ -30,6 +31,8 @@ extern "C" {
 #define HEXAGON_STACK_ALIGNMENT 32
 #endif
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <thread>
 #define CURRENT_THREAD_HANDLE (static_cast<std::thread::native_handle_type>(0))
 
@@ -125,6 +128,108 @@ void SetThreadAffinity(std::thread::native_handle_type thread,
 #endif
 }
 
+/*!
+ * \brief The NUMA nodes of the system and the CPUs that belong to them.
+ *
+ *  Read once from /sys/devices/system/node. Systems without that directory are
+ *  treated as a single node holding every CPU.
+ */
+class NumaTopology {
+public:
+    static const NumaTopology& Global() {
+        // NOTE: explicitly use new to avoid exit-time destruction of global state
+        static auto* inst = new NumaTopology();
+        return *inst;
+    }
+
+    /*! \return The CPUs of every node, nodes in ascending id order. */
+    const std::vector<std::vector<unsigned int>>& node_cpus() const { return node_cpus_; }
+
+    /*! \return The index of the node that holds cpu, 0 when unknown. */
+    int NodeOf(unsigned int cpu) const {
+        return cpu < cpu_node_.size() && cpu_node_[cpu] >= 0 ? cpu_node_[cpu] : 0;
+    }
+
+    /*! \return All CPUs, node by node. */
+    std::vector<unsigned int> NodeOrder() const {
+        std::vector<unsigned int> order;
+        for (const auto& cpus: node_cpus_) {
+            order.insert(order.end(), cpus.begin(), cpus.end());
+        }
+        return order;
+    }
+
+private:
+    NumaTopology() {
+#if defined(__linux__)
+        std::vector<int> node_ids;
+        if (DIR* dir = opendir("/sys/devices/system/node")) {
+            while (dirent* entry = readdir(dir)) {
+                int id;
+                if (std::strncmp(entry->d_name, "node", 4) == 0 &&
+                    sscanf(entry->d_name + 4, "%d", &id) == 1) {
+                    node_ids.push_back(id);
+                }
+            }
+            closedir(dir);
+        }
+        std::sort(node_ids.begin(), node_ids.end());
+        for (int id: node_ids) {
+            std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string cpulist;
+            if (!std::getline(ifs, cpulist)) continue;
+            std::vector<unsigned int> cpus = ParseCpuList(cpulist);
+            // memory-only nodes have no CPUs to place workers on
+            if (!cpus.empty()) node_cpus_.push_back(std::move(cpus));
+        }
+#endif
+        if (node_cpus_.empty()) {
+            std::vector<unsigned int> cpus;
+            for (unsigned int i = 0; i < std::max(std::thread::hardware_concurrency(), 1u); ++i) {
+                cpus.push_back(i);
+            }
+            node_cpus_.push_back(std::move(cpus));
+        }
+        for (size_t node = 0; node < node_cpus_.size(); ++node) {
+            for (unsigned int cpu: node_cpus_[node]) {
+                if (cpu >= cpu_node_.size()) cpu_node_.resize(cpu + 1, -1);
+                cpu_node_[cpu] = static_cast<int>(node);
+            }
+        }
+    }
+
+    // Parse the kernel cpulist format, e.g. "0-3,8-11".
+    static std::vector<unsigned int> ParseCpuList(const std::string& cpulist) {
+        std::vector<unsigned int> cpus;
+        std::istringstream is(cpulist);
+        std::string range;
+        while (std::getline(is, range, ',')) {
+            unsigned int lo, hi;
+            int n = sscanf(range.c_str(), "%u-%u", &lo, &hi);
+            if (n < 1) continue;
+            if (n == 1) hi = lo;
+            for (unsigned int cpu = lo; cpu <= hi; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    std::vector<std::vector<unsigned int>> node_cpus_;
+    std::vector<int> cpu_node_;
+};
+
+// whether a pool configured with kNuma pinned its workers node by node
+std::atomic<bool> numa_placement{false};
+// bumped each time numa_placement changes
+std::atomic<uint64_t> numa_placement_generation{0};
+
+void SetNumaPlacement(bool enabled) {
+    if (numa_placement.exchange(enabled) != enabled) {
+        numa_placement_generation.fetch_add(1, std::memory_order_release);
+    }
+}
+
 thread_local int max_concurrency = 0;
 class ThreadGroup::Impl {
 public:
@@ -159,6 +264,9 @@ public:
                 num_workers_used = cpus.size();
                 sorted_order_ = cpus;
                 break;
+            case kNuma:
+                num_workers_used = threading::MaxConcurrency();
+                break;
             default:
                 // use default
                 num_workers_used = threading::MaxConcurrency();
@@ -172,7 +280,9 @@ public:
         // and N/2 physical cores this will set affinity to the first N/2 logical
         // ones.
         num_workers_used = std::min(num_workers_, num_workers_used);
-        SetAffinity(exclude_worker0, mode);
+        bool pinned = SetAffinity(exclude_worker0, mode);
+        // other modes leave it alone, every new pool is first configured with kBig
+        if (mode == kNuma) SetNumaPlacement(pinned);
         return num_workers_used;
     }
 
@@ -180,14 +290,16 @@ private:
     // bind worker threads to disjoint cores
     // if worker 0 is offloaded to main, i.e. exclude_worker0 is true,
     // the main thread is bound to core 0.
-    void SetAffinity(bool exclude_worker0, AffinityMode mode) {
+    // return whether the workers were pinned to single cores
+    bool SetAffinity(bool exclude_worker0, AffinityMode mode) {
 #ifndef __hexagon__
         const char* val = getenv("TVM_BIND_THREADS");
         if (val != nullptr && atoi(val) != 1) {
-            return;
+            return false;
         }
+        const std::vector<unsigned int>& order = Order(mode);
         // Do not set affinity if there are more workers than found cores and mode is not kSpecify*.
-        if (sorted_order_.size() < static_cast<unsigned int>(num_workers_)) {
+        if (order.size() < static_cast<unsigned int>(num_workers_)) {
             switch (mode) {
                 // When the mode is kSpecifyOneCorePerThread or kSpecifyThreadShareAllCore, we should
                 // let the threads share all the cpu cores.
@@ -202,13 +314,15 @@ private:
                     break;
                 case kLittle:
                 case kBig:
+                case kNuma:
                 default:
                     LOG(WARNING) << "The thread affinity cannot be set when the number of workers"
                                  << "is larger than the number of available cores in the system.";
                     break;
             }
+            return false;
         } else {
-            CHECK_GE(sorted_order_.size(), num_workers_);
+            CHECK_GE(order.size(), num_workers_);
             switch (mode) {
                 case kSpecifyThreadShareAllCore:
                     for (unsigned i = 0; i < threads_.size(); ++i) {
@@ -218,13 +332,14 @@ private:
                 case kLittle:
                 case kBig:
                 case kSpecifyOneCorePerThread:
+                case kNuma:
                     for (unsigned i = 0; i < threads_.size(); ++i) {
                         bool reverse = mode == kLittle;
                         unsigned core_id;
                         if (reverse) {
-                            core_id = sorted_order_[sorted_order_.size() - (i + exclude_worker0) - 1];
+                            core_id = order[order.size() - (i + exclude_worker0) - 1];
                         } else {
-                            core_id = sorted_order_[i + exclude_worker0];
+                            core_id = order[i + exclude_worker0];
                         }
                         SetThreadAffinity(threads_[i].native_handle(), {core_id});
                     }
@@ -237,7 +352,10 @@ private:
                 // See the comment inside SetMainThreadFullCpuAffinity function to get more detail.
                 SetMainThreadFullCpuAffinity(mode);
             }
+            return mode != kSpecifyThreadShareAllCore;
         }
+#else
+        return false;
 #endif// __hexagon__
     }
 
@@ -266,12 +384,19 @@ private:
                     ids.push_back(sorted_order_[sorted_order_.size() - i - 1]);
                 }
                 break;
-            case kBig:
+            case kBig: {
                 int num_cpu_workers = std::min(MaxConcurrency(), big_count_);
                 for (int i = 0; i < num_cpu_workers; ++i) {
                     ids.push_back(sorted_order_[i]);
                 }
                 break;
+            }
+            case kNuma: {
+                // keep the main thread on the node of worker 0
+                const NumaTopology& topo = NumaTopology::Global();
+                ids = topo.node_cpus()[topo.NodeOf(Order(mode)[0])];
+                break;
+            }
         }
         SetThreadAffinity(thread, ids);
 #endif// __hexagon__
@@ -281,6 +406,15 @@ private:
         SetThreadFullCpuAffinity(CURRENT_THREAD_HANDLE, mode);
     }
 
+    // The order in which workers are placed on the cores.
+    const std::vector<unsigned int>& Order(AffinityMode mode) {
+        if (mode == kNuma) {
+            if (numa_order_.empty()) numa_order_ = NumaTopology::Global().NodeOrder();
+            return numa_order_;
+        }
+        return sorted_order_;
+    }
+
     void InitSortedOrder() {
         unsigned int threads = std::thread::hardware_concurrency();
 #if defined(__hexagon__)
@@ -339,6 +473,8 @@ private:
     std::vector<std::thread> threads_;
 #endif
     std::vector<unsigned int> sorted_order_;
+    // all cores, node by node, used by kNuma
+    std::vector<unsigned int> numa_order_;
     int big_count_ = 0;
     int little_count_ = 0;
 };
@@ -365,6 +501,22 @@ void Yield() {
 #endif
 }
 
+int NumaNodeCount() { return static_cast<int>(NumaTopology::Global().node_cpus().size()); }
+
+int CurrentNumaNode() {
+#if defined(__linux__)
+    int cpu = sched_getcpu();
+    if (cpu >= 0) return NumaTopology::Global().NodeOf(cpu);
+#endif
+    return 0;
+}
+
+bool NumaPlacementEnabled() { return numa_placement.load(std::memory_order_relaxed); }
+
+void DisableNumaPlacement() { SetNumaPlacement(false); }
+
+uint64_t NumaPlacementGeneration() { return numa_placement_generation.load(std::memory_order_acquire); }
+
 /*!
  * \brief Set the maximum number of available cores.
  */
@@ -0,0 +1,222 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+
+#include "workspace_planner.h"
+#include "ffi/reflection/registry.h"
+#include "runtime/logging.h"
+
+#include <dmlc/thread_local.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <numeric>
+
+namespace litetvm {
+namespace runtime {
+
+namespace {
+
+bool GetDefaultEnabled() {
+    const char* val = getenv("TVM_WORKSPACE_PLAN");
+    return val != nullptr && atoi(val) != 0;
+}
+
+std::atomic<bool>& EnabledStore() {
+    static std::atomic<bool> enabled{GetDefaultEnabled()};
+    return enabled;
+}
+
+Device CPUDevice() {
+    Device dev;
+    dev.device_type = kDLCPU;
+    dev.device_id = 0;
+    return dev;
+}
+
+}// namespace
+
+WorkspacePlan WorkspacePlan::Compute(const std::vector<WorkspaceInterval>& intervals,
+                                     size_t alignment) {
+    WorkspacePlan plan;
+    plan.offsets.assign(intervals.size(), 0);
+    std::vector<size_t> order(intervals.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return intervals[a].size > intervals[b].size; });
+    // placed requests as (offset, end) pairs, checked for overlap in time
+    std::vector<size_t> placed;
+    std::vector<std::pair<size_t, size_t>> conflicts;
+    for (size_t i: order) {
+        const WorkspaceInterval& cur = intervals[i];
+        size_t size = (cur.size + alignment - 1) / alignment * alignment;
+        conflicts.clear();
+        for (size_t j: placed) {
+            const WorkspaceInterval& other = intervals[j];
+            if (cur.alloc_event < other.free_event && other.alloc_event < cur.free_event) {
+                size_t other_size = (other.size + alignment - 1) / alignment * alignment;
+                conflicts.emplace_back(plan.offsets[j], plan.offsets[j] + other_size);
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end());
+        // lowest gap that fits
+        size_t offset = 0;
+        for (const auto& c: conflicts) {
+            if (offset + size <= c.first) break;
+            offset = std::max(offset, c.second);
+        }
+        plan.offsets[i] = offset;
+        plan.arena_size = std::max(plan.arena_size, offset + size);
+        placed.push_back(i);
+    }
+    return plan;
+}
+
+WorkspacePlanner::~WorkspacePlanner() {
+    for (auto& kv: functions_) {
+        ReleaseArena(&kv.second);
+    }
+}
+
+WorkspacePlanner* WorkspacePlanner::ThreadLocal() {
+    return dmlc::ThreadLocalStore<WorkspacePlanner>::Get();
+}
+
+void WorkspacePlanner::SetEnabled(bool enabled) { EnabledStore().store(enabled); }
+
+bool WorkspacePlanner::Enabled() { return EnabledStore().load(std::memory_order_relaxed); }
+
+int WorkspacePlanner::num_planned() const {
+    int n = 0;
+    for (const auto& kv: functions_) {
+        if (kv.second.state == State::kReplaying) ++n;
+    }
+    return n;
+}
+
+void WorkspacePlanner::Enter(Session* session, const void* key) {
+    Function* func = &functions_[key];
+    session->parent = current_;
+    current_ = session;
+    if (func->state == State::kDisabled) return;
+    for (Session* s = session->parent; s != nullptr; s = s->parent) {
+        // recursive call, the outer call owns the trace
+        if (s->func == func) return;
+    }
+    session->func = func;
+}
+
+void WorkspacePlanner::Exit(Session* session) {
+    current_ = session->parent;
+    Function* func = session->func;
+    if (func == nullptr) return;
+    if (func->state == State::kRecording) {
+        if (!session->live.empty()) {
+            // workspace escaped the call, there is no fixed trace to replay
+            func->state = State::kDisabled;
+            return;
+        }
+        func->num_events = session->cursor;
+        func->plan = WorkspacePlan::Compute(func->intervals, kTempAllocaAlignment);
+        if (func->plan.arena_size != 0) {
+            DLDataType type;
+            type.code = static_cast<uint8_t>(DLDataTypeCode::kDLUInt);
+            type.bits = 8;
+            type.lanes = 1;
+            func->arena = static_cast<char*>(DeviceAPI::Get(CPUDevice())->AllocDataSpace(
+                    CPUDevice(), func->plan.arena_size, kTempAllocaAlignment, type));
+            DeviceAPI::RecordAlloc(CPUDevice(), func->plan.arena_size, DeviceMemoryKind::kWorkspace);
+        }
+        func->state = State::kReplaying;
+    } else if (func->state == State::kReplaying) {
+        if (session->diverged || session->cursor != func->num_events || !session->live.empty()) {
+            Diverge(session);
+        }
+    } else if (session->diverged && session->live.empty()) {
+        // diverged while arena blocks were in use, they have all been freed since
+        ReleaseArena(func);
+    }
+}
+
+void WorkspacePlanner::Diverge(Session* session) {
+    session->diverged = true;
+    session->func->state = State::kDisabled;
+    // the function is not planned again, keep the arena only while blocks of it are live
+    if (session->live.empty()) ReleaseArena(session->func);
+}
+
+void WorkspacePlanner::ReleaseArena(Function* func) {
+    if (func->arena == nullptr) return;
+    DeviceAPI::Get(CPUDevice())->FreeDataSpace(CPUDevice(), func->arena);
+    DeviceAPI::RecordFree(CPUDevice(), func->plan.arena_size, DeviceMemoryKind::kWorkspace);
+    func->arena = nullptr;
+}
+
+void* WorkspacePlanner::Alloc(Device dev, size_t size) {
+    Session* session = current_;
+    if (session->func == nullptr || dev.device_type != kDLCPU) return nullptr;
+    Function* func = session->func;
+    if (func->state == State::kRecording) {
+        void* ptr = DeviceAPI::Get(dev)->AllocWorkspace(dev, size);
+        int index = static_cast<int>(func->intervals.size());
+        func->intervals.push_back({size, session->cursor++, -1});
+        session->live[ptr] = index;
+        return ptr;
+    }
+    if (session->diverged) return nullptr;
+    int index = session->next_alloc;
+    if (index >= static_cast<int>(func->intervals.size()) ||
+        func->intervals[index].alloc_event != session->cursor || func->intervals[index].size != size) {
+        Diverge(session);
+        return nullptr;
+    }
+    ++session->next_alloc;
+    ++session->cursor;
+    void* ptr = func->arena + func->plan.offsets[index];
+    session->live[ptr] = index;
+    return ptr;
+}
+
+bool WorkspacePlanner::Free(Device dev, void* ptr) {
+    Session* session = current_;
+    if (session->func == nullptr || dev.device_type != kDLCPU) return false;
+    auto it = session->live.find(ptr);
+    if (it == session->live.end()) return false;
+    int index = it->second;
+    session->live.erase(it);
+    Function* func = session->func;
+    if (func->state == State::kRecording) {
+        func->intervals[index].free_event = session->cursor++;
+        DeviceAPI::Get(dev)->FreeWorkspace(dev, ptr);
+        return true;
+    }
+    // arena memory, nothing to release
+    if (!session->diverged) {
+        if (func->intervals[index].free_event != session->cursor) {
+            Diverge(session);
+        } else {
+            ++session->cursor;
+        }
+    }
+    return true;
+}
+
+WorkspacePlanScope::WorkspacePlanScope(const void* key) {
+    if (!WorkspacePlanner::Enabled()) return;
+    planner_ = WorkspacePlanner::ThreadLocal();
+    planner_->Enter(&session_, key);
+}
+
+WorkspacePlanScope::~WorkspacePlanScope() {
+    if (planner_ != nullptr) planner_->Exit(&session_);
+}
+
+TVM_FFI_STATIC_INIT_BLOCK({
+    namespace refl = litetvm::ffi::reflection;
+    refl::GlobalDef().def("runtime.config_workspace_plan",
+                          [](bool enabled) { WorkspacePlanner::SetEnabled(enabled); });
+});
+
+}// namespace runtime
+}// namespace litetvm
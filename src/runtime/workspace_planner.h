@@ -0,0 +1,155 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+
+#ifndef LITETVM_RUNTIME_WORKSPACE_PLANNER_H
+#define LITETVM_RUNTIME_WORKSPACE_PLANNER_H
+
+#include "runtime/device_api.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace litetvm {
+namespace runtime {
+
+/*!
+ * \brief One workspace request of a recorded trace.
+ *
+ *  Events are numbered by their position in the trace, a request is live
+ *  in [alloc_event, free_event).
+ */
+struct WorkspaceInterval {
+    /*! \brief The requested size in bytes. */
+    size_t size;
+    /*! \brief Index of the allocation event in the trace. */
+    int alloc_event;
+    /*! \brief Index of the matching free event in the trace. */
+    int free_event;
+};
+
+/*!
+ * \brief Fixed placement of the workspace requests of one function in a single arena.
+ */
+struct WorkspacePlan {
+    /*! \brief Byte offset of every request in the arena, in allocation order. */
+    std::vector<size_t> offsets;
+    /*! \brief Total size of the arena. */
+    size_t arena_size{0};
+
+    /*!
+   * \brief Plan an arena for a recorded trace by interval colouring.
+   *
+   *  Requests are placed largest first at the lowest offset that does not
+   *  overlap any already placed request that is live at the same time.
+   * \param intervals The requests in allocation order.
+   * \param alignment Alignment of every offset.
+   * \return The plan.
+   */
+    static WorkspacePlan Compute(const std::vector<WorkspaceInterval>& intervals, size_t alignment);
+};
+
+/*!
+ * \brief Record-and-replay workspace planner of the calling thread.
+ *
+ *  The first call of a function inside a WorkspacePlanScope records the
+ *  TVMBackendAllocWorkspace/TVMBackendFreeWorkspace trace of its CPU
+ *  workspace. When the call returns the trace is planned into one arena.
+ *  Later calls replay the trace and are served from the arena at fixed
+ *  offsets without touching the workspace pool. A call whose trace diverges
+ *  from the recording falls back to the pool, and the function is not
+ *  planned again.
+ *
+ *  Requests made on other threads, e.g. inside parallel tasks, always go to
+ *  the pool.
+ */
+class WorkspacePlanner {
+public:
+    ~WorkspacePlanner();
+
+    /*! \return The planner of the calling thread. */
+    static WorkspacePlanner* ThreadLocal();
+
+    /*! \brief Enable or disable planning for subsequent scopes, see TVM_WORKSPACE_PLAN. */
+    static void SetEnabled(bool enabled);
+    /*! \return Whether planning is enabled. */
+    static bool Enabled();
+
+    /*!
+   * \brief Serve an allocation from the active plan.
+   * \return The pointer, nullptr when the request must go to the pool.
+   */
+    void* Alloc(Device dev, size_t size);
+    /*!
+   * \brief Release an allocation made inside the active scope.
+   * \return Whether the pointer was handled, false when it belongs to the pool.
+   */
+    bool Free(Device dev, void* ptr);
+
+    /*! \return Whether a scope is active on this thread. */
+    bool active() const { return current_ != nullptr; }
+
+    /*! \return The number of functions with a ready plan, for testing. */
+    int num_planned() const;
+
+private:
+    friend class WorkspacePlanScope;
+
+    enum class State : int { kRecording, kReplaying, kDisabled };
+
+    /*! \brief Everything known about one function. */
+    struct Function {
+        State state{State::kRecording};
+        // alloc sizes and free events of the recording, in trace order
+        std::vector<WorkspaceInterval> intervals;
+        int num_events{0};
+        WorkspacePlan plan;
+        // the arena of the plan, owned by the CPU device, released once the function diverges
+        char* arena{nullptr};
+    };
+
+    /*! \brief One active scope. */
+    struct Session {
+        // nullptr for a pass-through scope
+        Function* func{nullptr};
+        Session* parent{nullptr};
+        // position in the trace
+        int cursor{0};
+        int next_alloc{0};
+        // set once the call stopped following the recording
+        bool diverged{false};
+        // pointers handed out by this call, to their request index
+        std::unordered_map<void*, int> live;
+    };
+
+    void Enter(Session* session, const void* key);
+    void Exit(Session* session);
+    void Diverge(Session* session);
+    // Give the arena of func back to the device.
+    void ReleaseArena(Function* func);
+
+    std::unordered_map<const void*, Function> functions_;
+    Session* current_{nullptr};
+};
+
+/*!
+ * \brief RAII scope that runs one call of a function under the workspace planner.
+ *  Does nothing when planning is disabled.
+ */
+class WorkspacePlanScope {
+public:
+    /*! \param key Identifies the function, e.g. its address. */
+    explicit WorkspacePlanScope(const void* key);
+    ~WorkspacePlanScope();
+
+private:
+    WorkspacePlanner* planner_{nullptr};
+    WorkspacePlanner::Session session_;
+};
+
+}// namespace runtime
+}// namespace litetvm
+
+#endif//LITETVM_RUNTIME_WORKSPACE_PLANNER_H
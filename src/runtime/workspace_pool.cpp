@@ -4,126 +4,284 @@
 
 #include "workspace_pool.h"
 
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
 #include <memory>
+#include <unordered_map>
 
 namespace litetvm::runtime {
 
 // page size, 4KB
 constexpr size_t kWorkspacePageSize = 4 << 10;
+// smallest block requested from the device, small requests share a chunk
+constexpr size_t kWorkspaceMinChunkSize = 64 << 10;
 
+size_t GetDefaultHighWaterMark() {
+    const char* val = getenv("TVM_WORKSPACE_HIGH_WATER_MARK");
+    if (!val) {
+        return 0;
+    }
+    return static_cast<size_t>(strtoull(val, nullptr, 10));
+}
 
+/*!
+ * \brief Workspace pool of one device, a two-level segregated fit allocator.
+ *
+ *  Memory is requested from the device in chunks and carved into page aligned
+ *  blocks. Free blocks are kept in size classes: the first level is the power
+ *  of two of the size in pages, the second level splits it into kSLCount
+ *  linear ranges. Two bitmaps locate the first non-empty class that is
+ *  guaranteed to fit, so allocation is O(1). Live blocks are found by address
+ *  in a hash map. Freed blocks are merged with their free neighbours in the
+ *  same chunk.
+ *
+ *  Chunks that become entirely free are kept until the memory held by the
+ *  pool exceeds the high-water mark, 0 meaning keep everything.
+ */
 class WorkspacePool::Pool {
 public:
-    // constructor
-    Pool() {
-        // safe guard header on each list.
-        Entry e;
-        e.data = nullptr;
-        e.size = 0;
-        free_list_.push_back(e);
-        allocated_.push_back(e);
+    Pool(Device dev, DeviceAPI* device, size_t high_water_mark)
+        : dev_(dev), device_(device), high_water_mark_(high_water_mark) {}
+
+    ~Pool() {
+        for (Block* b: spare_blocks_) delete b;
     }
+
     // allocate from pool
-    void* Alloc(Device dev, DeviceAPI* device, size_t nbytes) {
+    void* Alloc(size_t nbytes) {
         // Allocate align to page.
         nbytes = (nbytes + (kWorkspacePageSize - 1)) / kWorkspacePageSize * kWorkspacePageSize;
         if (nbytes == 0) nbytes = kWorkspacePageSize;
-        Entry e;
-        DLDataType type;
-        type.code = static_cast<uint8_t>(DLDataTypeCode::kDLUInt);
-        type.bits = 8;
-        type.lanes = 1;
-        if (free_list_.size() == 2) {
-            e = free_list_.back();
-            free_list_.pop_back();
-            if (e.size < nbytes) {
-                // resize the page
-                device->FreeDataSpace(dev, e.data);
-                e.data = device->AllocDataSpace(dev, nbytes, kTempAllocaAlignment, type);
-                e.size = nbytes;
-            }
-        } else if (free_list_.size() == 1) {
-            e.data = device->AllocDataSpace(dev, nbytes, kTempAllocaAlignment, type);
-            e.size = nbytes;
+        Block* b = FindFree(nbytes);
+        if (b == nullptr) {
+            b = NewChunk(nbytes);
         } else {
-            if (free_list_.back().size >= nbytes) {
-                // find smallest fit
-                auto it = free_list_.end() - 2;
-                for (; it->size >= nbytes; --it) {
-                }
-                e = *(it + 1);
-                free_list_.erase(it + 1);
-            } else {
-                // resize the page
-                e = free_list_.back();
-                free_list_.pop_back();
-                device->FreeDataSpace(dev, e.data);
-                e.data = device->AllocDataSpace(dev, nbytes, kTempAllocaAlignment, type);
-                e.size = nbytes;
-            }
+            RemoveFree(b);
         }
-        allocated_.push_back(e);
-        return e.data;
+        if (b->size - nbytes >= kWorkspacePageSize) {
+            // give the tail back to the pool
+            Block* rest = NewBlock();
+            rest->data = b->data + nbytes;
+            rest->size = b->size - nbytes;
+            rest->prev_phys = b;
+            rest->next_phys = b->next_phys;
+            if (b->next_phys) b->next_phys->prev_phys = rest;
+            b->next_phys = rest;
+            b->size = nbytes;
+            InsertFree(rest);
+        }
+        allocated_.emplace(b->data, b);
+        return b->data;
     }
+
     // free resource back to pool
     void Free(void* data) {
-        Entry e;
-        if (allocated_.back().data == data) {
-            // quick path, last allocated.
-            e = allocated_.back();
-            allocated_.pop_back();
-        } else {
-            int index = static_cast<int>(allocated_.size()) - 2;
-            for (; index > 0 && allocated_[index].data != data; --index) {
-            }
-            CHECK_GT(index, 0) << "trying to free things that has not been allocated";
-            e = allocated_[index];
-            allocated_.erase(allocated_.begin() + index);
+        CHECK(TryFree(data)) << "trying to free things that has not been allocated";
+    }
+
+    // free data if this pool allocated it
+    bool TryFree(void* data) {
+        auto it = allocated_.find(data);
+        if (it == allocated_.end()) return false;
+        Block* b = it->second;
+        allocated_.erase(it);
+        if (Block* next = b->next_phys; next && next->free) {
+            RemoveFree(next);
+            b->size += next->size;
+            Unlink(next);
         }
-        if (free_list_.back().size < e.size) {
-            free_list_.push_back(e);
-        } else if (free_list_.size() == 2) {
-            free_list_.push_back(free_list_.back());
-            free_list_[1] = e;
-        } else {
-            size_t i = free_list_.size() - 1;
-            free_list_.resize(free_list_.size() + 1);
-            for (; e.size < free_list_[i].size; --i) {
-                free_list_[i + 1] = free_list_[i];
-            }
-            free_list_[i + 1] = e;
+        if (Block* prev = b->prev_phys; prev && prev->free) {
+            RemoveFree(prev);
+            prev->size += b->size;
+            Unlink(b);
+            b = prev;
         }
-    }
-    // Release all resources
-    void Release(Device dev, DeviceAPI* device) {
-        for (size_t i = 1; i < free_list_.size(); ++i) {
-            device->FreeDataSpace(dev, free_list_[i].data);
+        if (IsWholeChunk(b) && high_water_mark_ != 0 && reserved_bytes_ > high_water_mark_) {
+            ReleaseChunk(b);
+            return true;
         }
-        free_list_.clear();
+        InsertFree(b);
+        return true;
+    }
+
+    // Release all resources, chunks still holding live blocks are leaked
+    void Release() { ReleaseFreeChunks(0); }
+
+    void set_high_water_mark(size_t bytes) {
+        high_water_mark_ = bytes;
+        if (bytes != 0 && reserved_bytes_ > bytes) ReleaseFreeChunks(bytes);
     }
 
 private:
-    /*! \brief a single entry in the pool */
-    struct Entry {
-        void* data;
+    static constexpr int kSLLog2 = 2;
+    static constexpr int kSLCount = 1 << kSLLog2;
+    static constexpr int kFLCount = 64 - kSLLog2 + 1;
+    // blocks of the exact size class checked before moving to a larger class
+    static constexpr int kExactClassProbes = 4;
+
+    /*! \brief a block of a chunk, either live or free */
+    struct Block {
+        char* data;
         size_t size;
+        // neighbours in the chunk, by address
+        Block* prev_phys;
+        Block* next_phys;
+        // neighbours in the free list of the size class
+        Block* prev_free;
+        Block* next_free;
+        bool free;
     };
-    /*! \brief List of free items, sorted from small to big size */
-    std::vector<Entry> free_list_;
-    /*! \brief List of allocated items */
-    std::vector<Entry> allocated_;
+
+    // Size class of a block of the given number of pages.
+    static void Mapping(size_t pages, int* fl, int* sl) {
+        if (pages < static_cast<size_t>(kSLCount)) {
+            *fl = 0;
+            *sl = static_cast<int>(pages);
+        } else {
+            int msb = std::bit_width(pages) - 1;
+            *fl = msb - kSLLog2 + 1;
+            *sl = static_cast<int>((pages >> (msb - kSLLog2)) & (kSLCount - 1));
+        }
+    }
+
+    // First free block that holds nbytes, nullptr if none.
+    Block* FindFree(size_t nbytes) {
+        size_t pages = nbytes / kWorkspacePageSize;
+        int fl, sl;
+        Mapping(pages, &fl, &sl);
+        // A few blocks of the request's own class may fit as well. Checking
+        // them keeps repeated allocation patterns on the same blocks.
+        int budget = kExactClassProbes;
+        for (Block* b = heads_[fl][sl]; b != nullptr && budget-- > 0; b = b->next_free) {
+            if (b->size >= nbytes) return b;
+        }
+        if (pages >= static_cast<size_t>(kSLCount)) {
+            // round up to the next class so any block of the class fits
+            pages += (size_t{1} << (std::bit_width(pages) - 1 - kSLLog2)) - 1;
+        }
+        Mapping(pages, &fl, &sl);
+        if (fl >= kFLCount) return nullptr;
+        uint32_t sl_map = sl_bitmap_[fl] & (~0u << sl);
+        if (sl_map == 0) {
+            uint64_t fl_map = fl + 1 < 64 ? fl_bitmap_ & (~uint64_t{0} << (fl + 1)) : 0;
+            if (fl_map == 0) return nullptr;
+            fl = std::countr_zero(fl_map);
+            sl_map = sl_bitmap_[fl];
+        }
+        sl = std::countr_zero(sl_map);
+        return heads_[fl][sl];
+    }
+
+    void InsertFree(Block* b) {
+        int fl, sl;
+        Mapping(b->size / kWorkspacePageSize, &fl, &sl);
+        b->free = true;
+        b->prev_free = nullptr;
+        b->next_free = heads_[fl][sl];
+        if (b->next_free) b->next_free->prev_free = b;
+        heads_[fl][sl] = b;
+        fl_bitmap_ |= uint64_t{1} << fl;
+        sl_bitmap_[fl] |= 1u << sl;
+    }
+
+    void RemoveFree(Block* b) {
+        int fl, sl;
+        Mapping(b->size / kWorkspacePageSize, &fl, &sl);
+        if (b->prev_free) {
+            b->prev_free->next_free = b->next_free;
+        } else {
+            heads_[fl][sl] = b->next_free;
+        }
+        if (b->next_free) b->next_free->prev_free = b->prev_free;
+        if (heads_[fl][sl] == nullptr) {
+            sl_bitmap_[fl] &= ~(1u << sl);
+            if (sl_bitmap_[fl] == 0) fl_bitmap_ &= ~(uint64_t{1} << fl);
+        }
+        b->free = false;
+    }
+
+    // Drop b from its chunk after it was merged into its predecessor.
+    void Unlink(Block* b) {
+        if (b->prev_phys) b->prev_phys->next_phys = b->next_phys;
+        if (b->next_phys) b->next_phys->prev_phys = b->prev_phys;
+        spare_blocks_.push_back(b);
+    }
+
+    static bool IsWholeChunk(const Block* b) { return !b->prev_phys && !b->next_phys; }
+
+    Block* NewBlock() {
+        if (spare_blocks_.empty()) return new Block();
+        Block* b = spare_blocks_.back();
+        spare_blocks_.pop_back();
+        return b;
+    }
+
+    Block* NewChunk(size_t nbytes) {
+        size_t chunk_size = std::max(nbytes, kWorkspaceMinChunkSize);
+        if (high_water_mark_ != 0 && reserved_bytes_ + chunk_size > high_water_mark_) {
+            // make room with chunks nobody uses before asking for more
+            ReleaseFreeChunks(high_water_mark_ > chunk_size ? high_water_mark_ - chunk_size : 0);
+        }
+        DLDataType type;
+        type.code = static_cast<uint8_t>(DLDataTypeCode::kDLUInt);
+        type.bits = 8;
+        type.lanes = 1;
+        Block* b = NewBlock();
+        b->data = static_cast<char*>(device_->AllocDataSpace(dev_, chunk_size, kTempAllocaAlignment, type));
+        b->size = chunk_size;
+        b->prev_phys = b->next_phys = nullptr;
+        b->free = false;
+        reserved_bytes_ += chunk_size;
+        DeviceAPI::RecordAlloc(dev_, chunk_size, DeviceMemoryKind::kWorkspace);
+        return b;
+    }
+
+    void ReleaseChunk(Block* b) {
+        device_->FreeDataSpace(dev_, b->data);
+        DeviceAPI::RecordFree(dev_, b->size, DeviceMemoryKind::kWorkspace);
+        reserved_bytes_ -= b->size;
+        spare_blocks_.push_back(b);
+    }
+
+    // Return entirely free chunks to the device until at most target bytes are held.
+    void ReleaseFreeChunks(size_t target) {
+        for (int fl = kFLCount - 1; fl >= 0; --fl) {
+            for (int sl = kSLCount - 1; sl >= 0; --sl) {
+                for (Block* b = heads_[fl][sl]; b != nullptr && reserved_bytes_ > target;) {
+                    Block* next = b->next_free;
+                    if (IsWholeChunk(b)) {
+                        RemoveFree(b);
+                        ReleaseChunk(b);
+                    }
+                    b = next;
+                }
+            }
+        }
+    }
+
+    Device dev_;
+    DeviceAPI* device_;
+    // bytes held before entirely free chunks are given back, 0 for no limit
+    size_t high_water_mark_;
+    // bytes currently obtained from the device
+    size_t reserved_bytes_{0};
+    uint64_t fl_bitmap_{0};
+    uint32_t sl_bitmap_[kFLCount]{};
+    Block* heads_[kFLCount][kSLCount]{};
+    /*! \brief live blocks by address */
+    std::unordered_map<void*, Block*> allocated_;
+    /*! \brief recycled block descriptors */
+    std::vector<Block*> spare_blocks_;
 };
 
 WorkspacePool::WorkspacePool(DLDeviceType device_type, DeviceAPI* device)
-    : device_type_(device_type), device_(device) {}
+    : device_type_(device_type), device_(device), high_water_mark_(GetDefaultHighWaterMark()) {}
 
 WorkspacePool::~WorkspacePool() {
     for (size_t i = 0; i < array_.size(); ++i) {
         if (array_[i] != nullptr) {
-            Device dev;
-            dev.device_type = device_type_;
-            dev.device_id = static_cast<int>(i);
-            array_[i]->Release(dev, device_);
+            array_[i]->Release();
             delete array_[i];
         }
     }
@@ -134,9 +292,9 @@ void* WorkspacePool::AllocWorkspace(Device dev, size_t size) {
         array_.resize(dev.device_id + 1, nullptr);
     }
     if (array_[dev.device_id] == nullptr) {
-        array_[dev.device_id] = new Pool();
+        array_[dev.device_id] = new Pool(dev, device_, high_water_mark_);
     }
-    return array_[dev.device_id]->Alloc(dev, device_, size);
+    return array_[dev.device_id]->Alloc(size);
 }
 
 void WorkspacePool::FreeWorkspace(Device dev, void* ptr) {
@@ -144,4 +302,18 @@ void WorkspacePool::FreeWorkspace(Device dev, void* ptr) {
     array_[dev.device_id]->Free(ptr);
 }
 
-}// namespace litetvm::runtime
\ No newline at end of file
+bool WorkspacePool::TryFreeWorkspace(Device dev, void* ptr) {
+    if (static_cast<size_t>(dev.device_id) >= array_.size() || array_[dev.device_id] == nullptr) {
+        return false;
+    }
+    return array_[dev.device_id]->TryFree(ptr);
+}
+
+void WorkspacePool::SetHighWaterMark(size_t bytes) {
+    high_water_mark_ = bytes;
+    for (Pool* pool: array_) {
+        if (pool != nullptr) pool->set_high_water_mark(bytes);
+    }
+}
+
+}// namespace litetvm::runtime
@@ -21,6 +21,9 @@ namespace litetvm::runtime {
  *  - Only a few allocation will happen, and space will be released after use.
  *  - The release order is usually in reverse order of allocate
  *  - Repeative pattern of same allocations over different runs.
+ *
+ *  Each device pool is a segregated fit allocator with O(1) allocation and
+ *  coalescing of adjacent free blocks, see WorkspacePool::Pool.
  */
 class WorkspacePool {
 public:
@@ -45,6 +48,22 @@ public:
    * \param ptr The pointer to be freed.
    */
     void FreeWorkspace(Device dev, void* ptr);
+    /*!
+   * \brief Free temporal workspace if this pool allocated it.
+   *
+   * \param dev The device of allocation.
+   * \param ptr The pointer to be freed.
+   * \return Whether the pool held ptr.
+   */
+    bool TryFreeWorkspace(Device dev, void* ptr);
+    /*!
+   * \brief Set how much memory each device pool keeps once it is no longer used.
+   *
+   *  Chunks that become entirely free are returned to the device while the pool
+   *  holds more than this. The default is read from TVM_WORKSPACE_HIGH_WATER_MARK.
+   * \param bytes The high-water mark in bytes, 0 to keep everything.
+   */
+    void SetHighWaterMark(size_t bytes);
 
 private:
     class Pool;
@@ -54,6 +73,8 @@ private:
     DLDeviceType device_type_;
     /*! \brief The device API */
     DeviceAPI* device_;
+    /*! \brief high-water mark of the device pools, 0 for no limit */
+    size_t high_water_mark_;
 };
 
 }// namespace litetvm::runtime
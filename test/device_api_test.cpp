@@ -0,0 +1,274 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+#include "../src/runtime/memory_copy.h"
+#include "runtime/c_backend_api.h"
+#include "runtime/device_api.h"
+#include "runtime/ndarray.h"
+#include "runtime/ndarray_cache.h"
+#include "runtime/profiling.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+using namespace litetvm::runtime;
+
+class CPUHugePageTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dev_.device_type = kDLCPU;
+        dev_.device_id = 0;
+        api_ = DeviceAPI::Get(dev_);
+        litetvm::ffi::Any rv;
+        api_->GetAttr(dev_, kHugePageMode, &rv);
+        mode_ = rv.cast<int>();
+        api_->GetAttr(dev_, kHugePageThreshold, &rv);
+        threshold_ = rv.cast<int64_t>();
+    }
+
+    void TearDown() override {
+        api_->SetAttr(dev_, kHugePageMode, mode_);
+        api_->SetAttr(dev_, kHugePageThreshold, threshold_);
+    }
+
+    void CheckAlloc(size_t nbytes) {
+        DLDataType type{kDLUInt, 8, 1};
+        auto* ptr = static_cast<uint8_t*>(api_->AllocDataSpace(dev_, nbytes, kAllocAlignment, type));
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % kAllocAlignment, 0);
+        std::memset(ptr, 0x5a, nbytes);
+        EXPECT_EQ(ptr[nbytes - 1], 0x5a);
+        api_->FreeDataSpace(dev_, ptr);
+    }
+
+    DLDevice dev_;
+    DeviceAPI* api_;
+    int mode_;
+    int64_t threshold_;
+};
+
+TEST_F(CPUHugePageTest, Attributes) {
+    // large pages are opt-in
+    if (getenv("TVM_CPU_HUGEPAGE") == nullptr) EXPECT_EQ(mode_, 0);
+    litetvm::ffi::Any rv;
+    api_->GetAttr(dev_, kHugePageSize, &rv);
+    EXPECT_GE(rv.cast<int64_t>(), 4096);
+    api_->SetAttr(dev_, kHugePageThreshold, int64_t{1} << 20);
+    api_->GetAttr(dev_, kHugePageThreshold, &rv);
+    EXPECT_EQ(rv.cast<int64_t>(), int64_t{1} << 20);
+}
+
+TEST_F(CPUHugePageTest, AllocatesWithEveryMode) {
+    api_->SetAttr(dev_, kHugePageThreshold, int64_t{1} << 20);
+    // hugetlb falls back when no pages are reserved
+    for (int mode: {0, 1, 2}) {
+        api_->SetAttr(dev_, kHugePageMode, mode);
+        CheckAlloc(1000);
+        CheckAlloc((3 << 20) + 123);
+    }
+}
+
+TEST(DeviceMemoryStatsTest, TracksNDArrayAndWorkspace) {
+    DLDevice dev{kDLCPU, 0};
+    DeviceAPI::ResetPeakMemory(dev);
+    DeviceMemoryStats before = DeviceAPI::GetMemoryStats(dev);
+    {
+        NDArray arr = NDArray::Empty({1000}, DLDataType{kDLFloat, 32, 1}, dev);
+        DeviceMemoryStats stats = DeviceAPI::GetMemoryStats(dev);
+        EXPECT_EQ(stats.current_bytes - before.current_bytes, 4000);
+        EXPECT_EQ(stats.ndarray_bytes - before.ndarray_bytes, 4000);
+        EXPECT_EQ(stats.alloc_count - before.alloc_count, 1);
+        // 4000 bytes fall in [2^11, 2^12)
+        EXPECT_EQ(stats.histogram[11] - before.histogram[11], 1);
+        EXPECT_GE(stats.peak_bytes, stats.current_bytes);
+    }
+    DeviceMemoryStats after = DeviceAPI::GetMemoryStats(dev);
+    EXPECT_EQ(after.current_bytes, before.current_bytes);
+    EXPECT_EQ(after.free_count - before.free_count, 1);
+    EXPECT_GE(after.peak_bytes, before.current_bytes + 4000);
+    DeviceAPI::ResetPeakMemory(dev);
+    EXPECT_EQ(DeviceAPI::GetMemoryStats(dev).peak_bytes, after.current_bytes);
+
+    // the workspace pool accounts whole chunks, not single requests
+    void* data = TVMBackendAllocWorkspace(kDLCPU, 0, 100000, 0, 8);
+    ASSERT_NE(data, nullptr);
+    EXPECT_GE(DeviceAPI::GetMemoryStats(dev).workspace_bytes, 100000);
+    EXPECT_EQ(TVMBackendFreeWorkspace(kDLCPU, 0, data), 0);
+}
+
+TEST(DeviceMemoryStatsTest, ProfilerReportsDifferences) {
+    using litetvm::ffi::String;
+    DLDevice dev{kDLCPU, 0};
+    NDArray before = NDArray::Empty({1 << 20}, DLDataType{kDLFloat, 32, 1}, dev);
+    before = NDArray();
+    const int64_t peak = DeviceAPI::GetMemoryStats(dev).peak_bytes;
+
+    profiling::Profiler prof({dev}, {});
+    prof.Start();
+    NDArray kept = NDArray::Empty({1000}, DLDataType{kDLFloat, 32, 1}, dev);
+    NDArray::Empty({2000}, DLDataType{kDLFloat, 32, 1}, dev);
+    prof.Stop();
+    // the profiler leaves the process wide peak alone
+    EXPECT_EQ(DeviceAPI::GetMemoryStats(dev).peak_bytes, peak);
+
+    auto metrics = prof.Report()->device_metrics[String("cpu0")];
+    auto count = [&](const char* name) { return metrics[String(name)].as<profiling::CountNode>()->value; };
+    EXPECT_EQ(count("Allocations"), 2);
+    EXPECT_EQ(count("Frees"), 1);
+    EXPECT_EQ(count("Memory Growth (bytes)"), 4000);
+    // the temporary array raised usage by 12000 bytes over the start
+    EXPECT_EQ(count("Peak Memory Increase (bytes)"), 12000);
+}
+
+TEST(DeviceMemoryStatsTest, PeakWindowsNest) {
+    DLDevice dev{kDLCPU, 0};
+    const int64_t start = DeviceAPI::GetMemoryStats(dev).current_bytes;
+    int64_t outer = DeviceAPI::StartPeakWindow(dev);
+    NDArray::Empty({3000}, DLDataType{kDLFloat, 32, 1}, dev);
+    int64_t inner = DeviceAPI::StartPeakWindow(dev);
+    NDArray::Empty({1000}, DLDataType{kDLFloat, 32, 1}, dev);
+    EXPECT_EQ(DeviceAPI::StopPeakWindow(dev, inner) - start, 4000);
+    // the outer window still sees the peak from before the inner one started
+    EXPECT_EQ(DeviceAPI::StopPeakWindow(dev, outer) - start, 12000);
+}
+
+TEST(NDArrayCacheTest, ReusesBlocks) {
+    DLDevice dev{kDLCPU, 0};
+    DLDataType f32{kDLFloat, 32, 1};
+    const bool enabled = NDArrayCache::Enabled();
+    const int64_t max_bytes = NDArrayCache::MaxBytes();
+    NDArrayCache::SetEnabled(true);
+    NDArrayCache::SetMaxBytes(int64_t{1} << 20);
+    NDArrayCache::Trim();
+    NDArrayCache::ResetStats();
+
+    void* first;
+    {
+        NDArray arr = NDArray::Empty({1000}, f32, dev);
+        first = arr->data;
+    }
+    NDArrayCacheStats stats = NDArrayCache::GetStats();
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.cached_blocks, 1);
+    EXPECT_EQ(stats.cached_bytes, 4096);
+    {
+        // 4004 bytes round up to the same 4096 byte bucket
+        NDArray arr = NDArray::Empty({1001}, f32, dev);
+        EXPECT_EQ(arr->data, first);
+        NDArray other = NDArray::Empty({1001}, f32, dev);
+        EXPECT_NE(other->data, first);
+    }
+    stats = NDArrayCache::GetStats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.cached_blocks, 2);
+
+    // blocks past the cap go back to the device
+    { NDArray big = NDArray::Empty({int64_t{1} << 19}, f32, dev); }
+    stats = NDArrayCache::GetStats();
+    EXPECT_EQ(stats.cached_blocks, 2);
+    EXPECT_EQ(stats.trimmed_blocks, 1);
+
+    NDArrayCache::Trim(4096);
+    EXPECT_EQ(NDArrayCache::GetStats().cached_bytes, 4096);
+    NDArrayCache::SetEnabled(false);
+    EXPECT_EQ(NDArrayCache::GetStats().cached_blocks, 0);
+    NDArrayCache::SetMaxBytes(max_bytes);
+    NDArrayCache::SetEnabled(enabled);
+}
+
+TEST(CPUCopyTest, LargeCopies) {
+    // big enough for streaming stores, misaligned at both ends
+    const size_t nbytes = (size_t{40} << 20) + 13;
+    std::vector<uint8_t> src(nbytes + 5), dst(nbytes + 5, 0);
+    for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<uint8_t>(i * 131 + (i >> 12));
+    for (size_t n: {size_t{100}, kParallelCopyThreshold + 7, nbytes}) {
+        std::fill(dst.begin(), dst.end(), 0);
+        CopyBytes(dst.data() + 3, src.data() + 1, n);
+        EXPECT_EQ(dst[2], 0);
+        EXPECT_EQ(std::memcmp(dst.data() + 3, src.data() + 1, n), 0);
+        EXPECT_EQ(dst[n + 3], 0);
+    }
+}
+
+TEST(CPUCopyTest, StridedCopies) {
+    DLDevice dev{kDLCPU, 0};
+    DLDataType f32{kDLFloat, 32, 1};
+    for (int64_t rows: {int64_t{3}, int64_t{1} << 11}) {
+        const int64_t cols = 1000;
+        NDArray a = NDArray::Empty({rows, cols}, f32, dev);
+        auto* pa = static_cast<float*>(a->data);
+        for (int64_t i = 0; i < rows * cols; ++i) pa[i] = static_cast<float>(i);
+
+        // the transpose of a, as a strided view
+        int64_t t_shape[2] = {cols, rows};
+        int64_t t_strides[2] = {1, cols};
+        DLTensor t = *a.operator->();
+        t.shape = t_shape;
+        t.strides = t_strides;
+        NDArray b = NDArray::Empty({cols, rows}, f32, dev);
+        b.CopyFrom(&t);
+        auto* pb = static_cast<float*>(b->data);
+        EXPECT_EQ(pb[0], pa[0]);
+        EXPECT_EQ(pb[1], pa[cols]);
+        EXPECT_EQ(pb[rows * cols - 1], pa[rows * cols - 1]);
+        EXPECT_EQ(pb[7 * rows + 2], pa[2 * cols + 7]);
+
+        // every other column of a, into a strided destination
+        int64_t h_shape[2] = {rows, cols / 2};
+        int64_t h_strides[2] = {cols, 2};
+        DLTensor h = *a.operator->();
+        h.shape = h_shape;
+        h.strides = h_strides;
+        h.byte_offset = sizeof(float);
+        NDArray c = NDArray::Empty({rows, cols}, f32, dev);
+        DLTensor hc = *c.operator->();
+        hc.shape = h_shape;
+        hc.strides = h_strides;
+        NDArray::CopyFromTo(&h, &hc);
+        auto* pc = static_cast<float*>(c->data);
+        EXPECT_EQ(pc[0], pa[1]);
+        EXPECT_EQ(pc[2], pa[3]);
+        EXPECT_EQ(pc[(rows - 1) * cols + cols - 2], pa[(rows - 1) * cols + cols - 1]);
+    }
+}
+
+TEST(CPUCopyTest, StridedBytes) {
+    DLDevice dev{kDLCPU, 0};
+    DLDataType i16{kDLInt, 16, 1};
+    // a (2, 3, 4) tensor whose rows of 3 x 4 elements are padded to 16,
+    // the two inner dimensions collapse into one run of 12
+    std::vector<int16_t> padded(2 * 16, -1);
+    int64_t shape[3] = {2, 3, 4};
+    int64_t strides[3] = {16, 4, 1};
+    DLTensor t{padded.data(), dev, 3, i16, shape, strides, 0};
+    std::vector<int16_t> expected(24);
+    for (int i = 0; i < 24; ++i) expected[i] = static_cast<int16_t>(i);
+    std::vector<int16_t> out(24, 0);
+
+    NDArray src = NDArray::Empty({2, 3, 4}, i16, dev);
+    src.CopyFromBytes(expected.data(), 48);
+    NDArray::CopyFromTo(src.operator->(), &t);
+    EXPECT_EQ(padded[11], 11);
+    EXPECT_EQ(padded[12], -1);
+    EXPECT_EQ(padded[16], 12);
+    NDArray::CopyToBytes(&t, out.data(), 48);
+    EXPECT_EQ(out, expected);
+
+    // a transposed view reads back in its own row-major order
+    int64_t t_shape[3] = {4, 3, 2};
+    int64_t t_strides[3] = {1, 4, 16};
+    DLTensor tt{padded.data(), dev, 3, i16, t_shape, t_strides, 0};
+    NDArray::CopyToBytes(&tt, out.data(), 48);
+    EXPECT_EQ(out[1], 12);
+    EXPECT_EQ(out[2], 4);
+    EXPECT_EQ(out[6], 1);
+    EXPECT_EQ(out[23], 23);
+}
+
+}// namespace
@@ -0,0 +1,343 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+#include "ffi/reflection/registry.h"
+#include "runtime/device_api.h"
+#include "runtime/ndarray.h"
+
+#include <dmlc/memory_io.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using litetvm::Device;
+using namespace litetvm::runtime;
+
+// The tensor of arr, as the destination of a copy.
+DLTensor* Mutable(const NDArray& arr) {
+    return const_cast<NDArray::Container*>(arr.operator->());
+}
+
+// Raised by SimDeviceAPI copies while failing is set, not a std::exception.
+struct SimCopyError {
+    int code;
+};
+
+// An in-order queue of copies run by a worker thread, the stream of SimDeviceAPI.
+class SimStream {
+public:
+    SimStream() : worker_([this] { Run(); }) {}
+
+    ~SimStream() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+    }
+
+    void Push(std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(task));
+        ++pending_;
+        cv_.notify_all();
+    }
+
+    void Sync() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+    // Hold queued copies until Release.
+    void Hold() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        held_ = true;
+    }
+
+    void Release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            held_ = false;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return stop_ || (!held_ && !queue_.empty()); });
+            if (stop_) return;
+            auto task = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+            --pending_;
+            cv_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> queue_;
+    size_t pending_{0};
+    bool held_{false};
+    bool stop_{false};
+    std::thread worker_;
+};
+
+// A second device backed by host memory whose copies run asynchronously on
+// SimStream, so the copy pipeline is exercised without a GPU.
+class SimDeviceAPI final : public DeviceAPI {
+public:
+    void SetDevice(Device dev) final {}
+
+    void GetAttr(Device dev, DeviceAttrKind kind, litetvm::ffi::Any* rv) final {
+        if (kind == kExist) *rv = 1;
+    }
+
+    void* AllocDataSpace(Device dev, size_t nbytes, size_t alignment, DLDataType type_hint) final {
+        return ::operator new(nbytes, std::align_val_t{kAllocAlignment});
+    }
+
+    void FreeDataSpace(Device dev, void* ptr) final {
+        ::operator delete(ptr, std::align_val_t{kAllocAlignment});
+    }
+
+    TVMStreamHandle CreateStream(Device dev) final { return new SimStream(); }
+
+    void FreeStream(Device dev, TVMStreamHandle stream) final { delete static_cast<SimStream*>(stream); }
+
+    void StreamSync(Device dev, TVMStreamHandle stream) final { Stream(stream)->Sync(); }
+
+    SimStream* Stream(TVMStreamHandle stream) {
+        return stream != nullptr ? static_cast<SimStream*>(stream) : &default_stream_;
+    }
+
+    static SimDeviceAPI* Global() {
+        static auto* inst = new SimDeviceAPI();
+        return inst;
+    }
+
+    std::atomic<int> num_copies{0};
+    std::atomic<bool> failing{false};
+
+protected:
+    void CopyDataFromTo(const void* from, size_t from_offset, void* to, size_t to_offset, size_t size,
+                        Device dev_from, Device dev_to, DLDataType type_hint,
+                        TVMStreamHandle stream) final {
+        ++num_copies;
+        if (failing) throw SimCopyError{7};
+        const char* src = static_cast<const char*>(from) + from_offset;
+        char* dst = static_cast<char*>(to) + to_offset;
+        Stream(stream)->Push([src, dst, size] { std::memcpy(dst, src, size); });
+    }
+
+private:
+    SimStream default_stream_;
+};
+
+TVM_FFI_STATIC_INIT_BLOCK({
+    namespace refl = litetvm::ffi::reflection;
+    refl::GlobalDef().def_packed("device_api.ext_dev", [](litetvm::ffi::PackedArgs args, litetvm::ffi::Any* rv) {
+        DeviceAPI* ptr = SimDeviceAPI::Global();
+        *rv = static_cast<void*>(ptr);
+    });
+});
+
+class AsyncCopyTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        api_ = SimDeviceAPI::Global();
+        stream_ = api_->CreateStream(sim_);
+    }
+
+    void TearDown() override {
+        api_->FreeStream(sim_, stream_);
+    }
+
+    static std::vector<float> Iota(int64_t n) {
+        std::vector<float> v(n);
+        for (int64_t i = 0; i < n; ++i) v[i] = static_cast<float>(i % 100003);
+        return v;
+    }
+
+    Device cpu_{kDLCPU, 0};
+    Device sim_{kDLExtDev, 0};
+    SimDeviceAPI* api_;
+    TVMStreamHandle stream_;
+    DLDataType f32_{kDLFloat, 32, 1};
+};
+
+TEST_F(AsyncCopyTest, StagedRoundTrip) {
+    // an odd size cuts the last staging chunk short
+    const int64_t n = (10 << 20) / 4 + 7;
+    std::vector<float> host = Iota(n);
+    NDArray src = NDArray::Empty({n}, f32_, cpu_);
+    std::memcpy(src->data, host.data(), n * 4);
+    NDArray dev = NDArray::Empty({n}, f32_, sim_);
+    NDArray dst = NDArray::Empty({n}, f32_, cpu_);
+
+    int before = api_->num_copies;
+    NDArray::CopyFromToAsync(src.operator->(), Mutable(dev), stream_).Wait();
+    EXPECT_EQ(api_->num_copies - before, 3);
+    NDArray::CopyFromToAsync(dev.operator->(), Mutable(dst), stream_).Wait();
+    EXPECT_EQ(api_->num_copies - before, 6);
+    EXPECT_EQ(std::memcmp(dst->data, host.data(), n * 4), 0);
+}
+
+TEST_F(AsyncCopyTest, ReturnsBeforeTransfer) {
+    const int64_t n = (12 << 20) / 4;
+    std::vector<float> host = Iota(n);
+    NDArray dev = NDArray::Empty({n}, f32_, sim_);
+    std::vector<float> out(n);
+
+    SimStream* stream = api_->Stream(stream_);
+    stream->Hold();
+    DLTensor from;
+    from.data = host.data();
+    from.device = cpu_;
+    from.ndim = 1;
+    from.dtype = f32_;
+    from.shape = const_cast<int64_t*>(dev->shape);
+    from.strides = nullptr;
+    from.byte_offset = 0;
+    // the device is held, so the copies can only be queued
+    CopyHandle h2d = NDArray::CopyFromToAsync(&from, Mutable(dev), stream_);
+    DLTensor to = from;
+    to.data = out.data();
+    CopyHandle d2h = NDArray::CopyFromToAsync(dev.operator->(), &to, stream_);
+    stream->Release();
+    h2d.Wait();
+    d2h.Wait();
+    EXPECT_EQ(std::memcmp(out.data(), host.data(), n * 4), 0);
+}
+
+TEST_F(AsyncCopyTest, BytesAndSmallCopies) {
+    const int64_t n = (6 << 20) / 4;
+    std::vector<float> host = Iota(n);
+    std::vector<float> out(n);
+    NDArray dev = NDArray::Empty({n}, f32_, sim_);
+    dev.CopyFromBytes(host.data(), n * 4);
+    dev.CopyToBytes(out.data(), n * 4);
+    EXPECT_EQ(out, host);
+
+    // small copies are issued directly and keep their order after staged ones
+    NDArray small = NDArray::Empty({4}, f32_, cpu_);
+    for (int i = 0; i < 4; ++i) static_cast<float*>(small->data)[i] = -1.0f - i;
+    NDArray dev_small = dev.CreateView({4}, f32_);
+    NDArray src = NDArray::Empty({n}, f32_, cpu_);
+    std::memcpy(src->data, host.data(), n * 4);
+    CopyHandle big = NDArray::CopyFromToAsync(src.operator->(), Mutable(dev), stream_);
+    CopyHandle tail = NDArray::CopyFromToAsync(small.operator->(), Mutable(dev_small), stream_);
+    big.Wait();
+    tail.Wait();
+    std::fill(out.begin(), out.end(), 0.0f);
+    dev.CopyToBytes(out.data(), n * 4);
+    EXPECT_EQ(out[0], -1.0f);
+    EXPECT_EQ(out[3], -4.0f);
+    EXPECT_EQ(out[4], host[4]);
+}
+
+TEST_F(AsyncCopyTest, StreamsDoNotWaitForEachOther) {
+    const int64_t n = (6 << 20) / 4;
+    std::vector<float> host = Iota(n);
+    NDArray src = NDArray::Empty({n}, f32_, cpu_);
+    std::memcpy(src->data, host.data(), n * 4);
+    NDArray dev = NDArray::Empty({n}, f32_, sim_);
+    NDArray other = NDArray::Empty({n}, f32_, sim_);
+    TVMStreamHandle other_stream = api_->CreateStream(sim_);
+
+    SimStream* stream = api_->Stream(stream_);
+    stream->Hold();
+    CopyHandle held = NDArray::CopyFromToAsync(src.operator->(), Mutable(dev), stream_);
+    // neither a staged copy on another stream nor a byte copy queue behind the held one
+    NDArray::CopyFromToAsync(src.operator->(), Mutable(other), other_stream).Wait();
+    std::vector<float> out(n);
+    other.CopyToBytes(out.data(), n * 4);
+    EXPECT_EQ(out, host);
+    stream->Release();
+    held.Wait();
+    api_->FreeStream(sim_, other_stream);
+}
+
+TEST_F(AsyncCopyTest, StagingBuffersInStats) {
+    const int64_t n = (6 << 20) / 4;
+    NDArray src = NDArray::Empty({n}, f32_, cpu_);
+    NDArray dev = NDArray::Empty({n}, f32_, sim_);
+    NDArray::CopyFromToAsync(src.operator->(), Mutable(dev), stream_).Wait();
+    // the staging buffers stay pooled on the host after the copy
+    EXPECT_GE(DeviceAPI::GetMemoryStats(cpu_).workspace_bytes, 2 * (4 << 20));
+}
+
+TEST_F(AsyncCopyTest, CPUCopy) {
+    const int64_t n = (8 << 20) / 4;
+    std::vector<float> host = Iota(n);
+    NDArray a = NDArray::Empty({n}, f32_, cpu_);
+    NDArray b = NDArray::Empty({n}, f32_, cpu_);
+    a.CopyFromBytes(host.data(), n * 4);
+    NDArray::CopyFromToAsync(a.operator->(), Mutable(b)).Wait();
+    EXPECT_EQ(std::memcmp(b->data, host.data(), n * 4), 0);
+    CopyHandle empty;
+    empty.Wait();
+}
+
+TEST_F(AsyncCopyTest, ErrorKeepsType) {
+    const int64_t n = (6 << 20) / 4;
+    NDArray src = NDArray::Empty({n}, f32_, cpu_);
+    NDArray dev = NDArray::Empty({n}, f32_, sim_);
+    NDArray small = NDArray::Empty({4}, f32_, cpu_);
+    NDArray dev_small = dev.CreateView({4}, f32_);
+
+    api_->failing = true;
+    // staged on the copy thread, then issued inline
+    CopyHandle big = NDArray::CopyFromToAsync(src.operator->(), Mutable(dev), stream_);
+    EXPECT_THROW(big.Wait(), SimCopyError);
+    CopyHandle tail = NDArray::CopyFromToAsync(small.operator->(), Mutable(dev_small), stream_);
+    try {
+        tail.Wait();
+        FAIL() << "expected SimCopyError";
+    } catch (const SimCopyError& e) {
+        EXPECT_EQ(e.code, 7);
+    }
+    api_->failing = false;
+
+    // the copy thread survives and runs later copies
+    NDArray::CopyFromToAsync(src.operator->(), Mutable(dev), stream_).Wait();
+}
+
+TEST_F(AsyncCopyTest, SaveDeviceData) {
+    const int64_t n = (3 << 20) / 4 + 5;
+    std::vector<float> host = Iota(n);
+    NDArray dev = NDArray::Empty({n}, f32_, sim_);
+    dev.CopyFromBytes(host.data(), n * 4);
+    std::string bytes;
+    dmlc::MemoryStringStream strm(&bytes);
+    SaveDLTensorData(&strm, dev.operator->());
+    ASSERT_EQ(bytes.size(), n * 4);
+    EXPECT_EQ(std::memcmp(bytes.data(), host.data(), n * 4), 0);
+
+    // every other element, device copies cannot gather it
+    int64_t half = n / 2;
+    int64_t stride = 2;
+    DLTensor strided = *dev.operator->();
+    strided.shape = &half;
+    strided.strides = &stride;
+    EXPECT_ANY_THROW(SaveDLTensorData(&strm, &strided));
+}
+
+}// namespace
@@ -0,0 +1,381 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+#include "../src/runtime/file_utils.h"
+#include "runtime/ndarray.h"
+
+#include <dmlc/memory_io.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+using namespace litetvm::runtime;
+using litetvm::ffi::Map;
+using litetvm::ffi::String;
+
+NDArray MakeArray(std::vector<int64_t> shape, float start) {
+    NDArray arr = NDArray::Empty(litetvm::ffi::Shape(shape), DLDataType{kDLFloat, 32, 1}, {kDLCPU, 0});
+    auto* data = static_cast<float*>(arr->data);
+    for (int64_t i = 0; i < arr.Shape().Product(); ++i) data[i] = start + static_cast<float>(i);
+    return arr;
+}
+
+Map<String, NDArray> MakeParams() {
+    Map<String, NDArray> params;
+    params.Set("weight", MakeArray({3, 5}, 0));
+    params.Set("bias", MakeArray({7}, 100));
+    params.Set("scalar", MakeArray({}, -1));
+    params.Set("empty", MakeArray({0, 4}, 0));
+    params.Set("large", MakeArray({37, 101}, 7));
+    return params;
+}
+
+void ExpectSameParams(const Map<String, NDArray>& expected, const Map<String, NDArray>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (const auto& kv: expected) {
+        ASSERT_TRUE(actual.count(kv.first)) << kv.first;
+        NDArray a = kv.second;
+        NDArray b = actual[kv.first];
+        ASSERT_EQ(std::vector<int64_t>(a.Shape().begin(), a.Shape().end()),
+                  std::vector<int64_t>(b.Shape().begin(), b.Shape().end()))
+                << kv.first;
+        auto* x = static_cast<const float*>(a->data);
+        auto* y = static_cast<const float*>(b->data);
+        for (int64_t i = 0; i < a.Shape().Product(); ++i) EXPECT_EQ(x[i], y[i]) << kv.first << " " << i;
+    }
+}
+
+class ParamsFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = "/tmp/litetvm_params_test_" + std::to_string(getpid()) + ".params";
+    }
+    void TearDown() override { std::remove(path_.c_str()); }
+
+    void Save(const Map<String, NDArray>& params, ParamsFormat format) {
+        SimpleBinaryFileStream strm(path_, "wb");
+        SaveParams(&strm, params, format);
+    }
+
+    std::string path_;
+};
+
+TEST_F(ParamsFileTest, StreamRoundTrip) {
+    auto params = MakeParams();
+    for (auto format: {ParamsFormat::kPacked, ParamsFormat::kAligned, ParamsFormat::kIndexed}) {
+        std::string bytes;
+        dmlc::MemoryStringStream strm(&bytes);
+        SaveParams(&strm, params, format);
+        ExpectSameParams(params, LoadParams(bytes));
+        dmlc::MemoryStringStream in(&bytes);
+        ExpectSameParams(params, LoadParams(static_cast<dmlc::Stream*>(&in)));
+    }
+    EXPECT_EQ(SaveParams(params).substr(0, 8), std::string(reinterpret_cast<const char*>(&kTVMNDArrayListMagic), 8));
+}
+
+TEST_F(ParamsFileTest, MappedAlignedPayloadsAreZeroCopy) {
+    auto params = MakeParams();
+    Save(params, ParamsFormat::kAligned);
+    auto loaded = LoadParamsFromFile(path_);
+    ExpectSameParams(params, loaded);
+    for (const auto& kv: loaded) {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(kv.second->data) % kAllocAlignment, 0) << kv.first;
+    }
+    // the arrays own the mapping and stay writable
+    NDArray weight = loaded["weight"];
+    loaded = Map<String, NDArray>();
+    static_cast<float*>(weight->data)[0] = 42;
+    EXPECT_EQ(static_cast<float*>(weight->data)[14], 14);
+    // writes stay private to the process
+    ExpectSameParams(params, LoadParamsFromFile(path_));
+}
+
+TEST_F(ParamsFileTest, MappedPackedFormat) {
+    auto params = MakeParams();
+    Save(params, ParamsFormat::kPacked);
+    ExpectSameParams(params, LoadParamsFromFile(path_));
+}
+
+TEST_F(ParamsFileTest, Crc32c) {
+    // check value of the Castagnoli polynomial
+    EXPECT_EQ(Crc32c("123456789", 9), 0xE3069283u);
+    EXPECT_EQ(Crc32c("56789", 5, Crc32c("1234", 4)), 0xE3069283u);
+    EXPECT_EQ(Crc32c(nullptr, 0), 0u);
+}
+
+TEST_F(ParamsFileTest, Crc32cCombine) {
+    std::string data(1000, '\0');
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<char>(i * 31 + 7);
+    for (size_t split: {0, 1, 7, 64, 999, 1000}) {
+        uint32_t head = Crc32c(data.data(), split);
+        uint32_t tail = Crc32c(data.data() + split, data.size() - split);
+        EXPECT_EQ(Crc32cCombine(head, tail, data.size() - split), Crc32c(data.data(), data.size()));
+    }
+}
+
+TEST_F(ParamsFileTest, ParallelSaveMatchesSerial) {
+    auto params = MakeParams();
+    std::string serial;
+    {
+        dmlc::MemoryStringStream strm(&serial);
+        SaveParams(&strm, params, ParamsFormat::kIndexed);
+    }
+    ParamsIOOptions options;
+    options.block_size = 100;
+    for (int num_threads: {1, 3}) {
+        options.num_threads = num_threads;
+        SaveParamsParallel(path_, params, options);
+        std::string bytes;
+        LoadBinaryFromFile(path_, &bytes);
+        EXPECT_EQ(bytes, serial);
+        ExpectSameParams(params, LoadParamsParallel(path_, options));
+    }
+}
+
+TEST_F(ParamsFileTest, ParallelLoadOlderFormats) {
+    auto params = MakeParams();
+    ParamsIOOptions options;
+    options.block_size = 128;
+    options.num_threads = 2;
+    for (auto format: {ParamsFormat::kPacked, ParamsFormat::kAligned}) {
+        Save(params, format);
+        ExpectSameParams(params, LoadParamsParallel(path_, options));
+    }
+}
+
+TEST_F(ParamsFileTest, SaveStridedTensorStreams) {
+    // the transpose of a 700x600 matrix spans several save chunks
+    const int64_t rows = 700, cols = 600;
+    NDArray src = MakeArray({rows, cols}, 0);
+    int64_t shape[2] = {cols, rows};
+    int64_t strides[2] = {1, cols};
+    DLTensor transposed = *src.operator->();
+    transposed.shape = shape;
+    transposed.strides = strides;
+    // a column view with a byte offset
+    int64_t col_shape[1] = {rows};
+    int64_t col_strides[1] = {cols};
+    DLTensor column = transposed;
+    column.ndim = 1;
+    column.shape = col_shape;
+    column.strides = col_strides;
+    column.byte_offset = 5 * sizeof(float);
+    for (const DLTensor* view: {&transposed, &column}) {
+        std::string bytes;
+        dmlc::MemoryStringStream strm(&bytes);
+        SaveDLTensor(&strm, view);
+        dmlc::MemoryStringStream in(&bytes);
+        NDArray loaded;
+        ASSERT_TRUE(loaded.Load(&in));
+        ASSERT_EQ(loaded->ndim, view->ndim);
+        auto* data = static_cast<const float*>(loaded->data);
+        const auto* expected = static_cast<const float*>(src->data) + view->byte_offset / sizeof(float);
+        for (int64_t i = 0; i < view->shape[0]; ++i) {
+            if (view->ndim == 1) {
+                ASSERT_EQ(data[i], expected[i * cols]) << i;
+                continue;
+            }
+            for (int64_t j = 0; j < rows; ++j) ASSERT_EQ(data[i * rows + j], expected[j * cols + i]) << i << " " << j;
+        }
+    }
+}
+
+TEST_F(ParamsFileTest, CompressBlockRoundTrip) {
+    std::vector<std::string> blocks = {"", "a", std::string(13, 'x'), std::string(100000, '\0')};
+    std::string text;
+    for (int i = 0; i < 5000; ++i) text += "weight." + std::to_string(i % 37) + ";";
+    blocks.push_back(text);
+    std::string noise(70000, '\0');
+    uint32_t state = 1;
+    for (auto& c: noise) c = static_cast<char>((state = state * 1103515245u + 12345u) >> 24);
+    blocks.push_back(noise);
+    for (const auto& block: blocks) {
+        for (auto codec: {CompressionCodec::kLZ, CompressionCodec::kLZHigh}) {
+            for (size_t elem_bytes: {1, 2, 3, 4, 8}) {
+                std::vector<char> stored;
+                size_t n = CompressBlock(codec, block.data(), block.size(), elem_bytes, &stored);
+                ASSERT_EQ(n, stored.size());
+                ASSERT_LE(n, block.size());
+                std::string back(block.size(), '\1');
+                ASSERT_TRUE(DecompressBlock(stored.data(), n, back.data(), back.size(), elem_bytes));
+                EXPECT_EQ(back, block) << block.size() << " " << elem_bytes;
+            }
+        }
+    }
+    std::vector<char> stored;
+    size_t n = CompressBlock(CompressionCodec::kLZ, blocks[3].data(), blocks[3].size(), 4, &stored);
+    EXPECT_LT(n, blocks[3].size() / 100);
+    std::string back(blocks[3].size(), '\0');
+    EXPECT_FALSE(DecompressBlock(stored.data(), n - 1, back.data(), back.size(), 4));
+    EXPECT_FALSE(DecompressBlock(stored.data(), n, back.data(), back.size() - 1, 4));
+}
+
+TEST_F(ParamsFileTest, CompressedRoundTrip) {
+    auto params = MakeParams();
+    // mostly zero weights compress, the others are stored raw when they do not shrink
+    NDArray sparse = MakeArray({300, 257}, 0);
+    auto* data = static_cast<float*>(sparse->data);
+    for (int64_t i = 0; i < sparse.Shape().Product(); ++i) data[i] = i % 97 == 0 ? 0.5f * (i % 7) : 0;
+    params.Set("sparse", sparse);
+    std::string raw;
+    {
+        dmlc::MemoryStringStream strm(&raw);
+        SaveParams(&strm, params, ParamsFormat::kIndexed);
+    }
+    ParamsIOOptions options;
+    options.compress_block_size = 1000;
+    for (auto codec: {CompressionCodec::kLZ, CompressionCodec::kLZHigh}) {
+        options.codec = codec;
+        for (int num_threads: {1, 3}) {
+            options.num_threads = num_threads;
+            std::string bytes;
+            dmlc::MemoryStringStream strm(&bytes);
+            SaveParams(&strm, params, ParamsFormat::kIndexed, options);
+            EXPECT_LT(bytes.size(), raw.size() / 4);
+            ExpectSameParams(params, LoadParams(bytes));
+
+            SaveParamsParallel(path_, params, options);
+            std::string file;
+            LoadBinaryFromFile(path_, &file);
+            EXPECT_EQ(file, bytes);
+            ExpectSameParams(params, LoadParamsParallel(path_, options));
+            LazyParams lazy(path_);
+            const ParamsIndexEntry& entry = lazy.Entry("sparse");
+            EXPECT_EQ(entry.codec, codec);
+            EXPECT_EQ(entry.block_size, 1000u);
+            EXPECT_EQ(entry.block_sizes.size(), (entry.nbytes + 999) / 1000);
+            EXPECT_LT(entry.stored_nbytes, entry.nbytes / 4);
+            EXPECT_EQ(lazy.Entry("scalar").codec, CompressionCodec::kNone);
+            EXPECT_EQ(lazy.Entry("empty").codec, CompressionCodec::kNone);
+            ExpectSameParams(params, lazy.ToMap());
+        }
+    }
+}
+
+TEST_F(ParamsFileTest, CompressedChecksumMismatch) {
+    Map<String, NDArray> params;
+    NDArray zeros = MakeArray({64, 64}, 0);
+    std::memset(zeros->data, 0, 64 * 64 * sizeof(float));
+    params.Set("zeros", zeros);
+    ParamsIOOptions options;
+    options.codec = CompressionCodec::kLZ;
+    SaveParamsParallel(path_, params, options);
+    size_t offset;
+    {
+        LazyParams lazy(path_);
+        ASSERT_EQ(lazy.Entry("zeros").codec, CompressionCodec::kLZ);
+        offset = lazy.Entry("zeros").offset;
+    }
+    std::FILE* fp = std::fopen(path_.c_str(), "r+b");
+    ASSERT_NE(fp, nullptr);
+    std::fseek(fp, static_cast<long>(offset + 1), SEEK_SET);
+    std::fputc(0x7f, fp);
+    std::fclose(fp);
+    EXPECT_ANY_THROW(LazyParams(path_).Get("zeros"));
+    EXPECT_ANY_THROW(LoadParamsParallel(path_));
+}
+
+TEST_F(ParamsFileTest, BufferedFileStream) {
+    std::string expected;
+    for (int i = 0; i < 30000; ++i) expected += static_cast<char>(i * 131 + i / 7);
+    for (bool direct: {false, true}) {
+        FileStreamOptions options;
+        options.buffer_size = 5000;
+        options.direct = direct;
+        {
+            // small writes fill the buffer, large ones leave with it in one writev
+            BufferedFileStream strm(path_, "wb", options);
+            strm.Write(expected.data(), 10);
+            strm.Write(expected.data() + 10, 20000);
+            strm.Write(expected.data() + 20010, 9990);
+        }
+        BufferedFileStream strm(path_, "rb", options);
+        EXPECT_EQ(strm.file_size(), expected.size());
+        std::string bytes(expected.size() + 1, '\0');
+        EXPECT_EQ(strm.Read(bytes.data(), 3), 3u);
+        EXPECT_EQ(strm.Read(bytes.data() + 3, 12000), 12000u);
+        EXPECT_EQ(strm.Read(bytes.data() + 12003, 100000), expected.size() - 12003);
+        bytes.pop_back();
+        EXPECT_EQ(bytes, expected);
+    }
+    auto params = MakeParams();
+    {
+        BufferedFileStream strm(path_, "wb");
+        SaveParams(&strm, params, ParamsFormat::kAligned);
+    }
+    BufferedFileStream strm(path_, "rb");
+    ExpectSameParams(params, LoadParams(&strm));
+}
+
+TEST(BufferedFileStreamTest, WriteErrors) {
+    // the bytes only reach the device on Close, which reports the failure
+    EXPECT_ANY_THROW(SaveBinaryToFile("/dev/full", "hello"));
+    BufferedFileStream strm("/dev/full", "wb");
+    strm.Write("hello", 5);
+    // a stream that is never closed logs the error instead of terminating
+}
+
+TEST_F(ParamsFileTest, LazyParamsReadOnDemand) {
+    auto params = MakeParams();
+    for (auto format: {ParamsFormat::kAligned, ParamsFormat::kIndexed}) {
+        Save(params, format);
+        LazyParams lazy(path_);
+        ASSERT_EQ(lazy.size(), params.size());
+        EXPECT_TRUE(lazy.count("bias"));
+        EXPECT_FALSE(lazy.count("missing"));
+        EXPECT_EQ(lazy.Entry("weight").nbytes, 60u);
+        EXPECT_EQ(lazy.Entry("weight").has_checksum, format == ParamsFormat::kIndexed);
+        EXPECT_EQ(lazy.num_loaded(), 0u);
+        NDArray bias = lazy["bias"];
+        EXPECT_EQ(static_cast<float*>(bias->data)[6], 106);
+        EXPECT_EQ(lazy.num_loaded(), 1u);
+        EXPECT_EQ(lazy["bias"].get(), bias.get());
+        ExpectSameParams(params, lazy.ToMap());
+        EXPECT_EQ(lazy.num_loaded(), params.size());
+    }
+}
+
+TEST_F(ParamsFileTest, IndexedChecksumMismatch) {
+    auto params = MakeParams();
+    Save(params, ParamsFormat::kIndexed);
+    size_t offset;
+    {
+        LazyParams lazy(path_);
+        offset = lazy.Entry("bias").offset;
+    }
+    std::FILE* fp = std::fopen(path_.c_str(), "r+b");
+    ASSERT_NE(fp, nullptr);
+    std::fseek(fp, static_cast<long>(offset), SEEK_SET);
+    std::fputc(0x7f, fp);
+    std::fclose(fp);
+    LazyParams lazy(path_);
+    EXPECT_EQ(static_cast<float*>(lazy["weight"]->data)[3], 3);
+    EXPECT_ANY_THROW(lazy.Get("bias"));
+}
+
+TEST_F(ParamsFileTest, SaveToFileGlobals) {
+    using litetvm::ffi::Function;
+    auto params = MakeParams();
+    auto magic = [this] {
+        std::string bytes;
+        LoadBinaryFromFile(path_, &bytes);
+        uint64_t value;
+        std::memcpy(&value, bytes.data(), sizeof(value));
+        return value;
+    };
+    Function::GetGlobalRequired("runtime.SaveParamsToFile")(params, String(path_));
+    EXPECT_EQ(magic(), kTVMNDArrayListMagic);
+    Function::GetGlobalRequired("runtime.SaveParamsToFileWithFormat")(params, String(path_),
+                                                                      static_cast<int>(ParamsFormat::kIndexed));
+    EXPECT_EQ(magic(), kTVMNDArrayListIndexedMagic);
+    ExpectSameParams(params, LoadParamsFromFile(path_));
+    EXPECT_ANY_THROW(Function::GetGlobalRequired("runtime.SaveParamsToFileWithFormat")(params, String(path_), 3));
+}
+
+}// namespace
@@ -0,0 +1,62 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+// Compares the flat and the tree parallel barrier:
+//   TVM_NUM_THREADS=64 ./thread_pool_benchmark --benchmark_filter=Barrier
+//
+#include "runtime/c_backend_api.h"
+#include "runtime/threading_backend.h"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+using namespace litetvm::runtime;
+
+struct BarrierClosure {
+    int64_t rounds;
+};
+
+int BarrierRounds(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+    auto* closure = static_cast<BarrierClosure*>(cdata);
+    for (int64_t i = 0; i < closure->rounds; ++i) {
+        TVMBackendParallelBarrier(task_id, penv);
+    }
+    return 0;
+}
+
+void BM_ParallelBarrier(benchmark::State& state, threading::BarrierMode mode) {
+    auto prev_mode = threading::GetBarrierMode();
+    auto prev_sched = threading::GetSchedulerMode();
+    threading::SetBarrierMode(mode);
+    threading::SetSchedulerMode(threading::SchedulerMode::kStatic);
+    threading::Configure(threading::ThreadGroup::kBig, threading::MaxConcurrency(), {});
+    BarrierClosure closure{state.range(0)};
+    for (auto _: state) {
+        TVMBackendParallelLaunch(BarrierRounds, &closure, 0);
+    }
+    state.SetItemsProcessed(state.iterations() * closure.rounds);
+    state.counters["threads"] = threading::NumThreads();
+    threading::SetBarrierMode(prev_mode);
+    threading::SetSchedulerMode(prev_sched);
+}
+
+BENCHMARK_CAPTURE(BM_ParallelBarrier, Flat, threading::BarrierMode::kFlat)
+        ->Arg(1000)
+        ->UseRealTime();
+BENCHMARK_CAPTURE(BM_ParallelBarrier, Tree, threading::BarrierMode::kTree)
+        ->Arg(1000)
+        ->UseRealTime();
+
+int Noop(int task_id, TVMParallelGroupEnv* penv, void* cdata) { return 0; }
+
+// cost of an empty launch, the floor the barrier numbers sit on
+void BM_ParallelLaunch(benchmark::State& state) {
+    for (auto _: state) {
+        TVMBackendParallelLaunch(Noop, nullptr, 0);
+    }
+}
+BENCHMARK(BM_ParallelLaunch)->UseRealTime();
+
+}// namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,374 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+#include "runtime/c_backend_api.h"
+#include "runtime/threading_backend.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using namespace litetvm::runtime;
+
+struct CountClosure {
+    std::vector<std::atomic<int>>* hits;
+};
+
+int CountTask(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+    auto* closure = static_cast<CountClosure*>(cdata);
+    (*closure->hits)[task_id].fetch_add(1);
+    // make some of the tasks much heavier than the others
+    if (task_id % 7 == 0) {
+        volatile double acc = 0;
+        for (int i = 0; i < 200000; ++i) acc = acc + i * 0.5;
+    }
+    return 0;
+}
+
+// Use every worker of the pool, the default big-core mode picks a single
+// worker on small CI machines.
+void UseAllWorkers() {
+    threading::Configure(threading::ThreadGroup::kBig, threading::MaxConcurrency(), {});
+}
+
+// run with several workers even on small CI machines
+class ThreadPoolTest : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() { setenv("TVM_NUM_THREADS", "4", 0); }
+    void SetUp() override { UseAllWorkers(); }
+};
+
+class ScopedScheduler {
+public:
+    explicit ScopedScheduler(threading::SchedulerMode mode) : prev_(threading::GetSchedulerMode()) {
+        threading::SetSchedulerMode(mode);
+    }
+    ~ScopedScheduler() { threading::SetSchedulerMode(prev_); }
+
+private:
+    threading::SchedulerMode prev_;
+};
+
+TEST_F(ThreadPoolTest, WorkStealingRunsEveryTaskOnce) {
+    ScopedScheduler scope(threading::SchedulerMode::kWorkStealing);
+    for (int num_task: {1, 3, 64, 1000}) {
+        std::vector<std::atomic<int>> hits(num_task);
+        CountClosure closure{&hits};
+        ASSERT_EQ(TVMBackendParallelLaunch(CountTask, &closure, num_task), 0);
+        for (int i = 0; i < num_task; ++i) {
+            EXPECT_EQ(hits[i].load(), 1) << "task " << i << " of " << num_task;
+        }
+    }
+}
+
+TEST_F(ThreadPoolTest, FailedLaunchLeavesPoolUsable) {
+    ScopedScheduler scope(threading::SchedulerMode::kStatic);
+    const int num_task = threading::NumThreads();
+    std::vector<std::atomic<int>> hits(num_task + 1);
+    CountClosure closure{&hits};
+    // a sync launch cannot have more tasks than workers
+    EXPECT_ANY_THROW(TVMBackendParallelLaunch(CountTask, &closure, num_task + 1));
+    // the next launch goes to the workers again instead of running inline
+    ASSERT_EQ(TVMBackendParallelLaunch(CountTask, &closure, num_task), 0);
+    for (int i = 0; i < num_task; ++i) {
+        EXPECT_EQ(hits[i].load(), 1) << "task " << i;
+    }
+}
+
+TEST_F(ThreadPoolTest, WorkStealingParallelFor) {
+    ScopedScheduler scope(threading::SchedulerMode::kWorkStealing);
+    std::vector<int> data(10000, 0);
+    parallel_for_with_threading_backend([&data](int64_t i) { data[i] = static_cast<int>(i); }, 0,
+                                        static_cast<int64_t>(data.size()));
+    for (size_t i = 0; i < data.size(); ++i) {
+        EXPECT_EQ(data[i], static_cast<int>(i));
+    }
+}
+
+TEST_F(ThreadPoolTest, ParallelForSchedules) {
+    for (auto sched: {threading::SchedulerMode::kStatic, threading::SchedulerMode::kWorkStealing}) {
+        ScopedScheduler scope(sched);
+        for (auto schedule: {ParallelForSchedule::Static(), ParallelForSchedule::Dynamic(),
+                             ParallelForSchedule::Dynamic(7), ParallelForSchedule::Guided(),
+                             ParallelForSchedule::Guided(3, 5)}) {
+            std::vector<std::atomic<int>> hits(1237);
+            parallel_for_with_threading_backend(
+                    [&hits](int64_t i) {
+                        hits[i].fetch_add(1);
+                        // per-item cost varies by 10x
+                        volatile double acc = 0;
+                        for (int k = 0; k < (i % 10 == 0 ? 10000 : 1000); ++k) acc = acc + k;
+                    },
+                    3, static_cast<int64_t>(hits.size()), schedule);
+            for (size_t i = 0; i < hits.size(); ++i) {
+                EXPECT_EQ(hits[i].load(), i < 3 ? 0 : 1) << "kind " << schedule.kind << " index " << i;
+            }
+        }
+    }
+}
+
+TEST_F(ThreadPoolTest, ParallelForGrainRunsSmallLoopsInline) {
+    const auto caller = std::this_thread::get_id();
+    int calls = 0;
+    parallel_for_with_threading_backend(
+            [&](int64_t i) {
+                EXPECT_EQ(std::this_thread::get_id(), caller);
+                ++calls;
+            },
+            0, 64, ParallelForSchedule::Dynamic(8, 64));
+    EXPECT_EQ(calls, 64);
+}
+
+int FailingTask(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+    if (task_id == 2) {
+        TVMFFIErrorSetRaisedFromCStr("ValueError", "task two failed");
+        return -1;
+    }
+    return 0;
+}
+
+TEST_F(ThreadPoolTest, WorkStealingPropagatesError) {
+    ScopedScheduler scope(threading::SchedulerMode::kWorkStealing);
+    EXPECT_EQ(TVMBackendParallelLaunch(FailingTask, nullptr, 8), -1);
+    TVMFFIObjectHandle err = nullptr;
+    TVMFFIErrorMoveFromRaised(&err);
+    ASSERT_NE(err, nullptr);
+    TVMFFIObjectDecRef(err);
+}
+
+int BarrierTask(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+    auto* counter = static_cast<std::atomic<int>*>(cdata);
+    counter->fetch_add(1);
+    TVMBackendParallelBarrier(task_id, penv);
+    return counter->load() == penv->num_task ? 0 : -1;
+}
+
+class ScopedBarrier {
+public:
+    explicit ScopedBarrier(threading::BarrierMode mode) : prev_(threading::GetBarrierMode()) {
+        threading::SetBarrierMode(mode);
+    }
+    ~ScopedBarrier() { threading::SetBarrierMode(prev_); }
+
+private:
+    threading::BarrierMode prev_;
+};
+
+constexpr threading::BarrierMode kBarrierModes[] = {threading::BarrierMode::kFlat,
+                                                    threading::BarrierMode::kTree};
+
+TEST_F(ThreadPoolTest, StaticBarrier) {
+    ScopedScheduler scope(threading::SchedulerMode::kStatic);
+    for (auto mode: kBarrierModes) {
+        ScopedBarrier barrier(mode);
+        // fewer tasks than threads build smaller trees
+        for (int num_task: {0, 2, 3}) {
+            if (num_task > threading::NumThreads()) continue;
+            std::atomic<int> counter{0};
+            EXPECT_EQ(TVMBackendParallelLaunch(BarrierTask, &counter, num_task), 0);
+            EXPECT_EQ(counter.load(), num_task == 0 ? threading::NumThreads() : num_task);
+        }
+    }
+}
+
+int SlowBarrierTask(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+    auto* counter = static_cast<std::atomic<int>*>(cdata);
+    for (int round = 1; round <= 3; ++round) {
+        // keep the others waiting long enough to park
+        if (task_id == round % penv->num_task) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        counter->fetch_add(1);
+        TVMBackendParallelBarrier(task_id, penv);
+        if (counter->load() != round * penv->num_task) return -1;
+        TVMBackendParallelBarrier(task_id, penv);
+    }
+    return 0;
+}
+
+TEST_F(ThreadPoolTest, WorkStealingKeepsBarrierLaunchesStatic) {
+    ScopedScheduler scope(threading::SchedulerMode::kWorkStealing);
+    const int num_task = threading::NumThreads();
+    for (int i = 0; i < 3; ++i) {
+        std::atomic<int> counter{0};
+        EXPECT_EQ(TVMBackendParallelLaunch(BarrierTask, &counter, num_task), 0);
+        EXPECT_EQ(counter.load(), num_task);
+    }
+    // more tasks than workers always steal, the barrier fails instead of aborting
+    std::atomic<int> counter{0};
+    EXPECT_EQ(TVMBackendParallelLaunch(BarrierTask, &counter, 64), -1);
+    TVMFFIObjectHandle err = nullptr;
+    TVMFFIErrorMoveFromRaised(&err);
+    ASSERT_NE(err, nullptr);
+    TVMFFIObjectDecRef(err);
+}
+
+TEST_F(ThreadPoolTest, StaticBarrierParksSlowWaiters) {
+    ScopedScheduler scope(threading::SchedulerMode::kStatic);
+    for (auto mode: kBarrierModes) {
+        ScopedBarrier barrier(mode);
+        std::atomic<int> counter{0};
+        EXPECT_EQ(TVMBackendParallelLaunch(SlowBarrierTask, &counter, 0), 0);
+        EXPECT_EQ(counter.load(), 3 * threading::NumThreads());
+    }
+}
+
+TEST_F(ThreadPoolTest, ParkedWorkersWakeUp) {
+    ScopedScheduler scope(threading::SchedulerMode::kStatic);
+    for (int i = 0; i < 3; ++i) {
+        // long idle gaps teach the workers to park instead of spinning
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        std::atomic<int> counter{0};
+        ASSERT_EQ(TVMBackendParallelLaunch(BarrierTask, &counter, 0), 0);
+        EXPECT_EQ(counter.load(), threading::NumThreads());
+    }
+}
+
+int WorkspaceTask(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+    for (size_t nbytes: {64, 4096, 100000}) {
+        auto* data = static_cast<char*>(TVMBackendAllocWorkspace(kDLCPU, 0, nbytes, 0, 8));
+        if (data == nullptr) return -1;
+        std::fill(data, data + nbytes, static_cast<char>(task_id));
+        if (TVMBackendFreeWorkspace(kDLCPU, 0, data) != 0) return -1;
+    }
+    return 0;
+}
+
+// kNuma only takes effect when every worker gets a core of its own
+bool CanPinWorkers() {
+    return std::thread::hardware_concurrency() >= static_cast<unsigned>(threading::MaxConcurrency());
+}
+
+TEST_F(ThreadPoolTest, NumaPlacement) {
+    ASSERT_GE(threading::NumaNodeCount(), 1);
+    EXPECT_GE(threading::CurrentNumaNode(), 0);
+    EXPECT_LT(threading::CurrentNumaNode(), threading::NumaNodeCount());
+    if (!CanPinWorkers()) GTEST_SKIP() << "fewer cores than workers";
+    threading::Configure(threading::ThreadGroup::kNuma, threading::MaxConcurrency(), {});
+    EXPECT_TRUE(threading::NumaPlacementEnabled());
+    EXPECT_EQ(threading::NumThreads(), threading::MaxConcurrency());
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(TVMBackendParallelLaunch(WorkspaceTask, nullptr, 0), 0);
+    }
+}
+
+TEST_F(ThreadPoolTest, NumaPlacementReconfigured) {
+    if (!CanPinWorkers()) GTEST_SKIP() << "fewer cores than workers";
+    // a block is freed to the pool that made it after the placement changes
+    UseAllWorkers();
+    void* local = TVMBackendAllocWorkspace(kDLCPU, 0, 4096, 0, 8);
+    threading::Configure(threading::ThreadGroup::kNuma, threading::MaxConcurrency(), {});
+    EXPECT_TRUE(threading::NumaPlacementEnabled());
+    void* node = TVMBackendAllocWorkspace(kDLCPU, 0, 4096, 0, 8);
+    EXPECT_EQ(TVMBackendFreeWorkspace(kDLCPU, 0, local), 0);
+    UseAllWorkers();
+    EXPECT_FALSE(threading::NumaPlacementEnabled());
+    EXPECT_EQ(TVMBackendFreeWorkspace(kDLCPU, 0, node), 0);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(TVMBackendParallelLaunch(WorkspaceTask, nullptr, 0), 0);
+    }
+}
+
+TEST_F(ThreadPoolTest, NumaPlacementSurvivesNewPools) {
+    if (!CanPinWorkers()) GTEST_SKIP() << "fewer cores than workers";
+    threading::Configure(threading::ThreadGroup::kNuma, threading::MaxConcurrency(), {});
+    ASSERT_TRUE(threading::NumaPlacementEnabled());
+    // the first launch of another thread creates its own pool with the default mode
+    std::thread launcher([]() { EXPECT_EQ(TVMBackendParallelLaunch(WorkspaceTask, nullptr, 0), 0); });
+    launcher.join();
+    EXPECT_TRUE(threading::NumaPlacementEnabled());
+}
+
+TEST_F(ThreadPoolTest, NumaPlacementNeedsPinnedWorkers) {
+    const char* bind = getenv("TVM_BIND_THREADS");
+    std::string prev = bind ? bind : "";
+    setenv("TVM_BIND_THREADS", "0", 1);
+    threading::Configure(threading::ThreadGroup::kNuma, threading::MaxConcurrency(), {});
+    EXPECT_FALSE(threading::NumaPlacementEnabled());
+    if (bind) {
+        setenv("TVM_BIND_THREADS", prev.c_str(), 1);
+    } else {
+        unsetenv("TVM_BIND_THREADS");
+    }
+    EXPECT_EQ(TVMBackendParallelLaunch(WorkspaceTask, nullptr, 0), 0);
+}
+
+class ScopedPoolMode {
+public:
+    explicit ScopedPoolMode(threading::PoolMode mode) : prev_(threading::GetPoolMode()) {
+        threading::SetPoolMode(mode);
+        UseAllWorkers();
+    }
+    ~ScopedPoolMode() { threading::SetPoolMode(prev_); }
+
+private:
+    threading::PoolMode prev_;
+};
+
+TEST_F(ThreadPoolTest, SharedPoolConcurrentLaunchers) {
+    ScopedPoolMode scope(threading::PoolMode::kShared);
+    constexpr int kLaunchers = 4;
+    constexpr int kRounds = 50;
+    for (auto sched: {threading::SchedulerMode::kStatic, threading::SchedulerMode::kWorkStealing}) {
+        ScopedScheduler sched_scope(sched);
+        // the static engine cannot run more sync tasks than threads
+        const int num_task = sched == threading::SchedulerMode::kStatic ? threading::NumThreads() : 16;
+        std::vector<int> failures(kLaunchers, 0);
+        std::vector<std::thread> launchers;
+        for (int t = 0; t < kLaunchers; ++t) {
+            launchers.emplace_back([t, num_task, &failures]() {
+                for (int r = 0; r < kRounds; ++r) {
+                    std::vector<std::atomic<int>> hits(num_task);
+                    CountClosure closure{&hits};
+                    if (TVMBackendParallelLaunch(CountTask, &closure, num_task) != 0) ++failures[t];
+                    for (auto& h: hits) {
+                        if (h.load() != 1) ++failures[t];
+                    }
+                }
+            });
+        }
+        for (auto& th: launchers) th.join();
+        for (int t = 0; t < kLaunchers; ++t) {
+            EXPECT_EQ(failures[t], 0) << "launcher " << t;
+        }
+    }
+}
+
+// covers [0, hits.size()) in the way generated kernels do, striding by num_task
+int StridedTask(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+    auto* closure = static_cast<CountClosure*>(cdata);
+    for (size_t i = task_id; i < closure->hits->size(); i += penv->num_task) {
+        (*closure->hits)[i].fetch_add(1);
+    }
+    return 0;
+}
+
+int NestedTask(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+    auto* counter = static_cast<std::atomic<int>*>(cdata);
+    std::vector<std::atomic<int>> hits(8);
+    CountClosure closure{&hits};
+    if (TVMBackendParallelLaunch(StridedTask, &closure, 8) != 0) return -1;
+    for (auto& h: hits) {
+        if (h.load() != 1) return -1;
+    }
+    counter->fetch_add(1);
+    return 0;
+}
+
+TEST_F(ThreadPoolTest, NestedLaunchRunsInline) {
+    for (auto mode: {threading::PoolMode::kThreadLocal, threading::PoolMode::kShared}) {
+        ScopedPoolMode scope(mode);
+        std::atomic<int> counter{0};
+        ASSERT_EQ(TVMBackendParallelLaunch(NestedTask, &counter, 0), 0);
+        EXPECT_EQ(counter.load(), threading::NumThreads());
+    }
+}
+
+}// namespace
@@ -0,0 +1,82 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+#include "../src/runtime/workspace_planner.h"
+#include "runtime/c_backend_api.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+namespace {
+using namespace litetvm::runtime;
+
+TEST(WorkspacePlan, ReusesMemoryOfDeadRequests) {
+    // a and b overlap, c starts after both are gone
+    std::vector<WorkspaceInterval> trace = {{1000, 0, 3}, {500, 1, 2}, {1200, 4, 5}};
+    WorkspacePlan plan = WorkspacePlan::Compute(trace, 64);
+    EXPECT_TRUE(plan.offsets[0] + 1024 <= plan.offsets[1] || plan.offsets[1] + 512 <= plan.offsets[0]);
+    EXPECT_EQ(plan.arena_size, 1536);
+}
+
+class ScopedPlanning {
+public:
+    ScopedPlanning() : prev_(WorkspacePlanner::Enabled()) { WorkspacePlanner::SetEnabled(true); }
+    ~ScopedPlanning() { WorkspacePlanner::SetEnabled(prev_); }
+
+private:
+    bool prev_;
+};
+
+void* Alloc(size_t nbytes) { return TVMBackendAllocWorkspace(kDLCPU, 0, nbytes, 0, 8); }
+
+void Free(void* data) { EXPECT_EQ(TVMBackendFreeWorkspace(kDLCPU, 0, data), 0); }
+
+// a fake compiled function with a fixed workspace pattern
+std::vector<void*> RunKernel(const void* key, size_t extra = 0) {
+    WorkspacePlanScope scope(key);
+    std::vector<void*> ptrs;
+    void* a = Alloc(1000);
+    void* b = Alloc(5000 + extra);
+    std::memset(b, 1, 5000 + extra);
+    Free(b);
+    void* c = Alloc(3000);
+    std::memset(c, 2, 3000);
+    std::memset(a, 3, 1000);
+    Free(c);
+    Free(a);
+    return {a, b, c};
+}
+
+TEST(WorkspacePlanner, ReplaysRecordedTrace) {
+    ScopedPlanning planning;
+    static int key;
+    int planned = WorkspacePlanner::ThreadLocal()->num_planned();
+    std::vector<void*> recorded = RunKernel(&key);
+    EXPECT_EQ(WorkspacePlanner::ThreadLocal()->num_planned(), planned + 1);
+    std::vector<void*> first = RunKernel(&key);
+    std::vector<void*> second = RunKernel(&key);
+    EXPECT_EQ(first, second);
+    // b and c never live at the same time and share the arena
+    EXPECT_EQ(first[1], first[2]);
+}
+
+TEST(WorkspacePlanner, DivergingCallFallsBackToPool) {
+    ScopedPlanning planning;
+    static int key;
+    RunKernel(&key);
+    int planned = WorkspacePlanner::ThreadLocal()->num_planned();
+    DeviceMemoryStats before = DeviceAPI::GetMemoryStats({kDLCPU, 0});
+    RunKernel(&key, 4096);
+    EXPECT_EQ(WorkspacePlanner::ThreadLocal()->num_planned(), planned - 1);
+    // the arena is given back once the call is over
+    DeviceMemoryStats after = DeviceAPI::GetMemoryStats({kDLCPU, 0});
+    EXPECT_LT(after.workspace_bytes, before.workspace_bytes);
+    EXPECT_GT(after.free_count, before.free_count);
+    // still correct afterwards, served by the pool
+    RunKernel(&key);
+    EXPECT_FALSE(WorkspacePlanner::ThreadLocal()->active());
+}
+
+}// namespace
@@ -0,0 +1,107 @@
+//
+// Created by 赵丹 on 25-8-12.
+//
+#include "../src/runtime/workspace_pool.h"
+#include "runtime/c_backend_api.h"
+#include "runtime/device_api.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+using litetvm::runtime::DeviceAPI;
+using litetvm::runtime::WorkspacePool;
+
+struct Live {
+    uint8_t* data;
+    size_t size;
+    uint8_t tag;
+};
+
+void* Alloc(size_t nbytes) { return TVMBackendAllocWorkspace(kDLCPU, 0, nbytes, 0, 8); }
+
+void Free(void* data) { ASSERT_EQ(TVMBackendFreeWorkspace(kDLCPU, 0, data), 0); }
+
+TEST(WorkspacePool, LifoReusesTheSameBlocks) {
+    std::vector<void*> first;
+    for (size_t nbytes: {100, 5000, 70000, 1 << 20}) first.push_back(Alloc(nbytes));
+    for (auto it = first.rbegin(); it != first.rend(); ++it) Free(*it);
+    std::vector<void*> second;
+    for (size_t nbytes: {100, 5000, 70000, 1 << 20}) second.push_back(Alloc(nbytes));
+    EXPECT_EQ(first, second);
+    for (auto it = second.rbegin(); it != second.rend(); ++it) Free(*it);
+}
+
+TEST(WorkspacePool, CoalescesNeighbours) {
+    // three pages carved out of one chunk merge back into one block
+    void* a = Alloc(4096);
+    void* b = Alloc(4096);
+    void* c = Alloc(4096);
+    Free(b);
+    Free(a);
+    Free(c);
+    void* big = Alloc(3 * 4096);
+    EXPECT_EQ(big, std::min({a, b, c}));
+    Free(big);
+}
+
+TEST(WorkspacePool, RandomOrderKeepsBlocksDisjoint) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> size_dist(1, 300000);
+    std::vector<Live> live;
+    for (int step = 0; step < 5000; ++step) {
+        if (live.size() < 32 && (live.empty() || rng() % 2 == 0)) {
+            Live l;
+            l.size = size_dist(rng);
+            l.data = static_cast<uint8_t*>(Alloc(l.size));
+            l.tag = static_cast<uint8_t>(step);
+            ASSERT_NE(l.data, nullptr);
+            ASSERT_EQ(reinterpret_cast<uintptr_t>(l.data) % 64, 0);
+            std::fill(l.data, l.data + l.size, l.tag);
+            live.push_back(l);
+        } else {
+            size_t index = rng() % live.size();
+            const Live& l = live[index];
+            // nobody else wrote into the block while it was live
+            ASSERT_EQ(std::count(l.data, l.data + l.size, l.tag), static_cast<ptrdiff_t>(l.size));
+            Free(l.data);
+            live.erase(live.begin() + index);
+        }
+    }
+    for (const Live& l: live) Free(l.data);
+}
+
+TEST(WorkspacePool, HighWaterMarkBoundsHeldMemory) {
+    constexpr int64_t kBlock = 128 << 10;
+    DLDevice dev{kDLCPU, 0};
+    auto held = [&, base = DeviceAPI::GetMemoryStats(dev).workspace_bytes]() {
+        return DeviceAPI::GetMemoryStats(dev).workspace_bytes - base;
+    };
+    {
+        WorkspacePool pool(kDLCPU, DeviceAPI::Get(dev));
+        pool.SetHighWaterMark(2 * kBlock);
+        // live blocks may go over the mark
+        std::vector<void*> blocks;
+        for (int i = 0; i < 3; ++i) blocks.push_back(pool.AllocWorkspace(dev, kBlock));
+        EXPECT_EQ(held(), 3 * kBlock);
+        // free chunks are given back down to the mark
+        for (void* data: blocks) pool.FreeWorkspace(dev, data);
+        EXPECT_EQ(held(), 2 * kBlock);
+        // the chunks that were kept are reused
+        blocks.clear();
+        for (int i = 0; i < 2; ++i) blocks.push_back(pool.AllocWorkspace(dev, kBlock));
+        EXPECT_EQ(held(), 2 * kBlock);
+        for (void* data: blocks) pool.FreeWorkspace(dev, data);
+        EXPECT_EQ(held(), 2 * kBlock);
+        // lowering the mark gives back what is over it
+        pool.SetHighWaterMark(kBlock);
+        EXPECT_EQ(held(), kBlock);
+    }
+    EXPECT_EQ(held(), 0);
+}
+
+}// namespace